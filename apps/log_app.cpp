@@ -11,11 +11,6 @@
 #include <string>
 #include <string_view>
 #include <vector>
-#include <atomic>
-
-#include <thread>
-#include <condition_variable>
-#include <deque>
 
 namespace log_app_p {
 
@@ -70,59 +65,6 @@ static void parse_leveled_line(std::string_view line,
     out_msg.assign(line.substr(i));
 }
 
-class AsyncLogger {
-public:
-    explicit AsyncLogger(logger::Logger& L) : L_(&L) {}
-
-    void start() {
-        bool expected = false;
-        if (!started_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) return;
-        worker_ = std::thread([this]{ this->run(); });
-    }
-
-    void enqueue(logger::LogLevel lvl, std::string msg) {
-        {
-            std::lock_guard lk(m_);
-            q_.emplace_back(lvl, std::move(msg));
-        }
-        cv_.notify_one();
-    }
-
-    void flush_and_stop() {
-        {
-            std::lock_guard lk(m_);
-            stop_ = true;
-        }
-        cv_.notify_one();
-        if (worker_.joinable()) worker_.join();
-    }
-private:
-    void run() {
-        for (;;) {
-            std::unique_lock lk(m_);
-            cv_.wait(lk, [&]{ return stop_ || !q_.empty(); });
-            if (q_.empty() && stop_) break;
-            auto [lvl, msg] = std::move(q_.front());
-            q_.pop_front();
-            lk.unlock();
-            if (const auto st = L_->log(lvl, msg); st != logger::Status::Ok) {
-                std::cerr << "log failed: " << L_->last_error() << "\n";
-            }
-        }
-    }
-    logger::Logger* L_;
-    std::thread worker_;
-    std::mutex m_;
-    std::condition_variable cv_;
-    std::deque<std::pair<logger::LogLevel,std::string>> q_;
-    bool stop_ = false;
-    std::atomic<bool> started_{false};
-};
-
-static std::unique_ptr<AsyncLogger>& get_async_logger_instance() {
-    static std::unique_ptr<AsyncLogger> inst; return inst;
-}
-
 }
 
 using namespace logger;
@@ -200,6 +142,25 @@ public:
         return any_ok;
     }
 
+    std::size_t write_batch (const LogEntry* entries, const std::size_t count, std::string& err) noexcept override {
+        std::size_t best = 0;
+        std::string errs;
+        for (const auto& s : _sinks) {
+            std::string local;
+            const std::size_t n = s->write_batch (entries, count, local);
+            if (n > best)
+                best = n;
+            if (n < count) {
+                if (!errs.empty ())
+                    errs += "; ";
+                errs += local;
+            }
+        }
+        if (best < count)
+            err = errs.empty () ? "CompositeSink: all writes failed" : errs;
+        return best;
+    }
+
     void flush () noexcept override {
         for (const auto& s : _sinks)
             s->flush ();
@@ -239,7 +200,7 @@ int real_main (int argc, char** argv) {
     if (!sink)
         return 1;
 
-    Logger L (std::move (sink), o.level);
+    AsyncLogger L (std::move (sink), o.level);
 
     std::cerr << "Default level: " << to_string (L.default_level ()) << "\n";
     std::cerr << "Enter lines (or /quit):\n";
@@ -265,14 +226,11 @@ int real_main (int argc, char** argv) {
         LogLevel lvl;
         std::string msg;
         log_app_p::parse_leveled_line(line, L.default_level(), lvl, msg);
-        auto& S = log_app_p::get_async_logger_instance();
-        if (!S) { S = std::make_unique<log_app_p::AsyncLogger>(L); S->start(); }
-        S->enqueue(lvl, std::move(msg));
+        L.log (lvl, msg);
     }
-    try {
-        if (const auto& S = log_app_p::get_async_logger_instance()) S->flush_and_stop();
-    } catch (...) {}
-    L.flush ();
+    L.stop ();
+    if (const auto c = L.counters (); c.write_errors > 0)
+        std::cerr << "log failed (" << c.write_errors << " records): " << L.last_error () << "\n";
     return 0;
 }
 
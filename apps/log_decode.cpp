@@ -0,0 +1,64 @@
+#include "logger/binary_log.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace log_decode {
+void usage () {
+    std::cerr << "Usage:\n"
+              << "  log_decode <binary.log> [--out <text.log>]\n\n"
+              << "Converts a BinaryLogger file into FileSink text lines (stdout by default).\n";
+}
+
+int main_impl (int argc, char** argv) {
+    std::string in_path;
+    std::string out_path;
+    for (int i = 1; i < argc; i++) {
+        if (std::string a = argv[i]; a == "--help" || a == "-h") {
+            usage ();
+            return 0;
+        } else if (a == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (in_path.empty ()) {
+            in_path = a;
+        } else {
+            std::cerr << "Unknown arg: " << a << "\n";
+            usage ();
+            return 2;
+        }
+    }
+    if (in_path.empty ()) {
+        usage ();
+        return 2;
+    }
+
+    std::ifstream in (in_path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << in_path << "\n";
+        return 1;
+    }
+    std::ofstream file;
+    if (!out_path.empty ()) {
+        file.open (out_path, std::ios::out | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Cannot open " << out_path << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = out_path.empty () ? std::cout : file;
+
+    std::string err;
+    const bool ok = logger::decode_binary_log (in, out, err);
+    out.flush ();
+    if (!ok) {
+        std::cerr << err << "\n";
+        return 1;
+    }
+    return 0;
+}
+} // namespace log_decode
+
+int main (int argc, char** argv) {
+    return log_decode::main_impl (argc, argv);
+}
@@ -1,44 +1,77 @@
+#include "logger/hash.hpp"
+#include "logger/line_framer.hpp"
 #include "logger/log_level.hpp"
+#include "logger/source_stats.hpp"
 #include "logger/stats.hpp"
 #include "logger/utils.hpp"
+#include "logger/wire.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <cctype>
 #include <chrono>
 #include <csignal>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <arpa/inet.h>
 #include <cerrno>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace logger;
 
 namespace stat_func {
 std::atomic<bool> g_stop{ false };
+int g_wake_fd = -1; ///< eventfd watched by every reactor; written on shutdown.
+std::atomic<std::uint64_t> g_next_conn{ 1 }; ///< Source id of the next accepted connection.
+
 void on_sigint (int) {
     g_stop.store (true);
+    if (g_wake_fd != -1) {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const ssize_t n = ::write (g_wake_fd, &one, sizeof (one));
+    }
 }
 
 struct Options {
-    std::uint16_t port    = 5555;
-    std::size_t trigger_n = 100;
-    std::size_t timeout_s = 10;
+    std::uint16_t port        = 5555;
+    std::size_t trigger_n     = 100;
+    std::size_t timeout_s     = 10;
+    std::string unix_path;             ///< AF_UNIX stream listener (optional).
+    std::string unix_dgram_path;       ///< AF_UNIX datagram listener (optional).
+    std::uint16_t udp_port    = 0;     ///< UDP listener (optional).
+    std::size_t io_threads    = 0;     ///< Reactor threads (0 = one per core).
+    bool sharded              = false; ///< One listener and StatsCollector per reactor.
+    StatsWindow window;                ///< Sliding window length and bucket width.
+    std::size_t top_k         = 3;     ///< Templates printed per level (0 = none).
+    std::size_t top_sources   = 5;     ///< Sources printed by volume and by errors (0 = none).
+    std::size_t source_idle_s = 300;   ///< Sources silent this long are forgotten (0 = never).
 };
 
 void usage () {
     std::cerr << "Usage:\n"
-              << "  stats_collector --port <p> [--n <N>] [--timeout <sec>]\n\n"
-              << "Protocol: epoch_ms|LEVEL|message\\n where LEVEL in {INFO,WARN,ERROR}\n";
+              << "  stats_collector --port <p> [--n <N>] [--timeout <sec>]\n"
+              << "                  [--unix <path>] [--unix-dgram <path>] [--udp <port>]\n"
+              << "                  [--io-threads <N>] [--sharded]\n"
+              << "                  [--window <sec>] [--bucket-ms <ms>] [--windows <sec,sec,...>]\n"
+              << "                  [--top <K>] [--top-sources <N>] [--source-idle <sec>]\n\n"
+              << "Protocol: epoch_ms|LEVEL|message\\n where LEVEL in {INFO,WARN,ERROR}\n"
+              << "A connection may name its source with a first line \"SOURCE <id>\"\n";
 }
 
 std::optional<Options> parse_args (int argc, char** argv) {
@@ -53,6 +86,34 @@ std::optional<Options> parse_args (int argc, char** argv) {
             o.trigger_n = static_cast<std::size_t> (std::stoul (argv[++i]));
         } else if (a == "--timeout" && i + 1 < argc) {
             o.timeout_s = static_cast<std::size_t> (std::stoul (argv[++i]));
+        } else if (a == "--unix" && i + 1 < argc) {
+            o.unix_path = argv[++i];
+        } else if (a == "--unix-dgram" && i + 1 < argc) {
+            o.unix_dgram_path = argv[++i];
+        } else if (a == "--udp" && i + 1 < argc) {
+            o.udp_port = static_cast<std::uint16_t> (std::stoi (argv[++i]));
+        } else if (a == "--io-threads" && i + 1 < argc) {
+            o.io_threads = static_cast<std::size_t> (std::stoul (argv[++i]));
+        } else if (a == "--sharded") {
+            o.sharded = true;
+        } else if (a == "--window" && i + 1 < argc) {
+            o.window.length = std::chrono::seconds (std::stoul (argv[++i]));
+        } else if (a == "--bucket-ms" && i + 1 < argc) {
+            o.window.resolution = std::chrono::milliseconds (std::stoul (argv[++i]));
+        } else if (a == "--windows" && i + 1 < argc) {
+            o.window.windows.clear ();
+            const std::string list = argv[++i];
+            for (std::size_t pos = 0; pos < list.size ();) {
+                const std::size_t comma = std::min (list.find (',', pos), list.size ());
+                o.window.windows.push_back (std::chrono::seconds (std::stoul (list.substr (pos, comma - pos))));
+                pos = comma + 1;
+            }
+        } else if (a == "--top" && i + 1 < argc) {
+            o.top_k = static_cast<std::size_t> (std::stoul (argv[++i]));
+        } else if (a == "--top-sources" && i + 1 < argc) {
+            o.top_sources = static_cast<std::size_t> (std::stoul (argv[++i]));
+        } else if (a == "--source-idle" && i + 1 < argc) {
+            o.source_idle_s = static_cast<std::size_t> (std::stoul (argv[++i]));
         } else {
             std::cerr << "Unknown arg: " << a << "\n";
             usage ();
@@ -63,6 +124,10 @@ std::optional<Options> parse_args (int argc, char** argv) {
         std::cerr << "Port must be 1..65535\n";
         return std::nullopt;
     }
+    if (o.window.length.count () == 0 || o.window.resolution.count () == 0) {
+        std::cerr << "--window and --bucket-ms must be non-zero\n";
+        return std::nullopt;
+    }
     if (o.trigger_n == 0 && o.timeout_s == 0) {
         std::cerr << "Either --n or --timeout must be non-zero\n";
         return std::nullopt;
@@ -70,42 +135,16 @@ std::optional<Options> parse_args (int argc, char** argv) {
     return o;
 }
 
-bool parse_line (const std::string& line, std::uint64_t& epoch, LogLevel& lvl, std::string& msg) {
-    const auto p1 = line.find ('|');
-    if (p1 == std::string::npos)
-        return false;
-    const auto p2 = line.find ('|', p1 + 1);
-    if (p2 == std::string::npos)
-        return false;
-    epoch = 0;
-    for (size_t i = 0; i < p1; i++) {
-        if (const auto c = static_cast<unsigned char> (line[i]); !std::isdigit (c))
-            return false;
-        epoch = epoch * 10 + (line[i] - '0');
-    }
-    std::string lvl_s = line.substr (p1 + 1, p2 - (p1 + 1));
-    for (auto& c : lvl_s)
-        c = static_cast<char> (std::toupper (static_cast<unsigned char> (c)));
-    if (lvl_s == "INFO")
-        lvl = LogLevel::Info;
-    else if (lvl_s == "WARN")
-        lvl = LogLevel::Warning;
-    else if (lvl_s == "ERROR")
-        lvl = LogLevel::Error;
-    else
-        return false;
-    msg = line.substr (p2 + 1);
-    if (!msg.empty () && msg.back () == '\r')
-        msg.pop_back ();
-    return true;
-}
-
-int make_server (std::uint16_t port) {
+int make_server (std::uint16_t port, const bool reuse_port = false) {
     const int fd = ::socket (AF_INET, SOCK_STREAM, 0);
     if (fd < 0)
         return -1;
     constexpr int one = 1;
     setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+    if (reuse_port && setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof (one)) < 0) {
+        ::close (fd);
+        return -1;
+    }
     sockaddr_in addr{};
     addr.sin_family      = AF_INET;
     addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
@@ -123,51 +162,433 @@ int make_server (std::uint16_t port) {
     return fd;
 }
 
-void client_loop (const int cfd, StatsCollector* stats, std::atomic<std::size_t>* since_last) {
-    std::string buf;
-    buf.reserve (4096);
-    char tmp[4096];
-    while (!g_stop.load ()) {
-        ssize_t n = ::recv (cfd, tmp, sizeof (tmp), 0);
-        if (n == 0)
-            break;
-        if (n < 0) {
-            if (errno == EINTR)
-                continue;
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                std::this_thread::sleep_for (std::chrono::milliseconds (10));
-                continue;
-            }
-            break;
+int make_unix_server (const std::string& path, const int type) {
+    sockaddr_un addr{};
+    if (path.empty () || path.size () >= sizeof (addr.sun_path))
+        return -1;
+    const int fd = ::socket (AF_UNIX, type, 0);
+    if (fd < 0)
+        return -1;
+    ::unlink (path.c_str ());
+    addr.sun_family = AF_UNIX;
+    path.copy (addr.sun_path, path.size ());
+    if (bind (fd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)) < 0 ||
+    (type == SOCK_STREAM && listen (fd, 64) < 0)) {
+        ::close (fd);
+        return -1;
+    }
+    if (type == SOCK_STREAM)
+        fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+int make_udp_server (std::uint16_t port, const bool reuse_port = false) {
+    const int fd = ::socket (AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return -1;
+    constexpr int one = 1;
+    if (reuse_port && setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof (one)) < 0) {
+        ::close (fd);
+        return -1;
+    }
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port        = htons (port);
+    if (bind (fd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)) < 0) {
+        ::close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Name of a peer: its IP (port dropped, so one name per host), its
+ * socket path, or for an unnamed AF_UNIX stream peer the process id.
+ */
+std::string peer_name (const sockaddr_storage& addr, const socklen_t len, const int fd) {
+    char ip[INET6_ADDRSTRLEN];
+    if (addr.ss_family == AF_INET) {
+        const auto& in = reinterpret_cast<const sockaddr_in&> (addr);
+        return ::inet_ntop (AF_INET, &in.sin_addr, ip, sizeof (ip)) ? ip : "?";
+    }
+    if (addr.ss_family == AF_INET6) {
+        const auto& in6 = reinterpret_cast<const sockaddr_in6&> (addr);
+        return ::inet_ntop (AF_INET6, &in6.sin6_addr, ip, sizeof (ip)) ? ip : "?";
+    }
+    const auto& un = reinterpret_cast<const sockaddr_un&> (addr);
+    if (addr.ss_family == AF_UNIX && len > offsetof (sockaddr_un, sun_path) && un.sun_path[0] != '\0')
+        return "unix:" + std::string (un.sun_path, ::strnlen (un.sun_path, len - offsetof (sockaddr_un, sun_path)));
+    ucred cred{};
+    socklen_t clen = sizeof (cred);
+    if (fd != -1 && ::getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &clen) == 0 && cred.pid != 0)
+        return "pid:" + std::to_string (cred.pid);
+    return "unix";
+}
+
+/** @brief Count one text line from @p source; false if it is malformed. */
+bool ingest_text (const std::string_view line, StatsCollector* stats, const std::uint64_t source, SourceCounts& tally) {
+    std::uint64_t epoch;
+    LogLevel lvl;
+    std::string_view msg;
+    if (!parse_text_record (line, epoch, lvl, msg))
+        return false;
+    stats->add (epoch, lvl, msg, source);
+    tally.add (lvl, msg.size ());
+    return true;
+}
+
+/** @brief Stream protocol, decided by the first bytes a client sends. */
+enum class Wire { Unknown, Text, Binary };
+
+/** @brief Count the complete binary blocks pending in @p in; false on corrupt input. */
+bool ingest_blocks (LineFramer& in,
+StatsCollector* stats,
+std::atomic<std::size_t>* since_last,
+const std::uint64_t source,
+SourceCounts& tally) {
+    for (;;) {
+        std::string_view body;
+        std::size_t used     = 0;
+        const wire::Decode d = wire::next_block (in.pending (), body, used);
+        if (d == wire::Decode::NeedMore)
+            return true;
+        if (d == wire::Decode::Corrupt)
+            return false;
+        wire::RecordView r;
+        std::size_t records = 0;
+        while (!body.empty ()) {
+            if (wire::next_record (body, r) != wire::Decode::Ok)
+                return false;
+            stats->add (r.epoch_ms, r.level, r.message, source);
+            tally.add (r.level, r.message.size ());
+            ++records;
         }
-        buf.append (tmp, tmp + n);
-        size_t pos = 0;
-        while (true) {
-            auto nl = buf.find ('\n', pos);
-            if (nl == std::string::npos) {
-                buf.erase (0, pos);
+        in.consume (used);
+        since_last->fetch_add (records, std::memory_order_relaxed);
+    }
+}
+
+/** @brief Statistics fed by one or more reactors; the reporter merges all shards. */
+struct Shard {
+    explicit Shard (const StatsWindow window) : stats (window) {
+    }
+
+    StatsCollector stats;
+    SourceStatsTable by_source;                            ///< Per-source counts of this shard's reactors.
+    alignas (64) std::atomic<std::size_t> since_last{ 0 }; ///< Records since the last report.
+};
+
+/** @brief One epoll registration of a @ref Reactor. */
+struct Source {
+    enum class Kind { Wakeup, Listener, Datagram, Stream };
+
+    Source (const Kind k, const int f) noexcept : kind (k), fd (f) {
+    }
+
+    Kind kind;
+    int fd;
+    Wire mode{ Wire::Unknown }; ///< Stream only.
+    LineFramer in;              ///< Stream only: received bytes not parsed yet.
+    std::uint64_t id{ 0 };      ///< Stream only: source id for the distinct-source estimates.
+    std::string name;           ///< Stream only: peer name, or the id from a SOURCE line.
+    SourceCounts tally;         ///< Stream only: records since the last flush to the source table.
+};
+
+/**
+ * @brief epoll loop of one I/O thread.
+ * @details Listening and datagram sockets are shared by all reactors and
+ * registered with EPOLLEXCLUSIVE, so one ready event wakes one thread. A
+ * connection stays on the reactor that accepted it (edge-triggered, read
+ * until EAGAIN) and is closed and freed as soon as the peer hangs up.
+ *
+ * Per-source counts are kept locally (in each connection, and per
+ * datagram sender) and flushed into the shard's @ref SourceStatsTable every
+ * @ref kFlushEvery and when a connection closes, so the table's lock is
+ * not taken per record.
+ */
+class Reactor {
+    public:
+    Reactor (StatsCollector* stats, std::atomic<std::size_t>* since_last, SourceStatsTable* by_source)
+    : _ep (::epoll_create1 (EPOLL_CLOEXEC)), _stats (stats), _since_last (since_last), _by_source (by_source) {
+    }
+
+    ~Reactor () {
+        for (auto& [fd, src] : _sources)
+            if (src->kind == Source::Kind::Stream)
+                ::close (fd);
+        if (_ep != -1)
+            ::close (_ep);
+    }
+
+    Reactor (const Reactor&)            = delete;
+    Reactor& operator= (const Reactor&) = delete;
+
+    /** @brief Watch a socket shared with other reactors (not closed here). */
+    bool watch (const Source::Kind kind, const int fd) {
+        const std::uint32_t events = kind == Source::Kind::Wakeup ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE;
+        return add (std::make_unique<Source> (kind, fd), events);
+    }
+
+    /** @brief Dispatch events until @ref g_stop is set (the wakeup fd interrupts the wait). */
+    void run () noexcept {
+        epoll_event events[64];
+        while (!g_stop.load ()) {
+            const int n = ::epoll_wait (_ep, events, 64, static_cast<int> (kFlushEvery.count ()));
+            if (n < 0 && errno != EINTR)
                 break;
+            for (int i = 0; i < n && !g_stop.load (); ++i) {
+                auto* src = static_cast<Source*> (events[i].data.ptr);
+                switch (src->kind) {
+                case Source::Kind::Wakeup: break;
+                case Source::Kind::Listener: on_accept (src->fd); break;
+                case Source::Kind::Datagram: on_datagrams (src->fd); break;
+                case Source::Kind::Stream:
+                    if (!on_stream (*src))
+                        drop (src->fd);
+                    break;
+                }
+            }
+            if (std::chrono::steady_clock::now () - _flushed >= kFlushEvery)
+                flush_sources ();
+        }
+    }
+
+    private:
+    static constexpr std::chrono::milliseconds kFlushEvery{ 250 };
+    static constexpr std::string_view kSourceTag = "SOURCE ";
+    static constexpr std::size_t kMaxSourceLine  = 256;
+
+    /** @brief Local tally of one datagram sender. */
+    struct Sender {
+        std::string name;
+        SourceCounts tally;
+    };
+
+    /** @brief Fold every local tally into the source table. */
+    void flush_sources () {
+        const std::uint64_t now = now_epoch_ms ();
+        for (auto& [fd, src] : _sources) {
+            if (src->kind == Source::Kind::Stream && src->tally.total != 0) {
+                _by_source->merge (src->name, src->tally, now);
+                src->tally = SourceCounts{};
+            }
+        }
+        for (const auto& [id, sender] : _senders)
+            _by_source->merge (sender.name, sender.tally, now);
+        _senders.clear ();
+        _flushed = std::chrono::steady_clock::now ();
+    }
+    bool add (std::unique_ptr<Source> src, const std::uint32_t events) {
+        epoll_event ev{};
+        ev.events   = events;
+        ev.data.ptr = src.get ();
+        if (::epoll_ctl (_ep, EPOLL_CTL_ADD, src->fd, &ev) != 0)
+            return false;
+        const int fd = src->fd;
+        _sources[fd] = std::move (src);
+        return true;
+    }
+
+    void drop (const int fd) {
+        if (const auto it = _sources.find (fd); it != _sources.end ())
+            _by_source->merge (it->second->name, it->second->tally, now_epoch_ms ());
+        ::epoll_ctl (_ep, EPOLL_CTL_DEL, fd, nullptr);
+        ::close (fd);
+        _sources.erase (fd);
+    }
+
+    void on_accept (const int lfd) {
+        // Bounded so one busy listener cannot starve this reactor's connections.
+        for (int i = 0; i < 64; ++i) {
+            sockaddr_storage peer{};
+            socklen_t len = sizeof (peer);
+            const int cfd = ::accept4 (lfd, reinterpret_cast<sockaddr*> (&peer), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (cfd < 0)
+                return;
+            auto conn  = std::make_unique<Source> (Source::Kind::Stream, cfd);
+            conn->id   = g_next_conn.fetch_add (1, std::memory_order_relaxed);
+            conn->name = peer_name (peer, len, cfd);
+            if (!add (std::move (conn), EPOLLIN | EPOLLRDHUP | EPOLLET))
+                ::close (cfd);
+        }
+    }
+
+    /** @brief Read everything available; false when the connection should be closed. */
+    bool on_stream (Source& c) {
+        for (;;) {
+            char* dst       = c.in.reserve (4096);
+            const ssize_t n = ::recv (c.fd, dst, c.in.room (), 0);
+            if (n == 0)
+                return false;
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            c.in.commit (static_cast<std::size_t> (n));
+            if (!consume (c))
+                return false;
+        }
+    }
+
+    /**
+     * @brief Take a leading "SOURCE <id>\n" line as the connection's name.
+     * @return false while the pending bytes may still be an incomplete one.
+     */
+    static bool take_source_line (Source& c) {
+        const std::string_view p = c.in.pending ();
+        if (p.substr (0, kSourceTag.size ()) != kSourceTag.substr (0, std::min (p.size (), kSourceTag.size ())))
+            return true;
+        const std::size_t nl = p.find ('\n');
+        if (nl == std::string_view::npos)
+            return p.size () >= kMaxSourceLine; // too long: left to the text parser, which drops it
+        std::string_view id = p.substr (kSourceTag.size (), nl - kSourceTag.size ());
+        if (!id.empty () && id.back () == '\r')
+            id.remove_suffix (1);
+        if (!id.empty ())
+            c.name.assign (id.substr (0, 64));
+        c.in.consume (nl + 1);
+        return true;
+    }
+
+    bool consume (Source& c) {
+        if (c.mode == Wire::Unknown && !take_source_line (c))
+            return true;
+        if (c.mode == Wire::Unknown) {
+            // Binary clients open with wire::kHello; text lines start with a digit.
+            const std::string_view head = c.in.pending ().substr (0, wire::kHello.size ());
+            if (head != wire::kHello.substr (0, head.size ())) {
+                c.mode = Wire::Text;
+            } else if (head.size () == wire::kHello.size ()) {
+                if (::send (c.fd, wire::kAccept.data (), wire::kAccept.size (), MSG_NOSIGNAL) !=
+                static_cast<ssize_t> (wire::kAccept.size ()))
+                    return false;
+                c.in.consume (head.size ());
+                c.mode = Wire::Binary;
+            } else {
+                return true;
             }
-            std::string line = buf.substr (pos, nl - pos);
-            pos              = nl + 1;
-            std::uint64_t epoch;
-            std::string msg;
-            if (LogLevel lvl; parse_line (line, epoch, lvl, msg)) {
-                stats->add (epoch, lvl, msg.size ());
-                since_last->fetch_add (1, std::memory_order_relaxed);
+        }
+        if (c.mode == Wire::Binary) {
+            if (ingest_blocks (c.in, _stats, _since_last, c.id, c.tally))
+                return true;
+            std::cerr << "stats_collector: corrupt block, closing connection\n";
+            return false;
+        }
+        const std::size_t records = c.in.for_each_record (
+        [this, &c] (const std::uint64_t epoch, const LogLevel lvl, const std::string_view msg) {
+            _stats->add (epoch, lvl, msg, c.id);
+            c.tally.add (lvl, msg.size ());
+        });
+        _since_last->fetch_add (records, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Datagram listener: each datagram holds one or more complete lines.
+     * @details The sender address is the source id; unbound AF_UNIX senders have none.
+     */
+    void on_datagrams (const int fd) {
+        constexpr unsigned kBatch          = 32;
+        constexpr std::size_t kDatagramMax = 64 * 1024;
+        _dgram.resize (kBatch * kDatagramMax);
+        iovec iov[kBatch];
+        mmsghdr msgs[kBatch];
+        sockaddr_storage from[kBatch];
+        for (unsigned i = 0; i < kBatch; ++i) {
+            iov[i]                      = iovec{ _dgram.data () + i * kDatagramMax, kDatagramMax };
+            msgs[i]                     = mmsghdr{};
+            msgs[i].msg_hdr.msg_iov     = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen  = 1;
+            msgs[i].msg_hdr.msg_name    = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof (from[i]);
+        }
+        const int n         = ::recvmmsg (fd, msgs, kBatch, MSG_DONTWAIT, nullptr);
+        std::size_t records = 0;
+        for (int i = 0; i < n; ++i) {
+            const char* p          = static_cast<const char*> (iov[i].iov_base);
+            const char* end        = p + msgs[i].msg_len;
+            const socklen_t len    = msgs[i].msg_hdr.msg_namelen;
+            const std::uint64_t id = len > sizeof (sa_family_t) ? hash_bytes (&from[i], len) | 1 : 0;
+            Sender& sender         = _senders[id];
+            if (sender.name.empty ())
+                sender.name = id != 0 ? peer_name (from[i], len, -1) : "unix";
+            while (p < end) {
+                const char* nl = find_byte (p, end, '\n');
+                records += ingest_text (std::string_view (p, static_cast<std::size_t> (nl - p)), _stats, id, sender.tally);
+                p = nl == end ? end : nl + 1;
             }
         }
+        _since_last->fetch_add (records, std::memory_order_relaxed);
     }
-    ::close (cfd);
+
+    int _ep;                                                   ///< epoll instance.
+    StatsCollector* _stats;                                    ///< Shared statistics.
+    std::atomic<std::size_t>* _since_last;                     ///< Records since the last report.
+    SourceStatsTable* _by_source;                              ///< The shard's per-source counts.
+    std::unordered_map<std::uint64_t, Sender> _senders;        ///< Datagram tallies by sender id, until the next flush.
+    std::chrono::steady_clock::time_point _flushed{};          ///< Last @ref flush_sources.
+    std::unordered_map<int, std::unique_ptr<Source>> _sources; ///< Keyed by fd.
+    std::vector<char> _dgram;                                  ///< recvmmsg buffers (allocated on first use).
+};
+
+std::ostream& operator<< (std::ostream& os, const LengthQuantiles& q) {
+    return os << "p50 " << q.p50 << ", p90 " << q.p90 << ", p99 " << q.p99 << ", p999 " << q.p999;
 }
 
-void print_snapshot (const StatsSnapshot& s) {
+void print_snapshot (const StatsSnapshot& s, const StatsWindow& window, const std::size_t top_k) {
+    const auto secs         = std::chrono::duration_cast<std::chrono::seconds> (window.length).count ();
+    const std::string label = secs == 3600 ? std::string ("last_hour") : "last_" + std::to_string (secs) + "s";
     std::cout
     << "=== stats ===\n"
     << "total: " << s.total << " (ERROR " << s.by_level[0] << ", WARN " << s.by_level[1] << ", INFO " << s.by_level[2] << ")\n"
-    << "len: min " << s.min_len << ", max " << s.max_len << ", avg " << s.avg_len << "\n"
-    << "last_hour: " << s.last_hour_total << " (ERROR " << s.last_hour_by_level[0] << ", WARN "
-    << s.last_hour_by_level[1] << ", INFO " << s.last_hour_by_level[2] << "), avg_len " << s.last_hour_avg_len << "\n";
+    << "len: min " << s.min_len << ", max " << s.max_len << ", avg " << s.avg_len << ", " << s.len_q << "\n"
+    << label << ": " << s.last_hour_total << " (ERROR " << s.last_hour_by_level[0] << ", WARN " << s.last_hour_by_level[1]
+    << ", INFO " << s.last_hour_by_level[2] << "), avg_len " << s.last_hour_avg_len << ", " << s.last_hour_len_q << "\n"
+    << "distinct (approx): messages " << s.distinct_messages << ", sources " << s.distinct_sources << "; " << label
+    << ": messages " << s.last_hour_distinct_messages << ", sources " << s.last_hour_distinct_sources << "\n";
+    for (const WindowStats& w : s.windows)
+        std::cout << "last_" << std::chrono::duration_cast<std::chrono::seconds> (w.length).count () << "s: " << w.total
+                  << " (ERROR " << w.by_level[0] << ", WARN " << w.by_level[1] << ", INFO " << w.by_level[2]
+                  << "), avg_len " << w.avg_len << ", distinct messages " << w.distinct_messages << ", sources "
+                  << w.distinct_sources << "\n";
+    for (const LevelRates& r : s.rates)
+        std::cout << "rate_" << std::chrono::duration_cast<std::chrono::seconds> (r.horizon).count ()
+                  << "s (msg/s): ERROR " << r.per_sec[0] << ", WARN " << r.per_sec[1] << ", INFO " << r.per_sec[2] << "\n";
+    const char* names[3]{ "ERROR", "WARN", "INFO" };
+    // The window ranking: a burst shows up even when older templates have larger totals.
+    for (int l = 0; l < 3; ++l) {
+        const std::vector<TemplateCount>& top = s.last_hour_top_templates[l];
+        const std::size_t n                   = std::min (top_k, top.size ());
+        if (n == 0)
+            continue;
+        std::cout << "top " << names[l] << " (" << label << "):";
+        for (std::size_t i = 0; i < n; ++i)
+            std::cout << (i == 0 ? " " : ", ") << top[i].count << " \"" << top[i].text << "\"";
+        std::cout << "\n";
+    }
+    std::cout.flush ();
+}
+
+/** @brief Print the @p n busiest and the @p n most erroring sources. */
+void print_sources (const SourceStatsTable& table, const std::size_t n) {
+    if (n == 0)
+        return;
+    const auto print = [] (const char* title, const std::vector<SourceStats>& rows) {
+        if (rows.empty ())
+            return;
+        std::cout << title << ":";
+        for (std::size_t i = 0; i < rows.size (); ++i) {
+            const SourceCounts& c = rows[i].counts;
+            std::cout << (i == 0 ? " " : ", ") << rows[i].source << " " << c.total << " (ERROR " << c.by_level[0]
+                      << ", WARN " << c.by_level[1] << ", INFO " << c.by_level[2] << ")";
+        }
+        std::cout << "\n";
+    };
+    std::cout << "sources: " << table.size () << "\n";
+    print ("top sources by volume", table.top_by_volume (n));
+    print ("top sources by errors", table.top_by_errors (n));
     std::cout.flush ();
 }
 
@@ -175,60 +596,138 @@ int main_impl (int argc, char** argv) {
     auto opt = parse_args (argc, argv);
     if (!opt)
         return 2;
-    const auto [port, trigger_n, timeout_s] = *opt;
+    const auto& [port, trigger_n, timeout_s, unix_path, unix_dgram_path, udp_port, io_threads, sharded, window, top_k, top_sources, source_idle_s] = *opt;
 
+    g_wake_fd = ::eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
     std::signal (SIGINT, on_sigint);
     std::signal (SIGTERM, on_sigint);
 
-    const int sfd = make_server (port);
-    if (sfd < 0) {
-        std::perror ("bind/listen");
-        return 1;
+    const std::size_t threads = io_threads > 0 ? io_threads : std::max (1u, std::thread::hardware_concurrency ());
+    constexpr std::size_t kAll = static_cast<std::size_t> (-1);
+    std::vector<int> owned;                          // every socket, closed at exit
+    std::vector<std::vector<int>> streams (threads); // listeners each reactor watches
+    std::vector<std::vector<int>> dgrams (threads);  // datagram sockets each reactor watches
+    auto attach = [&] (std::vector<std::vector<int>>& to, const int fd, const std::size_t reactor) {
+        owned.push_back (fd);
+        for (std::size_t i = 0; i < threads; ++i)
+            if (reactor == kAll || reactor == i)
+                to[i].push_back (fd);
+    };
+
+    // Sharded: every reactor binds its own TCP/UDP socket with SO_REUSEPORT,
+    // so the kernel spreads clients over shards and no lock is shared; the
+    // reporter combines the shards' statistics and source tables.
+    const std::size_t per_port = sharded ? threads : 1;
+    for (std::size_t i = 0; i < per_port; ++i) {
+        const int sfd = make_server (port, sharded);
+        if (sfd < 0) {
+            std::perror ("bind/listen");
+            return 1;
+        }
+        attach (streams, sfd, sharded ? i : kAll);
     }
-    std::cout << "stats_collector listening on 127.0.0.1:" << port << "\n";
-    StatsCollector stats;
-    std::atomic<std::size_t> since_last{ 0 };
+    std::cout << "stats_collector listening on 127.0.0.1:" << port;
+    if (sharded)
+        std::cout << " (" << threads << " shards)";
+    std::cout << "\n";
+    if (!unix_path.empty ()) {
+        const int fd = make_unix_server (unix_path, SOCK_STREAM);
+        if (fd < 0) {
+            std::perror ("unix bind/listen");
+            return 1;
+        }
+        attach (streams, fd, kAll);
+        std::cout << "stats_collector listening on unix:" << unix_path << "\n";
+    }
+    if (!unix_dgram_path.empty ()) {
+        const int fd = make_unix_server (unix_dgram_path, SOCK_DGRAM);
+        if (fd < 0) {
+            std::perror ("unix-dgram bind");
+            return 1;
+        }
+        attach (dgrams, fd, kAll);
+        std::cout << "stats_collector listening on unix-dgram:" << unix_dgram_path << "\n";
+    }
+    for (std::size_t i = 0; udp_port != 0 && i < per_port; ++i) {
+        const int fd = make_udp_server (udp_port, sharded);
+        if (fd < 0) {
+            std::perror ("udp bind");
+            return 1;
+        }
+        attach (dgrams, fd, sharded ? i : kAll);
+        if (i == 0)
+            std::cout << "stats_collector listening on udp 127.0.0.1:" << udp_port << "\n";
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    for (std::size_t i = 0; i < per_port; ++i)
+        shards.push_back (std::make_unique<Shard> (window));
+    auto pending = [&] {
+        std::size_t n = 0;
+        for (const auto& sh : shards)
+            n += sh->since_last.load (std::memory_order_relaxed);
+        return n;
+    };
     auto last_print = std::chrono::steady_clock::now ();
 
     std::thread reporter ([&] () {
         while (!g_stop.load ()) {
             std::this_thread::sleep_for (std::chrono::milliseconds (200));
-            const bool count_reached = (trigger_n > 0) && (since_last.load () >= trigger_n);
+            const bool count_reached = (trigger_n > 0) && (pending () >= trigger_n);
             const bool timeout_reached =
             (timeout_s > 0) && (std::chrono::steady_clock::now () - last_print >= std::chrono::seconds (timeout_s));
             if (count_reached || timeout_reached) {
-                if (since_last.load () > 0) {
-                    auto snap = stats.snapshot (now_epoch_ms ());
-                    print_snapshot (snap);
-                    since_last.store (0);
+                if (pending () > 0) {
+                    const std::uint64_t now = now_epoch_ms ();
+                    auto snap               = shards[0]->stats.snapshot (now);
+                    for (std::size_t i = 1; i < shards.size (); ++i)
+                        merge_snapshot (snap, shards[i]->stats.snapshot (now));
+                    print_snapshot (snap, window, top_k);
+                    SourceStatsTable by_source;
+                    for (const auto& sh : shards) {
+                        if (source_idle_s > 0)
+                            sh->by_source.evict_idle (now - std::min<std::uint64_t> (now, source_idle_s * 1000));
+                        by_source.merge (sh->by_source);
+                    }
+                    print_sources (by_source, top_sources);
+                    for (const auto& sh : shards)
+                        sh->since_last.store (0);
                 }
                 last_print = std::chrono::steady_clock::now ();
             }
         }
     });
 
-    std::vector<std::thread> workers;
-    while (!g_stop.load ()) {
-        sockaddr_in cli{};
-        socklen_t len = sizeof (cli);
-        int cfd       = ::accept (sfd, reinterpret_cast<sockaddr*> (&cli), &len);
-        if (cfd < 0) {
-            if (errno == EINTR)
-                continue;
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                std::this_thread::sleep_for (std::chrono::milliseconds (10));
-                continue;
-            }
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    for (std::size_t i = 0; i < threads; ++i) {
+        Shard& shard = *shards[sharded ? i : 0];
+        auto r       = std::make_unique<Reactor> (&shard.stats, &shard.since_last, &shard.by_source);
+        bool ok      = r->watch (Source::Kind::Wakeup, g_wake_fd);
+        for (const int fd : streams[i])
+            ok = ok && r->watch (Source::Kind::Listener, fd);
+        for (const int fd : dgrams[i])
+            ok = ok && r->watch (Source::Kind::Datagram, fd);
+        if (!ok) {
+            std::perror ("epoll");
+            on_sigint (0);
             break;
         }
-        workers.emplace_back (client_loop, cfd, &stats, &since_last);
+        reactors.push_back (std::move (r));
     }
-    for (auto& t : workers)
-        if (t.joinable ())
-            t.join ();
-    g_stop.store (true);
+    std::vector<std::thread> io;
+    for (auto& r : reactors)
+        io.emplace_back ([&r] { r->run (); });
+    for (auto& t : io)
+        t.join ();
+    reactors.clear ();
     reporter.join ();
-    close (sfd);
+    for (const int fd : owned)
+        close (fd);
+    close (g_wake_fd);
+    if (!unix_path.empty ())
+        ::unlink (unix_path.c_str ());
+    if (!unix_dgram_path.empty ())
+        ::unlink (unix_dgram_path.c_str ());
     return 0;
 }
 } // namespace stat_func
@@ -0,0 +1,63 @@
+#include "logger/file_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace logger;
+
+namespace {
+/** @brief Time every write() and print the latency percentiles. */
+void run (const char* name, const std::string& path, const FileSinkOptions& opts, const std::size_t writes) {
+    std::error_code ec;
+    std::filesystem::remove (path, ec);
+    FileSink sink (path, opts);
+    if (!sink.is_open ()) {
+        std::printf ("%-24s cannot open %s\n", name, path.c_str ());
+        return;
+    }
+    LogEntry e;
+    e.message.assign (200, 'm');
+    std::string err;
+    std::vector<std::uint32_t> ns (writes);
+    const auto t0 = std::chrono::steady_clock::now ();
+    for (std::size_t i = 0; i < writes; ++i) {
+        const auto a = std::chrono::steady_clock::now ();
+        sink.write (e, err);
+        ns[i] = static_cast<std::uint32_t> (std::min<std::int64_t> (
+        std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - a).count (), UINT32_MAX));
+    }
+    sink.flush ();
+    const double secs = std::chrono::duration<double> (std::chrono::steady_clock::now () - t0).count ();
+    std::sort (ns.begin (), ns.end ());
+    const auto pct = [&] (const double p) { return ns[static_cast<std::size_t> (p * static_cast<double> (writes - 1))]; };
+    std::printf ("%-24s %7.2f Mwrites/s  p50 %6u  p99 %7u  p99.9 %8u  max %9u ns\n", name,
+    static_cast<double> (writes) / secs / 1e6, pct (0.5), pct (0.99), pct (0.999), ns.back ());
+    std::filesystem::remove (path, ec);
+}
+} // namespace
+
+int main (int argc, char** argv) {
+    const std::string path   = argc > 1 ? argv[1] : "bench_file_sink.log";
+    const std::size_t writes = argc > 2 ? std::stoull (argv[2]) : 2'000'000ull;
+    std::printf ("%zu writes of ~230 bytes to %s\n", writes, path.c_str ());
+
+    FileSinkOptions opts;
+    opts.buffer_bytes = 64 * 1024;
+    run ("write(2)", path, opts, writes);
+
+    opts.io_uring = true;
+    {
+        FileSink probe (path + ".probe", opts);
+        if (!probe.uses_io_uring ())
+            std::printf ("io_uring unavailable: the next line measures the write(2) fallback\n");
+    }
+    std::error_code ec;
+    std::filesystem::remove (path + ".probe", ec);
+    run ("io_uring WRITE_FIXED", path, opts, writes);
+    return 0;
+}
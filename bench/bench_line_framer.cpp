@@ -0,0 +1,180 @@
+#include "logger/line_framer.hpp"
+#include "logger/log_level.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace logger;
+
+namespace {
+volatile std::uint64_t g_sink = 0;
+constexpr std::size_t kRecv   = 64 * 1024; // bytes per simulated recv()
+
+/** @brief The former stats_collector parser: substr, upper-cased copy, message copy. */
+bool parse_line_copying (const std::string& line, std::uint64_t& epoch, LogLevel& lvl, std::string& msg) {
+    const auto p1 = line.find ('|');
+    if (p1 == std::string::npos)
+        return false;
+    const auto p2 = line.find ('|', p1 + 1);
+    if (p2 == std::string::npos)
+        return false;
+    epoch = 0;
+    for (std::size_t i = 0; i < p1; i++) {
+        if (!std::isdigit (static_cast<unsigned char> (line[i])))
+            return false;
+        epoch = epoch * 10 + static_cast<std::uint64_t> (line[i] - '0');
+    }
+    std::string lvl_s = line.substr (p1 + 1, p2 - (p1 + 1));
+    for (auto& c : lvl_s)
+        c = static_cast<char> (std::toupper (static_cast<unsigned char> (c)));
+    if (lvl_s == "INFO")
+        lvl = LogLevel::Info;
+    else if (lvl_s == "WARN")
+        lvl = LogLevel::Warning;
+    else if (lvl_s == "ERROR")
+        lvl = LogLevel::Error;
+    else
+        return false;
+    msg = line.substr (p2 + 1);
+    return true;
+}
+
+std::string synthesize (const std::size_t bytes) {
+    static const char* const kLevels[] = { "INFO", "WARN", "ERROR" };
+    std::string out;
+    out.reserve (bytes + 256);
+    std::uint64_t ts = 1'724'054'876'881ull;
+    for (std::uint64_t i = 0; out.size () < bytes; ++i, ts += 3) {
+        out += std::to_string (ts);
+        out += '|';
+        out += kLevels[i % 7 == 0 ? 2 : i % 3 == 0 ? 1 : 0];
+        out += "|request ";
+        out += std::to_string (i * 2654435761u % 100000);
+        out.append (20 + i * 7919 % 90, 'x');
+        out += '\n';
+    }
+    return out;
+}
+
+template <class F> void report (const char* name, const std::string_view capture, const std::uint64_t passes, F&& f) {
+    const auto t0     = std::chrono::steady_clock::now ();
+    std::uint64_t recs = 0;
+    for (std::uint64_t p = 0; p < passes; ++p)
+        recs += f (capture);
+    const double s  = std::chrono::duration<double> (std::chrono::steady_clock::now () - t0).count ();
+    const double gb = static_cast<double> (capture.size ()) * static_cast<double> (passes) / 1e9;
+    std::printf ("%-36s %7.2f GB/s %8.1f Mrec/s\n", name, gb / s, static_cast<double> (recs) / s / 1e6);
+}
+} // namespace
+
+int main (int argc, char** argv) {
+    // bench_line_framer [capture-file] [GB to process]
+    std::string owned;
+    std::string_view capture;
+    if (argc > 1 && std::strcmp (argv[1], "-") != 0) {
+        const int fd = ::open (argv[1], O_RDONLY);
+        struct stat st{};
+        if (fd < 0 || ::fstat (fd, &st) != 0 || st.st_size == 0) {
+            std::perror (argv[1]);
+            return 1;
+        }
+        void* p = ::mmap (nullptr, static_cast<std::size_t> (st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            std::perror ("mmap");
+            return 1;
+        }
+        capture = std::string_view (static_cast<const char*> (p), static_cast<std::size_t> (st.st_size));
+    } else {
+        owned   = synthesize (256u << 20);
+        capture = owned;
+    }
+    const double want_gb       = argc > 2 ? std::stod (argv[2]) : 4.0;
+    const std::uint64_t passes = std::max<std::uint64_t> (1, static_cast<std::uint64_t> (want_gb * 1e9 / capture.size ()));
+    std::printf ("capture %.1f MB x %llu passes, simd: %d\n", capture.size () / 1e6,
+    static_cast<unsigned long long> (passes), static_cast<int> (detected_simd_level ()));
+
+    report ("string find/substr + copying parse", capture, passes, [] (const std::string_view cap) {
+        std::string buf, msg;
+        std::uint64_t recs = 0, epoch;
+        LogLevel lvl;
+        for (std::size_t off = 0; off < cap.size (); off += kRecv) {
+            buf.append (cap.substr (off, kRecv));
+            std::size_t pos = 0;
+            for (std::size_t nl; (nl = buf.find ('\n', pos)) != std::string::npos; pos = nl + 1) {
+                const std::string line = buf.substr (pos, nl - pos);
+                recs += parse_line_copying (line, epoch, lvl, msg);
+                g_sink = g_sink + msg.size ();
+            }
+            buf.erase (0, pos);
+        }
+        return recs;
+    });
+
+    for (const auto& [name, level] : { std::pair{ "newline scan: memchr", SimdLevel::Generic },
+         std::pair{ "newline scan: SSE2", SimdLevel::Sse2 }, std::pair{ "newline scan: AVX2", SimdLevel::Avx2 } }) {
+        if (!simd_supported (level))
+            continue;
+        report (name, capture, passes, [level = level] (const std::string_view cap) {
+            std::uint64_t lines = 0;
+            const char* end     = cap.data () + cap.size ();
+            for (const char* p = cap.data (); (p = find_byte (p, end, '\n', level)) != end; ++p)
+                ++lines;
+            return lines;
+        });
+    }
+
+    for (const auto& [name, level] : { std::pair{ "delimiter index: scalar", SimdLevel::Generic },
+         std::pair{ "delimiter index: SSE2", SimdLevel::Sse2 }, std::pair{ "delimiter index: AVX2", SimdLevel::Avx2 } }) {
+        if (!simd_supported (level))
+            continue;
+        report (name, capture, passes, [level = level] (const std::string_view cap) {
+            std::vector<std::uint32_t> out (1024);
+            std::uint64_t hits = 0;
+            for (std::size_t done = 0, step = 0; done < cap.size (); done += step)
+                hits += index_delimiters (cap.data () + done, cap.size () - done, out.data (), out.size (), step, level);
+            return hits / 3; // two '|' and one '\n' per record
+        });
+    }
+
+    report ("LineFramer::for_each_record", capture, passes, [] (const std::string_view cap) {
+        LineFramer framer (kRecv * 2);
+        std::uint64_t recs = 0;
+        for (std::size_t off = 0; off < cap.size (); off += kRecv) {
+            const std::string_view chunk = cap.substr (off, kRecv);
+            std::memcpy (framer.reserve (chunk.size ()), chunk.data (), chunk.size ()); // stands in for recv()
+            framer.commit (chunk.size ());
+            recs += framer.for_each_record ([] (std::uint64_t, LogLevel, const std::string_view msg) {
+                g_sink = g_sink + msg.size ();
+            });
+        }
+        return recs;
+    });
+
+    report ("LineFramer lines + parse_text_record", capture, passes, [] (const std::string_view cap) {
+        LineFramer framer (kRecv * 2);
+        std::uint64_t recs = 0, epoch;
+        LogLevel lvl;
+        std::string_view msg;
+        for (std::size_t off = 0; off < cap.size (); off += kRecv) {
+            const std::string_view chunk = cap.substr (off, kRecv);
+            std::memcpy (framer.reserve (chunk.size ()), chunk.data (), chunk.size ()); // stands in for recv()
+            framer.commit (chunk.size ());
+            framer.for_each_line ([&] (const std::string_view line) {
+                recs += parse_text_record (line, epoch, lvl, msg);
+                g_sink = g_sink + msg.size ();
+            });
+        }
+        return recs;
+    });
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "logger/stats.hpp"
+#include "logger/utils.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace logger;
+
+int main (int argc, char** argv) {
+    const std::uint64_t per_thread = argc > 1 ? std::stoull (argv[1]) : 2'000'000ull;
+    const unsigned max_threads     = argc > 2 ? static_cast<unsigned> (std::stoul (argv[2])) : 8u;
+    // Realistic text: a handful of templates with varying numbers in them.
+    std::vector<std::string> msgs;
+    for (unsigned i = 0; i < 256; ++i)
+        msgs.push_back (i % 4 == 0 ? "request " + std::to_string (i * 7919) + " took " + std::to_string (i % 90) + " ms" :
+        i % 4 == 1 ? "cache miss for key user:" + std::to_string (i * 31) + " on shard " + std::to_string (i % 8) :
+        i % 4 == 2 ? "connection 0x" + std::to_string (i * 104729) + " reset by peer, retry " + std::to_string (i % 3) :
+                     "flushed " + std::to_string (i * 13) + " bytes to segment " + std::to_string (i));
+    for (const bool text : { false, true }) {
+        std::printf ("StatsCollector::add (%s), %llu records per thread\n", text ? "message text: templates, distinct counts" : "length only",
+        static_cast<unsigned long long> (per_thread));
+        for (unsigned n = 1; n <= max_threads; n *= 2) {
+            StatsCollector stats;
+            const std::uint64_t now = now_epoch_ms ();
+            std::vector<std::thread> threads;
+            const auto t0 = std::chrono::steady_clock::now ();
+            for (unsigned t = 0; t < n; ++t)
+                threads.emplace_back ([&stats, &msgs, text, now, per_thread] {
+                    for (std::uint64_t i = 0; i < per_thread; ++i) {
+                        const std::string& m = msgs[i & 255];
+                        if (text)
+                            stats.add (now, static_cast<LogLevel> (i % 3), std::string_view (m));
+                        else
+                            stats.add (now, static_cast<LogLevel> (i % 3), m.size ());
+                    }
+                });
+            for (auto& th : threads)
+                th.join ();
+            const double secs = std::chrono::duration<double> (std::chrono::steady_clock::now () - t0).count ();
+            const double recs = static_cast<double> (per_thread) * n;
+            std::printf ("%2u threads  %8.2f Mrec/s  %7.1f ns/rec/thread\n", n, recs / secs / 1e6, secs * 1e9 * n / recs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "logger/utils.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+using namespace logger;
+
+namespace {
+volatile std::size_t g_sink = 0;
+
+template <class F> double ns_per_op (const char* name, const std::uint64_t iters, F&& f) {
+    const auto t0 = std::chrono::steady_clock::now ();
+    for (std::uint64_t i = 0; i < iters; ++i)
+        f (i);
+    const auto t1  = std::chrono::steady_clock::now ();
+    const double ns = std::chrono::duration<double, std::nano> (t1 - t0).count () / static_cast<double> (iters);
+    std::printf ("%-34s %8.2f ns/op\n", name, ns);
+    return ns;
+}
+} // namespace
+
+int main (int argc, char** argv) {
+    const std::uint64_t iters = argc > 1 ? std::stoull (argv[1]) : 5'000'000ull;
+    // 2 us apart ~ 500k lines/sec, so each second repeats ~500k times.
+    const std::uint64_t base_us = 1'724'054'876'881'000ull;
+    std::printf ("%llu timestamps, 2 us apart\n", static_cast<unsigned long long> (iters));
+
+    const double old_ns = ns_per_op ("iso8601_utc (std::string)", iters, [&] (const std::uint64_t i) {
+        g_sink = g_sink + iso8601_utc ((base_us + 2 * i) / 1000ull).size ();
+    });
+    ns_per_op ("format_iso8601_utc (gmtime_r)", iters, [&] (const std::uint64_t i) {
+        char buf[kIso8601Len];
+        g_sink = g_sink + format_iso8601_utc ((base_us + 2 * i) / 1000ull, buf);
+    });
+    for (const auto& [name, prec] : { std::pair{ "TimestampFormatter seconds", TimePrecision::Seconds },
+         std::pair{ "TimestampFormatter millis", TimePrecision::Millis },
+         std::pair{ "TimestampFormatter micros", TimePrecision::Micros } }) {
+        TimestampFormatter tf (prec);
+        const double ns = ns_per_op (name, iters, [&] (const std::uint64_t i) {
+            char buf[kIso8601MaxLen];
+            g_sink = g_sink + tf.format_us (base_us + 2 * i, buf);
+        });
+        std::printf ("%-34s %8.1fx\n", "  speedup vs iso8601_utc", old_ns / ns);
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+#pragma once
+/**
+ * @file
+ * @brief Deferred-formatting binary log writer and its decoder.
+ */
+
+#include "log_level.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace logger {
+/**
+ * @brief On-disk layout (native little-endian byte order).
+ * @details File = 8-byte magic, then records introduced by a type byte:
+ * - 'F': u32 id, u16 len, format text  (emitted once per id per file)
+ * - 'L': u64 epoch_ms, u8 level, u32 format id, u16 args_len, args
+ *
+ * Each argument is a tag byte followed by its raw bytes: 'i' int64,
+ * 'u' uint64, 'd' double, 's' u16 length + bytes. Formats use "{}"
+ * placeholders, filled in order by @ref decode_binary_log. Records of
+ * format id @ref binlog::kUnregistered carry no 'F' record; their first
+ * argument is the format text instead.
+ */
+namespace binlog {
+constexpr char kMagic[8]              = { 'L', 'O', 'G', 'B', 'I', 'N', '0', '1' };
+constexpr char kFormatRecord          = 'F';
+constexpr char kLogRecord             = 'L';
+constexpr std::size_t kMaxRecord      = 4096;
+constexpr std::size_t kLogHeaderBytes = 1 + 8 + 1 + 4 + 2;
+/** @brief Id of records whose format could not be interned (text travels as the first argument). */
+constexpr std::uint32_t kUnregistered = 0xFFFFFFFF;
+
+/**
+ * @brief Intern @p fmt in the process-wide format table.
+ * @return Stable id for this process; equal text yields the same id.
+ * @ref kUnregistered if the table could not grow.
+ */
+std::uint32_t register_format (std::string_view fmt) noexcept;
+
+/** @brief Text of a registered format (empty if unknown). */
+std::string_view format_text (std::uint32_t id) noexcept;
+
+/** @brief Append one tagged argument; returns false if it does not fit. */
+inline bool put_raw (char* buf, std::size_t& pos, const char tag, const void* p, const std::size_t n) noexcept {
+    if (pos + 1 + n > kMaxRecord)
+        return false;
+    buf[pos++] = tag;
+    std::memcpy (buf + pos, p, n);
+    pos += n;
+    return true;
+}
+
+inline bool put_str (char* buf, std::size_t& pos, const std::string_view s) noexcept {
+    if (pos + 3 > kMaxRecord)
+        return false;
+    const auto len = static_cast<std::uint16_t> (std::min (s.size (), kMaxRecord - pos - 3));
+    buf[pos++]     = 's';
+    std::memcpy (buf + pos, &len, 2);
+    std::memcpy (buf + pos + 2, s.data (), len);
+    pos += 2u + len;
+    return true;
+}
+
+template <class T> bool put_arg (char* buf, std::size_t& pos, const T& v) noexcept {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool>) {
+        const std::uint64_t u = v ? 1 : 0;
+        return put_raw (buf, pos, 'u', &u, 8);
+    } else if constexpr (std::is_same_v<D, char>) {
+        return put_str (buf, pos, std::string_view (&v, 1));
+    } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+        const auto i = static_cast<std::int64_t> (v);
+        return put_raw (buf, pos, 'i', &i, 8);
+    } else if constexpr (std::is_integral_v<D> || std::is_enum_v<D>) {
+        const auto u = static_cast<std::uint64_t> (v);
+        return put_raw (buf, pos, 'u', &u, 8);
+    } else if constexpr (std::is_floating_point_v<D>) {
+        const auto d = static_cast<double> (v);
+        return put_raw (buf, pos, 'd', &d, 8);
+    } else {
+        return put_str (buf, pos, std::string_view (v));
+    }
+}
+} // namespace binlog
+
+/**
+ * @brief Logger that stores a format id and raw argument bytes per record.
+ * @details No text formatting, timestamp rendering or snprintf happens on
+ * the calling thread: a record is encoded on the stack and memcpy'd into a
+ * buffer that is written to the file when full or on @ref flush. Use the
+ * offline `log_decode` tool (or @ref decode_binary_log) to get the text
+ * format that @ref FileSink produces.
+ */
+class BinaryLogger {
+    public:
+    /**
+     * @brief Open (append) @p path, writing the magic if the file is new.
+     * @param path Target file.
+     * @param default_level Minimum level to pass through.
+     * @param buffer_bytes Size of the in-memory buffer before a write(2).
+     * @note Never throws. Check @ref is_open().
+     */
+    BinaryLogger (const std::string& path, LogLevel default_level, std::size_t buffer_bytes = 64 * 1024) noexcept;
+
+    /** @brief Flush and close. */
+    ~BinaryLogger ();
+
+    BinaryLogger (const BinaryLogger&)            = delete;
+    BinaryLogger& operator= (const BinaryLogger&) = delete;
+
+    /** @brief Whether the file is open. */
+    bool is_open () const noexcept {
+        return _fd != -1;
+    }
+
+    /** @brief Whether @p level passes the runtime threshold (one relaxed load). */
+    bool enabled (const LogLevel level) const noexcept {
+        return static_cast<int> (level) <= static_cast<int> (_default.load (std::memory_order_relaxed));
+    }
+
+    /** @brief Set/Get default severity threshold. */
+    void set_default_level (const LogLevel lvl) noexcept {
+        _default.store (lvl);
+    }
+    LogLevel default_level () const noexcept {
+        return _default.load ();
+    }
+
+    /**
+     * @brief Record one entry for format @p fmt_id.
+     * @param args Integers, floats, bools, chars or string-likes. Strings are
+     * truncated so the record stays within @ref binlog::kMaxRecord.
+     */
+    template <class... Args> Status log (const LogLevel level, const std::uint32_t fmt_id, const Args&... args) noexcept {
+        if (!enabled (level))
+            return Status::Filtered;
+        char rec[binlog::kMaxRecord];
+        std::size_t pos = binlog::kLogHeaderBytes;
+        (void)(binlog::put_arg (rec, pos, args) && ...);
+        const std::uint64_t ts = now_epoch_ms ();
+        const auto lvl         = static_cast<std::uint8_t> (level);
+        const auto args_len    = static_cast<std::uint16_t> (pos - binlog::kLogHeaderBytes);
+        rec[0]                 = binlog::kLogRecord;
+        std::memcpy (rec + 1, &ts, 8);
+        std::memcpy (rec + 9, &lvl, 1);
+        std::memcpy (rec + 10, &fmt_id, 4);
+        std::memcpy (rec + 14, &args_len, 2);
+        return append (fmt_id, rec, pos);
+    }
+
+    /**
+     * @brief Helper for @ref LOGGER_BIN: resolve the call site's id via @p id_of.
+     * @details If the format could not be registered the record is written
+     * under @ref binlog::kUnregistered with @p fmt as its first argument.
+     */
+    template <class IdOf, class... Args>
+    Status log_static (IdOf id_of, const LogLevel level, const std::string_view fmt, const Args&... args) noexcept {
+        const std::uint32_t id = id_of (fmt);
+        if (id == binlog::kUnregistered)
+            return log (level, id, fmt, args...);
+        return log (level, id, args...);
+    }
+
+    /** @brief Last I/O error text (thread-safe). */
+    std::string last_error () const;
+
+    /** @brief Write buffered records to the file. */
+    void flush () noexcept;
+
+    private:
+    Status append (std::uint32_t fmt_id, const char* rec, std::size_t len) noexcept;
+    bool emit_format (std::uint32_t fmt_id) noexcept;
+    bool drain (std::string& err) noexcept;
+
+    int _fd{ -1 };                  ///< Output file or -1.
+    std::atomic<LogLevel> _default; ///< Current threshold.
+    std::vector<char> _buf;         ///< Pending bytes (size fixed at construction).
+    std::size_t _used{ 0 };         ///< Bytes of @ref _buf in use.
+    std::vector<bool> _emitted;     ///< Format ids already written to this file.
+    mutable std::mutex _mu;         ///< Guards everything above except @ref _default.
+    std::string _last_err;          ///< Last I/O error message.
+};
+
+/**
+ * @brief Convert a binary log back to FileSink text lines.
+ * @param in Binary log stream (opened in binary mode).
+ * @param out Receives "YYYY-MM-DDTHH:MM:SSZ LEVEL message\n" lines.
+ * @param err Error text on failure.
+ * @return true if the whole stream decoded; false on a bad magic or
+ * malformed record (lines before it are still written).
+ */
+bool decode_binary_log (std::istream& in, std::ostream& out, std::string& err);
+} // namespace logger
+
+/**
+ * @brief Binary-log a call site: the format literal is interned once per
+ * call site (retried while registration fails) and nothing is encoded when
+ * the level is filtered.
+ * @details Example: `LOGGER_BIN (blog, logger::LogLevel::Info, "req {} took {} ms", id, ms);`
+ */
+#define LOGGER_BIN(blg, lvl, ...)                                                                           \
+    ((blg).enabled (lvl) ?                                                                                  \
+     (blg).log_static (                                                                                     \
+     [] (std::string_view logger_fmt_) noexcept {                                                           \
+         static std::atomic<std::uint32_t> logger_fmt_id_{ ::logger::binlog::kUnregistered };              \
+         std::uint32_t id_ = logger_fmt_id_.load (std::memory_order_relaxed);                               \
+         if (id_ == ::logger::binlog::kUnregistered) {                                                      \
+             id_ = ::logger::binlog::register_format (logger_fmt_);                                         \
+             logger_fmt_id_.store (id_, std::memory_order_relaxed);                                         \
+         }                                                                                                  \
+         return id_;                                                                                        \
+     },                                                                                                     \
+     lvl, __VA_ARGS__) :                                                                                    \
+     ::logger::Status::Filtered)
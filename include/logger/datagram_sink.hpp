@@ -0,0 +1,102 @@
+#pragma once
+/**
+ * @file
+ * @brief UDP and Unix-domain datagram log sink.
+ */
+
+#include "log_sink.hpp"
+#include "socket_sink.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace logger {
+/**
+ * @brief Sends one record per datagram to a UDP or AF_UNIX datagram socket.
+ * @details Every datagram carries one wire line, "epoch_ms|LEVEL|message\n",
+ * the same format @ref SocketSink streams. @ref write_batch hands a whole
+ * run of records to the kernel with one sendmmsg call (up to 1024 each).
+ *
+ * Delivery is best effort and there is no backlog. UDP sends never block:
+ * when the socket buffer is full (EAGAIN) the rest of the call is lost.
+ * AF_UNIX sends wait for the receiver, whose queue holds only a handful of
+ * datagrams (net.unix.max_dgram_qlen), but at most @ref kUnixSendTimeout
+ * per call; then the rest is lost too. Lost records are counted in
+ * @ref dropped. Messages are cut so a datagram fits in @ref kMaxDatagram
+ * bytes.
+ */
+class DatagramSink final : public ILogSink {
+    public:
+    /** @brief Largest datagram sent (the UDP/IPv4 payload limit). */
+    static constexpr std::size_t kMaxDatagram = 65507;
+    /** @brief Longest an AF_UNIX send waits for room in the receiver's queue. */
+    static constexpr std::chrono::milliseconds kUnixSendTimeout{ 100 };
+
+    /**
+     * @brief Create sink sending UDP datagrams to @p host:@p port.
+     * @note Never throws; the socket is opened on first use.
+     */
+    DatagramSink (std::string host, std::uint16_t port) noexcept;
+
+    /**
+     * @brief Create sink sending to the AF_UNIX datagram socket at @p path.
+     * @note Never throws; the socket is opened on first use.
+     */
+    explicit DatagramSink (UnixPath path) noexcept;
+
+    /** @brief Close the socket. */
+    ~DatagramSink () override;
+
+    /**
+     * @brief Send one entry as one datagram.
+     * @return true if the kernel accepted it.
+     */
+    bool write (const LogEntry& e, std::string& err) noexcept override;
+
+    /** @copydoc write */
+    bool write_view (const LogEntryView& e, std::string& err) noexcept override;
+
+    /**
+     * @brief Send a run of entries with sendmmsg, one datagram each.
+     * @return Number of leading entries the kernel accepted.
+     */
+    std::size_t write_batch (const LogEntry* entries, std::size_t count, std::string& err) noexcept override;
+
+    /** @brief No-op: datagrams are not buffered. */
+    void flush () noexcept override {
+    }
+
+    /** @brief Records not accepted by the kernel since construction. */
+    std::uint64_t dropped () const noexcept {
+        return _dropped.load (std::memory_order_relaxed);
+    }
+
+    private:
+    /** @brief Open and connect the socket if needed (caller holds @ref _mu). */
+    bool open_locked (std::string& err) noexcept;
+    /** @brief Append one wire line to @ref _buf. */
+    void append_locked (std::uint64_t epoch_ms, LogLevel level, std::string_view msg);
+    /** @brief Send the first @p count lines of @ref _buf; returns how many went out. */
+    std::size_t send_locked (std::size_t count, std::string& err) noexcept;
+
+    int _fd{ -1 };                  ///< Connected datagram socket or -1.
+    std::string _host;              ///< UDP host.
+    std::uint16_t _port{ 0 };       ///< UDP port.
+    std::string _unix_path;         ///< AF_UNIX path (empty for UDP).
+    std::mutex _mu;                 ///< Guards everything below.
+    std::string _buf;               ///< Wire lines of the current call.
+    std::vector<std::size_t> _ends; ///< End offset of each line in @ref _buf.
+    std::vector<iovec> _iov;        ///< One iovec per datagram.
+    std::vector<mmsghdr> _msgs;     ///< sendmmsg vector.
+
+    std::atomic<std::uint64_t> _dropped{ 0 }; ///< See @ref dropped (added under @ref _mu).
+};
+} // namespace logger
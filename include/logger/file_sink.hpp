@@ -5,47 +5,202 @@
  */
 
 #include "log_sink.hpp"
-#include <fstream>
+#include "utils.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 
 namespace logger {
 /**
- * @brief Log sink that writes entries to a file.
- * @details Uses a mutex to serialize writes across threads.
+ * @brief Buffering and flush policy of a @ref FileSink.
+ * @details Defaults behave like the former std::ofstream backend: an 8 KiB
+ * buffer written out when full or on flush().
+ */
+struct FileSinkOptions {
+    /** @brief User-space buffer size; a write(2) is issued when it fills. */
+    std::size_t buffer_bytes{ 8192 };
+    /** @brief Upper bound on how long bytes stay buffered (0 = no timer). */
+    std::chrono::milliseconds flush_interval{ 0 };
+    /** @brief Write the buffer out right after an ERROR record. */
+    bool flush_on_error{ false };
+
+    /** @brief Rotate before the file would exceed this many bytes (0 = never). */
+    std::uint64_t rotate_bytes{ 0 };
+    /**
+     * @brief Rotate at multiples of this interval since the Unix epoch, judged
+     * by record timestamps (e.g. 1h rotates on the hour, UTC). 0 = never.
+     */
+    std::chrono::seconds rotate_interval{ 0 };
+    /**
+     * @brief Name of a rotated file. "{path}" is the live path, "{n}" a
+     * sequence number and "{time}" the UTC rotation time (YYYYMMDDTHHMMSS).
+     */
+    std::string rotate_pattern{ "{path}.{n}" };
+    /** @brief Keep at most this many rotated files, oldest deleted first (0 = all). */
+    std::size_t max_files{ 0 };
+    /** @brief gzip rotated files (".gz" suffix); needs zlib at build time. */
+    bool compress{ false };
+
+    /**
+     * @brief Write full buffers through io_uring instead of write(2).
+     * @details The writing thread queues the buffer and carries on in the
+     * next one; it waits only when all @ref uring_buffers are still in
+     * flight. Without io_uring support (old kernel, disabled by sysctl or
+     * seccomp, buffer registration refused) the sink silently stays on
+     * write(2); see FileSink::uses_io_uring().
+     */
+    bool io_uring{ false };
+    /** @brief Buffers of @ref buffer_bytes registered with io_uring (at least 2). */
+    std::size_t uring_buffers{ 4 };
+};
+
+/**
+ * @brief Log sink that appends entries to a file.
+ * @details Lines are formatted into a user-space buffer and written to an
+ * O_APPEND descriptor when the buffer fills, when
+ * @ref FileSinkOptions::flush_interval elapses (background timer), after an
+ * ERROR record if requested, or on @ref flush. A mutex serializes writers.
+ *
+ * With rotation enabled the writing thread only closes the file, renames
+ * it (one metadata syscall) and reopens the path; compression and
+ * retention run on a background housekeeping thread. If compression fails
+ * the rotated file is kept uncompressed. If the rename or the reopen fails
+ * (missing target directory, EXDEV, EMFILE, ...) lines keep going to the
+ * current file, the failure is reported once by the next write and
+ * rotation is retried after a backoff doubling from 1 s to 1 min.
+ *
+ * With @ref FileSinkOptions::io_uring a full buffer becomes a
+ * WRITE_FIXED request on a registered buffer, executed by a kernel worker,
+ * so page-cache writeback never stalls the thread holding the mutex.
+ * Requests carry explicit offsets and therefore land in order; the file is
+ * assumed to be appended to by this sink only. flush(), flush_on_error,
+ * rotation and lines larger than the buffer wait for queued writes to finish.
+ *
+ * Failures of background writes (flush timer, io_uring completions) are
+ * reported by the next write() or write_batch(), whose own entries are
+ * still buffered. A failed write(2) keeps the unwritten bytes buffered for
+ * the next attempt; bytes of failed io_uring requests cannot be requeued
+ * once their buffer is reused and are counted in @ref lost_bytes; the next
+ * offsets are then taken from the file size. If the io_uring descriptor
+ * cannot be reopened after a rotation the sink continues with write(2).
  */
 class FileSink final : public ILogSink {
     public:
     /**
      * @brief Construct and attempt to open @p path.
      * @param path Target file path.
+     * @param opts Buffer size and flush policy.
      * @note Never throws (noexcept). Check @ref is_open().
      */
-    explicit FileSink (const std::string& path) noexcept;
+    explicit FileSink (const std::string& path, FileSinkOptions opts = {}) noexcept;
 
-    /** @brief Close the stream if open. */
+    /** @brief Flush buffered bytes and close the file. */
     ~FileSink () override;
 
     /**
      * @brief Write one log entry.
      * @param e Log entry to write.
      * @param err Error message on failure.
-     * @return true on success, false on I/O error.
+     * @return true on success, false on I/O error. false with @p err set by
+     * an earlier background write still buffers @p e.
      * @note Thread-safe.
      */
     bool write (const LogEntry& e, std::string& err) noexcept override;
 
-    /** @brief Flush the underlying stream. */
+    /**
+     * @brief Write one borrowed entry without heap allocation.
+     * @note Thread-safe.
+     */
+    bool write_view (const LogEntryView& e, std::string& err) noexcept override;
+
+    /**
+     * @brief Write a run of entries under one lock.
+     * @details Lines go straight into the buffer, so a batch costs one
+     * write(2) per filled buffer. A failure of an earlier background write
+     * is reported in @p err even when all entries were buffered.
+     * @note Thread-safe.
+     */
+    std::size_t write_batch (const LogEntry* entries, std::size_t count, std::string& err) noexcept override;
+
+    /** @brief Write out everything buffered. */
     void flush () noexcept override;
 
-    /** @brief Whether the file stream is open. */
+    /** @brief Whether the file is open. */
     bool is_open () const noexcept {
-        return _ofs.is_open ();
+        return _fd != -1;
+    }
+
+    /** @brief Whether buffers are written through io_uring (see @ref FileSinkOptions::io_uring). */
+    bool uses_io_uring () const noexcept {
+        return _uring != nullptr;
+    }
+
+    /** @brief Bytes dropped by failed io_uring writes since construction. */
+    std::uint64_t lost_bytes () const noexcept {
+        return _lost_bytes.load (std::memory_order_relaxed);
     }
 
     private:
-    /** @brief Owned output stream. */
-    std::ofstream _ofs;
-    /** @brief Guards stream operations. */
-    std::mutex _mu;
+    struct Uring;
+
+
+    /** @brief Format one line into the buffer (caller holds @ref _mu). */
+    bool append_locked (std::uint64_t epoch_ms, LogLevel level, std::string_view msg, std::string& err) noexcept;
+    /** @brief Write the buffer to the file, or queue it with io_uring (caller holds @ref _mu). */
+    bool drain_locked (std::string& err) noexcept;
+    /** @brief Drain and wait until queued writes are in the file (caller holds @ref _mu). */
+    bool flush_locked (std::string& err) noexcept;
+    /** @brief After failed io_uring writes: count the loss and realign @ref _file_bytes (caller holds @ref _mu). */
+    void settle_uring_locked (std::string& err) noexcept;
+    /** @brief Set @ref _file_bytes to the size of the open file (caller holds @ref _mu). */
+    void sync_file_bytes_locked () noexcept;
+    /** @brief Move a pending background failure into @p err; false if there is none. */
+    bool take_deferred_locked (std::string& err) noexcept;
+    /** @brief Background loop for @ref FileSinkOptions::flush_interval. */
+    void flusher_loop () noexcept;
+    /** @brief Whether a line of @p need bytes stamped @p epoch_ms must go to a new file. */
+    bool should_rotate (std::uint64_t epoch_ms, std::size_t need) noexcept;
+    /** @brief Close, rename and reopen the live file (caller holds @ref _mu). */
+    bool rotate_locked (std::string& err) noexcept;
+    /** @brief Schedule a retry after a failed rotation at @p epoch_ms; reports @p err once. */
+    void rotate_failed_locked (std::uint64_t epoch_ms, std::string& err) noexcept;
+    /** @brief Compress and prune rotated files off the writing thread; @p kept lists older ones. */
+    void housekeeper_loop (std::deque<std::string> kept) noexcept;
+
+    FileSinkOptions _opts;                 ///< Buffer/flush/rotation policy.
+    std::string _path;                     ///< Live file path.
+    int _fd{ -1 };                         ///< O_APPEND descriptor or -1.
+    std::uint64_t _file_bytes{ 0 };        ///< Bytes already in the live file.
+    std::uint64_t _rotate_at_ms{ 0 };      ///< Next interval boundary (0 = not yet known).
+    std::uint64_t _seq{ 1 };               ///< Next "{n}" candidate.
+    std::uint64_t _rotate_retry_ms{ 0 };   ///< No rotation attempt before this record time.
+    std::uint64_t _rotate_backoff_ms{ 0 }; ///< Current retry delay (0 = last rotation succeeded).
+    std::string _rotated;                  ///< Renamed file whose path is not reopened yet.
+    std::unique_ptr<char[]> _mem;          ///< One buffer, or uring_buffers of them.
+    std::unique_ptr<Uring> _uring;         ///< io_uring state, or null for write(2).
+    char* _buf{ nullptr };                 ///< Buffer being filled (part of @ref _mem).
+    std::size_t _cap{ 0 };                 ///< Size of each buffer.
+    std::size_t _used{ 0 };                ///< Bytes of @ref _buf in use.
+    std::string _deferred_err;             ///< Background flush failure, reported by the next write.
+    TimestampFormatter _ts;                ///< Cached timestamp renderer.
+    std::mutex _mu;                        ///< Guards everything above.
+    bool _stop{ false };                   ///< Tells the flusher to exit (guarded by @ref _mu).
+    std::condition_variable _cv;           ///< Wakes the flusher early on shutdown.
+    std::thread _flusher;                  ///< Runs only if flush_interval > 0.
+
+    std::mutex _hk_mu;                ///< Guards the housekeeping queue.
+    std::condition_variable _hk_cv;   ///< Wakes the housekeeper.
+    std::deque<std::string> _closed;  ///< Rotated files awaiting compression/retention.
+    bool _hk_stop{ false };           ///< Tells the housekeeper to finish (guarded by @ref _hk_mu).
+    std::thread _housekeeper;         ///< Runs only if compress or max_files is set.
+
+    std::atomic<std::uint64_t> _lost_bytes{ 0 }; ///< See @ref lost_bytes (added under @ref _mu).
 };
 } // namespace logger
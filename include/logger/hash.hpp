@@ -0,0 +1,66 @@
+#pragma once
+/**
+ * @file
+ * @brief Fast non-cryptographic hash of byte strings.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace logger {
+namespace detail {
+inline std::uint64_t load64 (const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy (&v, p, sizeof (v));
+    return v;
+}
+
+inline std::uint64_t load32 (const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy (&v, p, sizeof (v));
+    return v;
+}
+
+__extension__ typedef unsigned __int128 uint128; // GCC/Clang builtin; silences -Wpedantic
+
+/** @brief Fold the 128-bit product of @p a and @p b into 64 bits. */
+inline std::uint64_t mix (const std::uint64_t a, const std::uint64_t b) noexcept {
+    const uint128 r = static_cast<uint128> (a) * b;
+    return static_cast<std::uint64_t> (r) ^ static_cast<std::uint64_t> (r >> 64);
+}
+} // namespace detail
+
+/**
+ * @brief 64-bit hash of @p n bytes at @p data.
+ * @details Multiply-fold construction in the style of wyhash: 16 bytes per
+ * 64x64->128 multiply, and strings up to 16 bytes are read with at most
+ * four overlapping loads and no loop. All output bits are well mixed, so
+ * any slice of them can serve as a table index. Not stable across
+ * byte orders, and not meant to resist crafted collisions.
+ */
+inline std::uint64_t hash_bytes (const void* data, const std::size_t n, const std::uint64_t seed = 0) noexcept {
+    constexpr std::uint64_t k0 = 0xa0761d6478bd642full;
+    constexpr std::uint64_t k1 = 0xe7037ed1a0b428dbull;
+    const auto* p              = static_cast<const unsigned char*> (data);
+    std::uint64_t h            = seed ^ detail::mix (seed ^ k0, k1);
+    std::uint64_t a = 0, b = 0;
+    if (n <= 16) {
+        if (n >= 4) {
+            const std::size_t mid = (n >> 3) << 2;
+            a = (detail::load32 (p) << 32) | detail::load32 (p + mid);
+            b = (detail::load32 (p + n - 4) << 32) | detail::load32 (p + n - 4 - mid);
+        } else if (n > 0) {
+            a = (std::uint64_t{ p[0] } << 16) | (std::uint64_t{ p[n >> 1] } << 8) | p[n - 1];
+        }
+    } else {
+        std::size_t left = n;
+        for (; left > 16; left -= 16, p += 16)
+            h = detail::mix (detail::load64 (p) ^ k1, detail::load64 (p + 8) ^ h);
+        // The last 16 bytes, overlapping the final block if needed.
+        a = detail::load64 (p + left - 16);
+        b = detail::load64 (p + left - 8);
+    }
+    return detail::mix (k1 ^ n, detail::mix (a ^ k1, b ^ h));
+}
+} // namespace logger
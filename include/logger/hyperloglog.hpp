@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * @file
+ * @brief HyperLogLog estimate of the number of distinct items.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace logger {
+/**
+ * @brief Distinct-count sketch over 64-bit hashes (HyperLogLog).
+ * @details 2^@ref kPrecision one-byte registers (4 KiB). The top
+ * @ref kPrecision bits of a hash pick a register, which keeps the largest
+ * rank (leading zeros + 1) of the remaining bits. The standard error is
+ * 1.04 / sqrt(@ref kRegisters), about 1.6%; small counts switch to linear
+ * counting of empty registers. Sketches merge exactly (register-wise max),
+ * so the union of shards or of time slices costs no extra error. Hashes
+ * must be well mixed, e.g. from hash_bytes.
+ */
+class HyperLogLog {
+    public:
+    static constexpr unsigned kPrecision    = 12;
+    static constexpr std::size_t kRegisters = std::size_t{ 1 } << kPrecision;
+    static constexpr std::uint8_t kMaxRank  = 64 - kPrecision + 1;
+
+    /** @brief Register of @p hash. */
+    static std::size_t index (const std::uint64_t hash) noexcept {
+        return static_cast<std::size_t> (hash >> (64 - kPrecision));
+    }
+
+    /** @brief Rank of @p hash: leading zeros after the index bits, plus one (1..@ref kMaxRank). */
+    static std::uint8_t rank (const std::uint64_t hash) noexcept {
+        // The guard bit caps the count when the remaining bits are all zero.
+        return static_cast<std::uint8_t> (__builtin_clzll ((hash << kPrecision) | (std::uint64_t{ 1 } << (kPrecision - 1))) + 1);
+    }
+
+    /** @brief Count the item with hash @p hash. */
+    void add (const std::uint64_t hash) noexcept {
+        raise (index (hash), rank (hash));
+    }
+
+    /** @brief Set register @p i to at least @p r (for rebuilding from raw registers). */
+    void raise (const std::size_t i, const std::uint8_t r) noexcept {
+        if (r > _reg[i])
+            _reg[i] = r;
+    }
+
+    /** @brief Union with @p other. */
+    void merge (const HyperLogLog& other) noexcept;
+
+    /** @brief Estimated number of distinct hashes added. */
+    std::uint64_t estimate () const noexcept;
+
+    private:
+    std::uint8_t _reg[kRegisters]{};
+};
+} // namespace logger
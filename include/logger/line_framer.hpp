@@ -0,0 +1,174 @@
+#pragma once
+/**
+ * @file
+ * @brief Vectorized byte search, text record parsing and a reusable line buffer.
+ */
+
+#include "log_level.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace logger {
+/** @brief Instruction set used by @ref find_byte. */
+enum class SimdLevel {
+    Generic, ///< memchr.
+    Sse2,    ///< 16 bytes per compare.
+    Avx2     ///< 32 bytes per compare, two compares per iteration.
+};
+
+/** @brief Best level this CPU supports (detected once). */
+SimdLevel detected_simd_level () noexcept;
+
+/** @brief Whether @p level can run on this CPU. */
+bool simd_supported (SimdLevel level) noexcept;
+
+/** @brief First @p c in [@p p, @p end), or @p end; uses @ref detected_simd_level. */
+const char* find_byte (const char* p, const char* end, char c) noexcept;
+
+/** @brief Same as @ref find_byte with an explicit (supported) @p level. */
+const char* find_byte (const char* p, const char* end, char c, SimdLevel level) noexcept;
+
+/**
+ * @brief Record offsets of every '\n' and '|' in @p n bytes at @p p.
+ * @details Works a 64-byte block at a time (one compare mask per block) and
+ * stops at a block boundary once fewer than 64 of @p max_out slots remain.
+ * @param scanned Bytes examined; every delimiter among them is in @p out.
+ * @return Offsets written, ascending.
+ */
+std::size_t index_delimiters (const char* p, std::size_t n, std::uint32_t* out, std::size_t max_out, std::size_t& scanned) noexcept;
+
+/** @brief Same as @ref index_delimiters with an explicit (supported) @p level. */
+std::size_t index_delimiters (const char* p,
+std::size_t n,
+std::uint32_t* out,
+std::size_t max_out,
+std::size_t& scanned,
+SimdLevel level) noexcept;
+
+/**
+ * @brief Parse the fields of a text line whose first two '|' are at @p bar1 and @p bar2.
+ * @return false if the timestamp or level is malformed.
+ */
+bool parse_text_fields (std::string_view line, std::size_t bar1, std::size_t bar2, std::uint64_t& epoch_ms, LogLevel& level, std::string_view& msg) noexcept;
+
+/**
+ * @brief Parse one text wire line ("epoch_ms|LEVEL|message", no '\n').
+ * @details LEVEL is INFO, WARN or ERROR in any case; a trailing '\r' is
+ * dropped. Nothing is copied: @p msg points into @p line.
+ * @return false if the line is malformed.
+ */
+bool parse_text_record (std::string_view line, std::uint64_t& epoch_ms, LogLevel& level, std::string_view& msg) noexcept;
+
+/**
+ * @brief Receive buffer that hands out complete lines as views.
+ * @details Bytes are received straight into the buffer (@ref reserve /
+ * @ref commit) and lines are returned in place, so framing costs no copy
+ * or allocation per line. @ref for_each_record finds all delimiters with
+ * one vectorized pass (@ref index_delimiters) instead of a search per line.
+ * Consumed space is reclaimed lazily: the unconsumed tail is moved to the
+ * front only when a receive would not fit, and the buffer grows only for a
+ * line longer than its capacity.
+ */
+class LineFramer {
+    public:
+    LineFramer () noexcept = default;
+
+    /** @param capacity Initial size, allocated on first @ref reserve. */
+    explicit LineFramer (const std::size_t capacity) noexcept : _cap (capacity) {
+    }
+
+    /**
+     * @brief Make room for at least @p min bytes.
+     * @return Write position; @ref room bytes are available there.
+     */
+    char* reserve (std::size_t min);
+
+    /** @brief Free bytes after @ref reserve. */
+    std::size_t room () const noexcept {
+        return _cap - _tail;
+    }
+
+    /** @brief Mark @p n received bytes as valid. */
+    void commit (const std::size_t n) noexcept {
+        _tail += n;
+    }
+
+    /** @brief Bytes received but not consumed. */
+    std::string_view pending () const noexcept {
+        return { _buf.get () + _head, _tail - _head };
+    }
+
+    /** @brief Drop the first @p n pending bytes. */
+    void consume (const std::size_t n) noexcept {
+        _head += n;
+        if (_head == _tail)
+            _head = _tail = 0;
+    }
+
+    /**
+     * @brief Call @p on_line with every complete pending line (without '\n') and consume them.
+     * @return Number of lines.
+     */
+    template <class F> std::size_t for_each_line (F&& on_line) {
+        const char* const base = _buf.get ();
+        const char* p          = base + _head;
+        const char* const end  = base + _tail;
+        std::size_t lines      = 0;
+        for (const char* nl; (nl = find_byte (p, end, '\n')) != end; p = nl + 1, ++lines)
+            on_line (std::string_view (p, static_cast<std::size_t> (nl - p)));
+        consume (static_cast<std::size_t> (p - (base + _head)));
+        return lines;
+    }
+
+    /**
+     * @brief Parse every complete pending line and consume them.
+     * @param on_record Called as on_record(epoch_ms, level, message) for each
+     * well-formed line; malformed lines are skipped.
+     * @return Number of well-formed records.
+     */
+    template <class F> std::size_t for_each_record (F&& on_record) {
+        if (!_index)
+            _index.reset (new std::uint32_t[kIndexSlots]);
+        const char* const base = _buf.get () + _head;
+        const std::size_t n    = _tail - _head;
+        std::size_t line = 0, bars = 0, records = 0;
+        std::size_t bar[2]{ 0, 0 };
+        for (std::size_t scanned = 0; scanned < n;) {
+            std::size_t step    = 0;
+            const std::size_t k = index_delimiters (base + scanned, n - scanned, _index.get (), kIndexSlots, step);
+            for (std::size_t i = 0; i < k; ++i) {
+                const std::size_t pos = scanned + _index[i];
+                if (base[pos] == '|') {
+                    if (bars < 2)
+                        bar[bars] = pos - line;
+                    ++bars;
+                    continue;
+                }
+                std::uint64_t epoch;
+                LogLevel level;
+                std::string_view msg;
+                if (bars >= 2 && parse_text_fields ({ base + line, pos - line }, bar[0], bar[1], epoch, level, msg)) {
+                    on_record (epoch, level, msg);
+                    ++records;
+                }
+                line = pos + 1;
+                bars = 0;
+            }
+            scanned += step;
+        }
+        consume (line);
+        return records;
+    }
+
+    private:
+    static constexpr std::size_t kIndexSlots = 1024;
+
+    std::unique_ptr<std::uint32_t[]> _index; ///< Delimiter offsets (null until first use).
+    std::unique_ptr<char[]> _buf;            ///< Storage (null until first reserve).
+    std::size_t _cap{ 16 * 1024 };           ///< Size of @ref _buf.
+    std::size_t _head{ 0 };                  ///< First unconsumed byte.
+    std::size_t _tail{ 0 };                  ///< End of received bytes.
+};
+} // namespace logger
@@ -1,12 +1,13 @@
 #pragma once
 /**
  * @file
- * @brief Basic log record type.
+ * @brief Basic log record types.
  */
 
 #include "log_level.hpp"
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace logger {
 /**
@@ -20,4 +21,18 @@ struct LogEntry {
     /** @brief Message payload (no trailing newline). */
     std::string message;
 };
+
+/**
+ * @brief Non-owning view of a log entry for the synchronous path.
+ * @details The message refers to the caller's buffer and is only valid for
+ * the duration of the sink call, so no copy or allocation is needed.
+ */
+struct LogEntryView {
+    /** @brief Timestamp since Unix epoch in milliseconds (UTC). */
+    std::uint64_t epoch_ms{ 0 };
+    /** @brief Severity level. */
+    LogLevel level{ LogLevel::Info };
+    /** @brief Message payload (no trailing newline). */
+    std::string_view message;
+};
 } // namespace logger
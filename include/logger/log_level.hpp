@@ -7,6 +7,15 @@
 #include <cstdint>
 #include <string_view>
 
+/**
+ * @brief Least severe level compiled into the program (0=ERROR, 1=WARN, 2=INFO).
+ * @details Define it (e.g. -DLOGGER_COMPILED_LEVEL=1) to strip less severe
+ * calls made through @ref Logger::log_lazy and the LOGGER_* macros.
+ */
+#ifndef LOGGER_COMPILED_LEVEL
+#define LOGGER_COMPILED_LEVEL 2
+#endif
+
 namespace logger {
 /**
  * @brief Severity levels (low index = higher severity).
@@ -17,6 +26,13 @@ enum class LogLevel : uint8_t {
     Info    = 2  ///< Informational messages.
 };
 
+/**
+ * @brief Whether calls at @p lvl survive @ref LOGGER_COMPILED_LEVEL.
+ */
+constexpr bool is_compiled_in (const LogLevel lvl) noexcept {
+    return static_cast<int> (lvl) <= LOGGER_COMPILED_LEVEL;
+}
+
 /**
  * @brief Canonical upper-case name for a level.
  * @return "ERROR", "WARN" or "INFO".
@@ -5,6 +5,7 @@
  */
 
 #include "log_entry.hpp"
+#include <cstddef>
 #include <string>
 
 namespace logger {
@@ -24,6 +25,40 @@ class ILogSink {
      */
     virtual bool write (const LogEntry& e, std::string& err) noexcept = 0;
 
+    /**
+     * @brief Write a borrowed entry without taking ownership of the message.
+     * @param e Entry view; only valid during the call.
+     * @param err Error message on failure.
+     * @return true on success, false on error.
+     * @note Default impl copies into a @ref LogEntry and calls @ref write;
+     * sinks override it to format straight from the view without allocating.
+     */
+    virtual bool write_view (const LogEntryView& e, std::string& err) noexcept {
+        LogEntry copy;
+        copy.epoch_ms = e.epoch_ms;
+        copy.level    = e.level;
+        copy.message.assign (e.message.data (), e.message.size ());
+        return write (copy, err);
+    }
+
+    /**
+     * @brief Write a contiguous run of entries.
+     * @param entries First entry.
+     * @param count Number of entries.
+     * @param err Error message on failure (last error seen). Sinks that
+     * write in the background may also set it with all entries accepted.
+     * @return Number of entries written; less than @p count on error.
+     * @note Default impl loops over @ref write; sinks override it to take
+     * their lock once and emit the whole run in one syscall.
+     */
+    virtual std::size_t write_batch (const LogEntry* entries, const std::size_t count, std::string& err) noexcept {
+        std::size_t ok = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            if (write (entries[i], err))
+                ++ok;
+        return ok;
+    }
+
     /**
      * @brief Flush buffered data (optional).
      * @note Default impl does nothing.
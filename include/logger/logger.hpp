@@ -1,15 +1,21 @@
 #pragma once
 /**
  * @file
- * @brief Core logger API: status codes, Logger facade, and sink factories.
+ * @brief Core logger API: status codes, Logger and AsyncLogger facades, and sink factories.
  */
 
 #include "log_level.hpp"
 #include "log_sink.hpp"
+#include "mpsc_ring.hpp"
 #include "utils.hpp"
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 namespace logger {
 /**
@@ -18,9 +24,30 @@ namespace logger {
 enum class Status {
     Ok,       ///< Entry accepted by sink.
     Filtered, ///< Dropped by level filter.
-    IoError   ///< Sink I/O failure (see @ref Logger::last_error()).
+    IoError,  ///< Sink I/O failure (see @ref Logger::last_error()).
+    Dropped   ///< Rejected by a full or stopped @ref AsyncLogger queue.
 };
 
+namespace detail {
+/** @brief Whether building a message with @p F cannot throw. */
+template <class F> constexpr bool make_noexcept = noexcept (std::string_view (std::declval<F> () ()));
+
+/** @brief Shared body of Logger::log_lazy and AsyncLogger::log_lazy. */
+template <class L, class F> Status log_lazy (L& lg, const LogLevel level, F&& make) noexcept (make_noexcept<F>) {
+    if (!is_compiled_in (level) || !lg.enabled (level))
+        return Status::Filtered;
+    return lg.log (level, std::string_view (std::forward<F> (make) ()));
+}
+
+/** @brief Compile-time-level form: calls of levels not compiled in vanish. */
+template <LogLevel Level, class L, class F> Status log_lazy (L& lg, F&& make) noexcept (make_noexcept<F>) {
+    if constexpr (!is_compiled_in (Level))
+        return Status::Filtered;
+    else
+        return log_lazy (lg, Level, std::forward<F> (make));
+}
+} // namespace detail
+
 /**
  * @brief Thread-safe logger with level filtering and pluggable sink.
  */
@@ -38,6 +65,8 @@ class Logger {
     /**
      * @brief Log a message with explicit level.
      * @return @ref Status of the operation.
+     * @note The message is passed to the sink as a @ref LogEntryView; with
+     * the built-in sinks the success path does not touch the heap.
      */
     Status log (LogLevel level, std::string_view msg) noexcept;
 
@@ -48,6 +77,31 @@ class Logger {
         return log (_default.load (), msg);
     }
 
+    /**
+     * @brief Whether @p level passes the runtime threshold (one relaxed load).
+     */
+    bool enabled (const LogLevel level) const noexcept {
+        return static_cast<int> (level) <= static_cast<int> (_default.load (std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Log a message built only if @p Level is compiled in and enabled.
+     * @param make Callable returning something convertible to std::string_view.
+     * @return Status::Filtered without invoking @p make when filtered.
+     * @throws Whatever @p make throws (e.g. std::bad_alloc building a std::string);
+     * noexcept when @p make is.
+     */
+    template <LogLevel Level, class F> Status log_lazy (F&& make) noexcept (detail::make_noexcept<F>) {
+        return detail::log_lazy<Level> (*this, std::forward<F> (make));
+    }
+
+    /**
+     * @brief Runtime-level variant of @ref log_lazy.
+     */
+    template <class F> Status log_lazy (const LogLevel level, F&& make) noexcept (detail::make_noexcept<F>) {
+        return detail::log_lazy (*this, level, std::forward<F> (make));
+    }
+
     /** @brief Set/Get default severity threshold. */
     void set_default_level (const LogLevel lvl) noexcept {
         _default.store (lvl);
@@ -74,15 +128,233 @@ class Logger {
     std::string _last_err;           ///< Last sink error message.
 };
 
+/**
+ * @brief What @ref AsyncLogger does when its ring is full.
+ */
+enum class OverflowPolicy {
+    Block,      ///< Wait until the consumer frees a slot (dropped once stop() is called).
+    DropNewest, ///< Reject the incoming record.
+    DropOldest  ///< Evict the oldest queued record to make room.
+};
+
+/**
+ * @brief Tuning knobs for @ref AsyncLogger.
+ */
+struct AsyncOptions {
+    /** @brief Ring slots (rounded up to a power of two). */
+    std::size_t capacity{ 8192 };
+    /** @brief Bytes preallocated per slot message. */
+    std::size_t message_reserve{ 128 };
+    /** @brief Behaviour on a full ring. */
+    OverflowPolicy overflow{ OverflowPolicy::Block };
+};
+
+/**
+ * @brief Counters reported by @ref AsyncLogger::counters().
+ */
+struct AsyncCounters {
+    /** @brief Records accepted into the ring. */
+    std::uint64_t enqueued{ 0 };
+    /** @brief Records handed to the sink. */
+    std::uint64_t written{ 0 };
+    /** @brief Incoming records rejected (full ring or stopped logger). */
+    std::uint64_t dropped_newest{ 0 };
+    /** @brief Queued records evicted under @ref OverflowPolicy::DropOldest. */
+    std::uint64_t dropped_oldest{ 0 };
+    /** @brief Sink writes that failed (see @ref AsyncLogger::last_error()). */
+    std::uint64_t write_errors{ 0 };
+};
+
+/**
+ * @brief Logger whose callers only copy into a lock-free ring.
+ * @details A single worker thread drains the ring into the sink, so producer
+ * threads never contend on sink locks or wait on sink I/O (except under
+ * @ref OverflowPolicy::Block when the ring is full). The worker is only
+ * signalled when it is actually asleep.
+ */
+class AsyncLogger {
+    public:
+    /**
+     * @brief Construct and start the worker thread.
+     * @param sink Destination (owned, used from the worker thread).
+     * @param default_level Minimum level to pass through.
+     * @param opts Ring size and overflow policy.
+     */
+    AsyncLogger (std::unique_ptr<ILogSink> sink, LogLevel default_level, AsyncOptions opts = {});
+
+    /** @brief Drain queued records and stop the worker. */
+    ~AsyncLogger ();
+
+    AsyncLogger (const AsyncLogger&)            = delete;
+    AsyncLogger& operator= (const AsyncLogger&) = delete;
+
+    /**
+     * @brief Queue a message with explicit level.
+     * @return Status::Ok if queued, Status::Filtered or Status::Dropped otherwise
+     * (also when @ref stop is called while waiting under @ref OverflowPolicy::Block).
+     */
+    Status log (LogLevel level, std::string_view msg) noexcept;
+
+    /**
+     * @brief Queue with the current default level.
+     */
+    Status log (const std::string_view msg) noexcept {
+        return log (_default.load (), msg);
+    }
+
+    /**
+     * @brief Whether @p level passes the runtime threshold (one relaxed load).
+     */
+    bool enabled (const LogLevel level) const noexcept {
+        return static_cast<int> (level) <= static_cast<int> (_default.load (std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Queue a message built only if @p Level is compiled in and enabled.
+     * @param make Callable returning something convertible to std::string_view.
+     * @return Status::Filtered without invoking @p make when filtered.
+     * @throws Whatever @p make throws (e.g. std::bad_alloc building a std::string);
+     * noexcept when @p make is.
+     */
+    template <LogLevel Level, class F> Status log_lazy (F&& make) noexcept (detail::make_noexcept<F>) {
+        return detail::log_lazy<Level> (*this, std::forward<F> (make));
+    }
+
+    /**
+     * @brief Runtime-level variant of @ref log_lazy.
+     */
+    template <class F> Status log_lazy (const LogLevel level, F&& make) noexcept (detail::make_noexcept<F>) {
+        return detail::log_lazy (*this, level, std::forward<F> (make));
+    }
+
+    /** @brief Set/Get default severity threshold. */
+    void set_default_level (const LogLevel lvl) noexcept {
+        _default.store (lvl);
+    }
+    LogLevel default_level () const noexcept {
+        return _default.load ();
+    }
+
+    /**
+     * @brief Last error text reported by the sink on the worker thread.
+     */
+    std::string last_error () const;
+
+    /**
+     * @brief Wait until everything queued before the call is written, then flush the sink.
+     */
+    void flush () noexcept;
+
+    /**
+     * @brief Drain the ring and join the worker; later calls to @ref log are dropped.
+     * @note Idempotent; also called by the destructor.
+     */
+    void stop () noexcept;
+
+    /** @brief Snapshot of queue/drop counters. */
+    AsyncCounters counters () const noexcept;
+
+    private:
+    void run () noexcept;
+    void wake_consumer () noexcept;
+
+    std::unique_ptr<ILogSink> _sink; ///< Owned sink (worker thread only).
+    std::atomic<LogLevel> _default;  ///< Current threshold.
+    OverflowPolicy _overflow;        ///< Full-ring behaviour.
+    MpscRing _ring;                  ///< Preallocated record slots.
+
+    std::atomic<bool> _stop{ false };        ///< Set once by @ref stop().
+    std::atomic<int> _producers{ 0 };        ///< Calls of @ref log between the stop check and the push.
+    std::atomic<bool> _worker_done{ false }; ///< Worker has exited its loop.
+    std::atomic<bool> _sleeping{ false };    ///< Worker is (about to be) waiting on @ref _wake_cv.
+    std::mutex _wake_mu;                     ///< Pairs with @ref _wake_cv.
+    std::condition_variable _wake_cv;        ///< Wakes the worker.
+
+    std::atomic<int> _waiters{ 0 };   ///< Blocked producers and flush callers.
+    std::mutex _done_mu;              ///< Pairs with @ref _done_cv.
+    std::condition_variable _done_cv; ///< Signals consumed records / free space.
+
+    std::atomic<std::uint64_t> _enqueued{ 0 };
+    std::atomic<std::uint64_t> _consumed{ 0 }; ///< Written or evicted.
+    std::atomic<std::uint64_t> _written{ 0 };
+    std::atomic<std::uint64_t> _dropped_newest{ 0 };
+    std::atomic<std::uint64_t> _dropped_oldest{ 0 };
+    std::atomic<std::uint64_t> _write_errors{ 0 };
+
+    mutable std::mutex _err_mu; ///< Protects @ref _last_err.
+    std::string _last_err;      ///< Last sink error message.
+
+    std::mutex _stop_mu; ///< Serializes @ref stop().
+    std::thread _worker; ///< Drains @ref _ring.
+};
+
+/**
+ * @brief Log through @p lg at compile-time @p lvl; the message expression
+ * is evaluated only if the level is compiled in and enabled at runtime.
+ * @details Works with @ref Logger and @ref AsyncLogger. Example:
+ * `LOGGER_LOG (L, logger::LogLevel::Info, "req " + std::to_string (id));`
+ */
+#define LOGGER_LOG(lg, lvl, ...) ((lg).template log_lazy<lvl> ([&] () { return (__VA_ARGS__); }))
+#define LOGGER_ERROR(lg, ...) LOGGER_LOG (lg, ::logger::LogLevel::Error, __VA_ARGS__)
+#define LOGGER_WARN(lg, ...) LOGGER_LOG (lg, ::logger::LogLevel::Warning, __VA_ARGS__)
+#define LOGGER_INFO(lg, ...) LOGGER_LOG (lg, ::logger::LogLevel::Info, __VA_ARGS__)
+
 /**
  * @brief Create a file sink for @p path.
  * @return Owned sink or nullptr on open error.
  */
 std::unique_ptr<ILogSink> make_file_sink (const std::string& path) noexcept;
 
+struct FileSinkOptions;
+
+/**
+ * @brief Create a file sink for @p path with an explicit buffer/flush policy.
+ * @return Owned sink (check FileSink::is_open()).
+ */
+std::unique_ptr<ILogSink> make_file_sink (const std::string& path, const FileSinkOptions& opts) noexcept;
+
+/**
+ * @brief Create a memory-mapped segment sink writing "<base_path>.NNNNNN" files.
+ * @return Owned sink (check MmapFileSink::is_open()).
+ */
+std::unique_ptr<ILogSink> make_mmap_file_sink (const std::string& base_path, std::size_t segment_bytes) noexcept;
+
 /**
  * @brief Create a TCP socket sink for @p host:@p port.
  * @return Owned sink or nullptr on connect error.
  */
 std::unique_ptr<ILogSink> make_socket_sink (const std::string& host, std::uint16_t port) noexcept;
+
+struct SocketSinkOptions;
+
+/**
+ * @brief Create a TCP socket sink with an explicit delivery mode (e.g. async batching).
+ * @return Owned sink.
+ */
+std::unique_ptr<ILogSink>
+make_socket_sink (const std::string& host, std::uint16_t port, const SocketSinkOptions& opts) noexcept;
+
+/**
+ * @brief Create a sink for the AF_UNIX stream socket at @p path (same wire format as TCP).
+ * @return Owned sink.
+ */
+std::unique_ptr<ILogSink> make_unix_socket_sink (const std::string& path) noexcept;
+
+/**
+ * @brief Create an AF_UNIX stream sink with an explicit delivery mode.
+ * @return Owned sink.
+ */
+std::unique_ptr<ILogSink> make_unix_socket_sink (const std::string& path, const SocketSinkOptions& opts) noexcept;
+
+/**
+ * @brief Create a sink sending one UDP datagram per record to @p host:@p port.
+ * @return Owned sink.
+ */
+std::unique_ptr<ILogSink> make_udp_sink (const std::string& host, std::uint16_t port) noexcept;
+
+/**
+ * @brief Create a sink sending one datagram per record to the AF_UNIX socket at @p path.
+ * @return Owned sink.
+ */
+std::unique_ptr<ILogSink> make_unix_datagram_sink (const std::string& path) noexcept;
 } // namespace logger
@@ -0,0 +1,94 @@
+#pragma once
+/**
+ * @file
+ * @brief Lock-free memory-mapped segment file sink.
+ */
+
+#include "log_sink.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace logger {
+/**
+ * @brief Sink that copies formatted lines straight into mapped log segments.
+ * @details Segments are files named "<base>.<NNNNNN>" preallocated with
+ * fallocate and mapped shared. A writer reserves its byte range with one
+ * atomic fetch_add on the segment offset and memcpy's the line into the
+ * mapping; there is no shared mutex on the write path, so throughput
+ * scales with the number of writer threads. A writer whose reservation
+ * does not fit rolls over to the next segment (the only locked path).
+ *
+ * End of valid data: a sealed segment (rolled over or closed) is truncated
+ * to exactly its written length. A segment left behind by a crash keeps
+ * its preallocated zero tail (see @ref valid_length), and reservations
+ * whose writer died leave zero gaps or torn lines in the middle;
+ * @ref recover extracts the complete lines around them. Messages must
+ * therefore not contain NUL bytes.
+ */
+class MmapFileSink final : public ILogSink {
+    public:
+    /**
+     * @brief Open the first unused segment index for @p base_path.
+     * @param base_path Segment path prefix.
+     * @param segment_bytes Size of each preallocated segment.
+     * @note Never throws. Check @ref is_open().
+     */
+    explicit MmapFileSink (std::string base_path, std::size_t segment_bytes = 64u << 20) noexcept;
+
+    /** @brief Seal the current segment. Writers must have finished. */
+    ~MmapFileSink () override;
+
+    /**
+     * @brief Write one log entry.
+     * @note Thread-safe and lock-free unless a rollover is needed.
+     */
+    bool write (const LogEntry& e, std::string& err) noexcept override;
+
+    /** @copydoc write */
+    bool write_view (const LogEntryView& e, std::string& err) noexcept override;
+
+    /** @brief Schedule write-back of the current segment (msync MS_ASYNC). */
+    void flush () noexcept override;
+
+    /** @brief Whether a segment is mapped. */
+    bool is_open () const noexcept {
+        return _cur.load (std::memory_order_acquire) != nullptr;
+    }
+
+    /** @brief Path of the segment currently written. */
+    std::string current_path () const;
+
+    /**
+     * @brief Length of a segment's contents without the zero tail.
+     * @return Offset just past the last non-NUL byte.
+     */
+    static std::size_t valid_length (const char* data, std::size_t size) noexcept;
+
+    /**
+     * @brief Complete lines of a segment left behind by a crash.
+     * @details Skips zero-filled gaps and drops lines torn by them or by
+     * the end of the data; lines written after a gap are kept.
+     */
+    static std::string recover (const char* data, std::size_t size);
+
+    private:
+    struct Segment;
+
+    Segment* acquire () noexcept;
+    static void release (Segment* seg) noexcept;
+    bool roll (Segment* full, std::string& err) noexcept;
+    Segment* open_segment (std::string& err) noexcept;
+    static void seal (Segment* seg) noexcept;
+
+    std::string _base;                              ///< Segment path prefix.
+    std::size_t _segment_bytes;                     ///< Size of each segment.
+    unsigned _next_index{ 0 };                      ///< Index of the next segment to create.
+    std::atomic<Segment*> _cur{ nullptr };          ///< Segment receiving writes.
+    std::vector<std::unique_ptr<Segment>> _retired; ///< Sealed segments (kept so stale pointers stay valid).
+    mutable std::mutex _roll_mu;                    ///< Serializes rollover.
+};
+} // namespace logger
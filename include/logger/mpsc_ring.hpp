@@ -0,0 +1,79 @@
+#pragma once
+/**
+ * @file
+ * @brief Bounded lock-free ring of preallocated log entries.
+ */
+
+#include "log_entry.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace logger {
+/**
+ * @brief Fixed-capacity multi-producer ring buffer of @ref LogEntry slots.
+ * @details Sequence-numbered slots (Vyukov scheme): producers claim a slot
+ * with one CAS on the tail and publish it with a release store, so there is
+ * no lock and no allocation once slot strings have grown to their working
+ * size. Pops are CAS-guarded as well, which lets producers evict the oldest
+ * entry when the ring is full; normally only one consumer pops.
+ */
+class MpscRing {
+    public:
+    /**
+     * @brief Preallocate the ring.
+     * @param capacity Slot count, rounded up to a power of two (min 2).
+     * @param message_reserve Bytes reserved up front in every slot message.
+     */
+    explicit MpscRing (std::size_t capacity, std::size_t message_reserve = 0);
+
+    MpscRing (const MpscRing&)            = delete;
+    MpscRing& operator= (const MpscRing&) = delete;
+
+    /**
+     * @brief Copy one record into the next free slot.
+     * @return false if the ring is full.
+     */
+    bool try_push (std::uint64_t epoch_ms, LogLevel level, std::string_view msg) noexcept;
+
+    /**
+     * @brief Take the oldest published record.
+     * @param out Receives the record; its message buffer is swapped into the
+     * slot so capacity keeps circulating instead of being reallocated.
+     * @return false if the ring is empty.
+     */
+    bool try_pop (LogEntry& out) noexcept;
+
+    /**
+     * @brief Discard the oldest published record.
+     * @details Its message buffer stays in the slot, so evicting under
+     * sustained overflow does not reallocate on the next push.
+     * @return false if the ring is empty.
+     */
+    bool try_drop () noexcept;
+
+    /** @brief Number of slots. */
+    std::size_t capacity () const noexcept {
+        return _mask + 1;
+    }
+
+    /** @brief Whether no published record is waiting (approximate under concurrency). */
+    bool empty () const noexcept;
+
+    private:
+    struct alignas (64) Slot {
+        std::atomic<std::size_t> seq{ 0 };
+        LogEntry entry;
+    };
+
+    /** @brief Claim the oldest published slot; its position goes to @p pos. */
+    Slot* claim_head (std::size_t& pos) noexcept;
+
+    std::unique_ptr<Slot[]> _slots;              ///< Preallocated slots.
+    std::size_t _mask{ 0 };                      ///< capacity - 1.
+    alignas (64) std::atomic<std::size_t> _tail{ 0 }; ///< Next position to claim for push.
+    alignas (64) std::atomic<std::size_t> _head{ 0 }; ///< Next position to pop.
+};
+} // namespace logger
@@ -0,0 +1,74 @@
+#pragma once
+/**
+ * @file
+ * @brief Mergeable log-linear histogram for quantiles of sizes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace logger {
+/**
+ * @brief Histogram of non-negative integers with bounded relative error.
+ * @details Values below 2 * 2^@ref kSubBits get a bucket each; above that
+ * every power of two is split into 2^@ref kSubBits equal buckets (HDR
+ * histogram layout), so an estimate is within 1/2^(@ref kSubBits + 1)
+ * (about 3%) of a value in the requested rank. Adding is a shift and an
+ * increment, memory is fixed (@ref kBuckets counters), and two sketches
+ * merge exactly by adding counters. Values above @ref kMaxValue are
+ * recorded as @ref kMaxValue.
+ */
+class QuantileSketch {
+    public:
+    static constexpr unsigned kSubBits       = 4;
+    static constexpr unsigned kMaxExponent   = 31;
+    static constexpr std::uint64_t kMaxValue = (std::uint64_t{ 1 } << (kMaxExponent + 1)) - 1;
+    static constexpr std::size_t kBuckets    = ((kMaxExponent - kSubBits) << kSubBits) + (2u << kSubBits);
+
+    /** @brief Bucket of @p v. */
+    static std::size_t index (std::uint64_t v) noexcept {
+        if (v < (2u << kSubBits))
+            return static_cast<std::size_t> (v);
+        if (v > kMaxValue)
+            v = kMaxValue;
+        const unsigned e = 63u - static_cast<unsigned> (__builtin_clzll (v));
+        return (static_cast<std::size_t> (e - kSubBits) << kSubBits) + static_cast<std::size_t> (v >> (e - kSubBits));
+    }
+
+    /** @brief Smallest value in bucket @p i. */
+    static std::uint64_t lower_bound (std::size_t i) noexcept;
+
+    /** @brief Value reported for bucket @p i (its midpoint). */
+    static std::uint64_t representative (std::size_t i) noexcept;
+
+    /** @brief Record @p n occurrences of @p v. */
+    void add (const std::uint64_t v, const std::uint64_t n = 1) noexcept {
+        _counts[index (v)] += n;
+        _count += n;
+    }
+
+    /** @brief Record @p n occurrences in bucket @p i (for rebuilding from raw counters). */
+    void add_bucket (const std::size_t i, const std::uint64_t n) noexcept {
+        _counts[i] += n;
+        _count += n;
+    }
+
+    /** @brief Add all of @p other's counts. */
+    void merge (const QuantileSketch& other) noexcept;
+
+    /** @brief Values recorded. */
+    std::uint64_t count () const noexcept {
+        return _count;
+    }
+
+    /**
+     * @brief Estimate of the @p q quantile (0 <= q <= 1).
+     * @return Representative of the bucket holding rank ceil(q * count), or 0 if empty.
+     */
+    std::uint64_t quantile (double q) const noexcept;
+
+    private:
+    std::uint64_t _counts[kBuckets]{};
+    std::uint64_t _count{ 0 };
+};
+} // namespace logger
@@ -5,50 +5,320 @@
  */
 
 #include "log_sink.hpp"
+#include "mpsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
 
 namespace logger {
 /**
- * @brief Sends log entries to a TCP endpoint (thread-safe).
+ * @brief Encoding of records on a @ref SocketSink connection.
+ */
+enum class WireFormat {
+    Text,  ///< "epoch_ms|LEVEL|message\n" lines; understood by every collector.
+    Binary ///< Length-prefixed blocks (see @ref wire), negotiated per connection.
+};
+
+/**
+ * @brief Delivery mode and batching thresholds of a @ref SocketSink.
+ * @details The defaults keep the synchronous behaviour: every write sends
+ * on the calling thread.
+ */
+struct SocketSinkOptions {
+    /** @brief Callers only enqueue; a sender thread does all network I/O. */
+    bool async{ false };
+    /** @brief Queue slots in async mode (rounded up to a power of two). */
+    std::size_t queue_capacity{ 8192 };
+    /** @brief Send as soon as this many wire bytes are pending. */
+    std::size_t batch_bytes{ 64 * 1024 };
+    /** @brief Longest time a queued record waits for a batch to fill. */
+    std::chrono::milliseconds linger{ 5 };
+
+    /**
+     * @brief Record encoding. Binary is offered with a handshake on a new
+     * connection; a collector that does not answer within
+     * @ref connect_timeout gets text lines on a fresh connection instead.
+     * The fallback is remembered per address until it is resolved again
+     * (@ref dns_ttl), so reconnects do not wait for the handshake.
+     */
+    WireFormat wire{ WireFormat::Text };
+    /** @brief Binary format: append a CRC-32 to every block. */
+    bool wire_checksum{ true };
+
+    /** @brief Give up on a connect that has not completed after this long. */
+    std::chrono::milliseconds connect_timeout{ 1000 };
+    /** @brief How long resolved addresses are reused before asking DNS again. */
+    std::chrono::seconds dns_ttl{ 60 };
+    /**
+     * @brief Synchronous mode: resolve and connect on a helper thread. Writes
+     * made while it works are spilled (see @ref spill_bytes) or dropped.
+     */
+    bool background_connect{ false };
+
+    /** @brief Delay before the first reconnect after a failure; doubles per failed attempt. */
+    std::chrono::milliseconds reconnect_min{ 100 };
+    /** @brief Upper bound of the reconnect delay. */
+    std::chrono::milliseconds reconnect_max{ 10000 };
+    /** @brief Memory for records the collector could not take (0 = drop them). */
+    std::size_t spill_bytes{ 0 };
+    /** @brief File receiving the memory spill when it fills up (empty = none). */
+    std::string spool_path;
+    /** @brief Upper bound of the spool file; records beyond it are dropped. */
+    std::uint64_t spool_max_bytes{ 1ull << 30 };
+};
+
+/**
+ * @brief Filesystem path of an AF_UNIX socket (selects the Unix-domain constructors).
+ */
+struct UnixPath {
+    std::string path; ///< Socket path (at most 107 bytes).
+};
+
+/**
+ * @brief Fill @p out with the AF_UNIX address of @p path.
+ * @return false if the path does not fit in sockaddr_un.
+ */
+bool fill_unix_address (const std::string& path, sockaddr_storage& out, socklen_t& len) noexcept;
+
+/**
+ * @brief Counters reported by @ref SocketSink::counters().
+ */
+struct SocketSinkCounters {
+    /** @brief Records accepted into the queue (async mode). */
+    std::uint64_t enqueued{ 0 };
+    /** @brief Records handed to the socket directly. */
+    std::uint64_t sent{ 0 };
+    /** @brief Records rejected because the queue was full (async mode). */
+    std::uint64_t dropped{ 0 };
+    /** @brief Records kept for replay because the collector was unreachable. */
+    std::uint64_t spilled{ 0 };
+    /** @brief Records lost to failed sends (see @ref SocketSink::last_error()). */
+    std::uint64_t send_errors{ 0 };
+};
+
+/**
+ * @brief Sends log entries to a TCP or Unix-domain stream endpoint (thread-safe).
+ * @details In async mode (@ref SocketSinkOptions::async) a write costs one
+ * push into a lock-free ring and never touches the socket, so a slow or
+ * stalled collector cannot block logging threads; when the ring is full the
+ * new record is dropped and counted. The sender thread packs queued records
+ * into one buffer and sends it once it holds
+ * @ref SocketSinkOptions::batch_bytes or its oldest record has waited
+ * @ref SocketSinkOptions::linger.
+ *
+ * Connecting: resolved addresses are cached for
+ * @ref SocketSinkOptions::dns_ttl (and re-resolved early after every
+ * address failed); each is tried with a non-blocking connect bounded by
+ * @ref SocketSinkOptions::connect_timeout. In async mode only the sender
+ * thread connects; in synchronous mode
+ * @ref SocketSinkOptions::background_connect moves it to a helper thread.
+ *
+ * Outages: after a failed connect no new attempt is made until a delay
+ * has passed that doubles per failure (@ref SocketSinkOptions::reconnect_min
+ * up to @ref SocketSinkOptions::reconnect_max). Meanwhile records go to a
+ * bounded memory spill, which is appended to the spool file
+ * (@ref SocketSinkOptions::spool_path) whenever it fills and on
+ * destruction. Once connected the backlog is replayed oldest first — spool,
+ * then memory — before newer records, a bounded chunk per call on the
+ * synchronous path. A spool left by an earlier process is replayed too. A
+ * line cut by a failed send is resent whole, so the collector may see its
+ * beginning twice.
+ *
+ * With @ref WireFormat::Binary, batches, spill and spool hold encoded
+ * records, and each send goes out as one block that the collector takes
+ * whole or not at all. The spool file starts with a tag naming its format;
+ * a spool left in the other format is converted when the sink opens it, or
+ * left untouched and unused (see @ref last_error) if that fails.
  */
 class SocketSink final : public ILogSink {
     public:
     /**
      * @brief Create sink for @p host:@p port.
-     * @note Never throws; connection is lazy.
+     * @param opts Delivery mode, batching and reconnect policy.
+     * @note Never throws and never touches the network: the first write (or
+     * the sender/connector thread) connects.
+     */
+    SocketSink (std::string host, std::uint16_t port, SocketSinkOptions opts = {}) noexcept;
+
+    /**
+     * @brief Create sink for the AF_UNIX stream socket at @p path.
+     * @details Same wire format and options as TCP; DNS settings are unused.
      */
-    SocketSink (std::string host, std::uint16_t port) noexcept;
+    explicit SocketSink (UnixPath path, SocketSinkOptions opts = {}) noexcept;
 
-    /** @brief Close socket if open. */
+    /** @brief Send what is queued (async mode) and close the socket. */
     ~SocketSink () override;
 
     /**
-     * @brief Send one entry; connects on first use.
+     * @brief Send (or enqueue) one entry; connects on first use.
      * @param e Log entry to send.
      * @param err Error text on failure.
-     * @return true on success, false on I/O error.
+     * @return true on success, false on I/O error or a full queue.
      */
     bool write (const LogEntry& e, std::string& err) noexcept override;
 
-    /** @brief No-op for sockets. */
-    void flush () noexcept override {
-    }
+    /**
+     * @brief Send (or enqueue) one borrowed entry without heap allocation.
+     */
+    bool write_view (const LogEntryView& e, std::string& err) noexcept override;
+
+    /**
+     * @brief Send a run of entries with one lock and (usually) one send.
+     * @return Synchronous mode: entries sent, all or none. Async mode:
+     * entries enqueued, stopping at the first that does not fit.
+     */
+    std::size_t write_batch (const LogEntry* entries, std::size_t count, std::string& err) noexcept override;
+
+    /** @brief Async mode: wait until everything queued so far was sent or failed. */
+    void flush () noexcept override;
+
+    /** @brief Delivery counters (enqueued/dropped only move in async mode). */
+    SocketSinkCounters counters () const noexcept;
+
+    /** @brief Last error hit by the sender thread. */
+    std::string last_error () const;
 
     private:
-    int _fd{ -1 };            ///< Socket fd or -1 if closed.
-    std::string _host;        ///< Target host.
-    std::uint16_t _port{ 0 }; ///< Target port.
-    std::mutex _mu;           ///< Guards connect/send/close.
+    struct Endpoint;
+
+    int _fd{ -1 };              ///< Socket fd or -1 if closed.
+    std::string _host;          ///< Target host.
+    std::uint16_t _port{ 0 };   ///< Target port.
+    std::string _unix_path;     ///< AF_UNIX path (empty for TCP).
+    SocketSinkOptions _opts;    ///< Mode and thresholds.
+    std::mutex _mu;             ///< Guards connect/send/close.
+    std::string _batch;         ///< Reused wire buffer (guarded by @ref _mu, sender-owned in async mode).
+    bool _conn_binary{ false }; ///< The current connection accepted the binary format.
+    std::string _text_buf;      ///< Binary records rendered as text for a text-only collector.
+
+    std::vector<Endpoint> _addrs;                          ///< Cached resolved addresses (connecting thread only).
+    std::chrono::steady_clock::time_point _resolved_at{};  ///< When @ref _addrs was filled.
+    bool _connecting{ false };                             ///< Connector thread is busy (guarded by @ref _mu).
+    bool _connector_stop{ false };                         ///< Tells the connector to exit (guarded by @ref _mu).
+    std::condition_variable _connect_cv;                   ///< Wakes the connector.
+    std::thread _connector;                                ///< Runs only with background_connect.
+    std::chrono::steady_clock::time_point _next_attempt{}; ///< No connect attempt before this.
+    std::chrono::milliseconds _backoff{ 0 };               ///< Current reconnect delay (0 after a success).
+    std::string _spill;                                    ///< Memory backlog, newer than the spool.
+    std::size_t _spill_head{ 0 };                          ///< Bytes of @ref _spill already replayed.
+    int _spool_fd{ -1 };                                   ///< Spool file or -1.
+    std::uint64_t _spool_size{ 0 };                        ///< Bytes in the spool file.
+    std::uint64_t _spool_off{ 0 };                         ///< Spool bytes already replayed.
+    std::string _replay_buf;                               ///< Read buffer for spool replay.
+
+    std::unique_ptr<MpscRing> _ring;               ///< Async queue (null in synchronous mode).
+    std::atomic<bool> _stop{ false };              ///< Tells the sender to drain and exit.
+    std::atomic<bool> _sleeping{ false };          ///< Sender is idle-waiting on @ref _wake_cv.
+    std::atomic<bool> _backlog{ false };           ///< Sender should poll for reconnect/replay.
+    std::atomic<std::uint64_t> _flush_target{ 0 }; ///< Records a flush caller waits for.
+    std::mutex _wake_mu;                           ///< Pairs with @ref _wake_cv and @ref _done_cv.
+    std::condition_variable _wake_cv;              ///< Wakes the sender.
+    std::condition_variable _done_cv;              ///< Signals finished batches to flush callers.
+    std::thread _sender;                           ///< Runs only in async mode.
+
+    std::atomic<std::uint64_t> _enqueued{ 0 };
+    std::atomic<std::uint64_t> _consumed{ 0 }; ///< Sent or failed.
+    std::atomic<std::uint64_t> _sent{ 0 };
+    std::atomic<std::uint64_t> _dropped{ 0 };
+    std::atomic<std::uint64_t> _spilled{ 0 };
+    std::atomic<std::uint64_t> _send_errors{ 0 };
+    mutable std::mutex _err_mu; ///< Protects @ref _last_err.
+    std::string _last_err;      ///< Last sender error message.
 
     /**
      * @brief Ensure socket is connected.
      * @return true if connected/ready, false on error (sets @p err).
      */
     bool connect_socket (std::string& err) noexcept;
+    /** @brief Open the spool and start helper threads (shared by the constructors). */
+    void start () noexcept;
+    /** @brief Refresh @ref _addrs from DNS (or the Unix path). */
+    bool resolve (std::string& err) noexcept;
+    /**
+     * @brief Connect to the first reachable cached address.
+     * @param binary Whether the collector accepted the binary format.
+     * @return The fd or -1.
+     */
+    int open_connection (bool& binary, std::string& err) noexcept;
+    /** @brief Non-blocking connect bounded by @p timeout; returns a blocking fd or -1. */
+    static int connect_endpoint (const Endpoint& ep, std::chrono::milliseconds timeout, std::string& err) noexcept;
+    /**
+     * @brief Offer the binary format on a fresh connection.
+     * @param binary Set if the collector accepted within @p timeout.
+     * @return false if the connection broke.
+     */
+    static bool negotiate (int fd, std::chrono::milliseconds timeout, bool& binary, std::string& err) noexcept;
+    /** @brief Reset or extend the backoff after a connect attempt (caller holds @ref _mu). */
+    void note_attempt_locked (bool ok) noexcept;
+    /** @brief Helper thread for @ref SocketSinkOptions::background_connect. */
+    void connector_loop () noexcept;
+
+    /** @brief Outcome of @ref deliver_locked. */
+    enum class Delivery { Sent, Spilled, Failed };
+
+    /**
+     * @brief Send @p len bytes.
+     * @param sent Bytes the socket accepted, also on failure.
+     * @return true if everything was sent.
+     */
+    bool send_some (const char* data, std::size_t len, std::size_t& sent) noexcept;
+    /** @brief Send one binary block holding @p body (whole records). */
+    bool send_block (std::string_view body) noexcept;
+    /**
+     * @brief Send encoded records in the connection's format.
+     * @param done Length of the leading records known to be delivered whole.
+     * @return true if everything was sent.
+     */
+    bool transmit_locked (std::string_view data, std::size_t& done) noexcept;
+    /** @brief Append one record to @p out in the configured @ref SocketSinkOptions::wire format. */
+    void encode (std::string& out, std::uint64_t epoch_ms, LogLevel level, std::string_view msg) const;
 
     /** @brief Close socket fd (if any). */
     void close_socket () noexcept;
+
+    /** @brief Connect unless the backoff delay is still running (caller holds @ref _mu). */
+    bool try_connect_locked (std::string& err) noexcept;
+    /** @brief Send whole lines in @p data behind any backlog, spilling what cannot go out. */
+    Delivery deliver_locked (std::string_view data, std::string& err) noexcept;
+    /** @brief Append whole lines to the backlog. */
+    bool spill_locked (std::string_view data, std::string& err) noexcept;
+    /** @brief Open the spool file and adopt (or convert) what an earlier run left in it. */
+    void open_spool () noexcept;
+    /** @brief Rewrite a spool tagged with the other wire format in this sink's format. */
+    bool convert_spool (std::string& err) noexcept;
+    /** @brief Append @p data to the spool file within its size limit. */
+    bool spool_write_locked (std::string_view data, std::string& err) noexcept;
+    /** @brief Move the memory spill to the end of the spool file. */
+    bool spool_memory_locked (std::string& err) noexcept;
+    /** @brief Next @p want backlog bytes from the spool or the memory spill. */
+    std::string_view backlog_chunk_locked (bool from_spool, std::size_t want, std::string& err) noexcept;
+    /** @brief Send up to @p budget backlog bytes, oldest first; false on a failed send. */
+    bool replay_locked (std::size_t budget, std::string& err) noexcept;
+    /** @brief Whether records are waiting for replay. */
+    bool has_backlog_locked () const noexcept {
+        return _spool_off < _spool_size || _spill_head < _spill.size ();
+    }
+    /** @brief Sender thread: connect and replay when due; true if bytes were replayed. */
+    bool service_backlog () noexcept;
+
+    /** @brief Queue one record for the sender (async mode). */
+    bool enqueue (std::uint64_t epoch_ms, LogLevel level, std::string_view msg, std::string& err) noexcept;
+    /** @brief Wake the sender if it is idle. */
+    void wake_sender () noexcept;
+    /** @brief Sender thread: coalesce queued records and send them. */
+    void sender_loop () noexcept;
+    /** @brief Send @ref _batch holding @p records records and account for them. */
+    void send_batch (std::uint64_t records) noexcept;
+    /** @brief Update counters (and @ref _last_err) for @p records delivered as @p d. */
+    void account (Delivery d, std::uint64_t records, const std::string& err) noexcept;
 };
 } // namespace logger
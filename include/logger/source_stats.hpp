@@ -0,0 +1,111 @@
+#pragma once
+/**
+ * @file
+ * @brief Per-source record counts with idle eviction and top-N reports.
+ */
+
+#include "logger/log_level.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace logger {
+/**
+ * @brief Record counts of one source.
+ * @details Plain integers: meant to be owned by one thread (a connection's
+ * local tally) and folded into a @ref SourceStatsTable now and then.
+ * Arrays use index order: [ERROR, WARN, INFO].
+ */
+struct SourceCounts {
+    std::uint64_t total{ 0 };
+    std::uint64_t by_level[3]{ 0, 0, 0 };
+    std::uint64_t bytes{ 0 }; ///< Message bytes.
+
+    /** @brief Count one record. */
+    void add (const LogLevel lvl, const std::size_t msg_len) noexcept {
+        ++total;
+        ++by_level[static_cast<unsigned> (lvl) < 3 ? static_cast<unsigned> (lvl) : 2];
+        bytes += msg_len;
+    }
+
+    /** @brief Add @p other's counts. */
+    void merge (const SourceCounts& other) noexcept {
+        total += other.total;
+        for (int i = 0; i < 3; ++i)
+            by_level[i] += other.by_level[i];
+        bytes += other.bytes;
+    }
+};
+
+/** @brief One row of a @ref SourceStatsTable report. */
+struct SourceStats {
+    std::string source;
+    SourceCounts counts;
+    std::uint64_t last_seen_ms{ 0 }; ///< Time of the last merge that carried records.
+};
+
+/**
+ * @brief Thread-safe counts by source name (peer host, handshake id, ...).
+ * @details Producers aggregate locally in @ref SourceCounts and call
+ * @ref merge with the delta, so the mutex is taken once per flush, not per
+ * record. At most @ref max_sources names are tracked; records of further
+ * sources go to @ref kOverflow until @ref evict_idle frees room.
+ */
+class SourceStatsTable {
+    public:
+    /** @brief Name the records of untracked sources are counted under. */
+    static constexpr std::string_view kOverflow = "(other)";
+
+    explicit SourceStatsTable (std::size_t max_sources = 4096);
+
+    /** @brief Add @p delta to @p source (created if new); empty deltas are ignored. */
+    void merge (std::string_view source, const SourceCounts& delta, std::uint64_t now_ms);
+
+    /**
+     * @brief Add every source of @p other, e.g. to combine per-shard tables.
+     * @details Counts add up and the later last-seen time wins; names beyond
+     * this table's cap go to @ref kOverflow.
+     */
+    void merge (const SourceStatsTable& other);
+
+    /**
+     * @brief Forget sources with no records since @p before_ms.
+     * @return Sources removed.
+     */
+    std::size_t evict_idle (std::uint64_t before_ms);
+
+    /** @brief Up to @p n sources with the most records, most first. */
+    std::vector<SourceStats> top_by_volume (std::size_t n) const;
+
+    /** @brief Up to @p n sources with the most ERROR records, most first (sources without errors left out). */
+    std::vector<SourceStats> top_by_errors (std::size_t n) const;
+
+    /** @brief Sources tracked, @ref kOverflow included. */
+    std::size_t size () const;
+
+    /** @brief Cap on tracked names. */
+    std::size_t max_sources () const noexcept {
+        return _max;
+    }
+
+    private:
+    struct Entry {
+        SourceCounts counts;
+        std::uint64_t last_seen_ms{ 0 };
+    };
+
+    /** @brief Body of @ref merge (caller holds @ref _mu). */
+    void merge_locked (std::string_view source, const SourceCounts& delta, std::uint64_t last_seen_ms);
+
+    /** @brief The @p n largest entries by @p key (caller holds @ref _mu). */
+    template <class Key> std::vector<SourceStats> top_locked (std::size_t n, Key key) const;
+
+    mutable std::mutex _mu;
+    std::unordered_map<std::string, Entry> _entries;
+    std::size_t _max;
+};
+} // namespace logger
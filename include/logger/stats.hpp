@@ -4,13 +4,50 @@
  * @brief Rolling log statistics (totals and last-hour window).
  */
 
+#include "logger/hyperloglog.hpp"
 #include "logger/log_level.hpp"
+#include "logger/quantile_sketch.hpp"
+#include "logger/top_templates.hpp"
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include <vector>
 
 namespace logger {
+/** @brief Message-length quantiles (bytes). */
+struct LengthQuantiles {
+    std::uint64_t p50{ 0 };
+    std::uint64_t p90{ 0 };
+    std::uint64_t p99{ 0 };
+    std::uint64_t p999{ 0 };
+};
+
+/** @brief Read the quantiles of @p sketch, clamped to [@p min, @p max]. */
+LengthQuantiles length_quantiles (const QuantileSketch& sketch, std::uint64_t min = 0, std::uint64_t max = QuantileSketch::kMaxValue) noexcept;
+
+/** @brief Counts over one trailing window (see @ref StatsWindow::windows). */
+struct WindowStats {
+    std::chrono::milliseconds length{ 0 };
+    std::uint64_t total{ 0 };
+    std::uint64_t by_level[3]{ 0, 0, 0 };
+    double avg_len{ 0.0 };
+    std::uint64_t distinct_messages{ 0 };        ///< Estimate from @ref msg_hll.
+    std::uint64_t distinct_sources{ 0 };         ///< Estimate from @ref src_hll.
+    HyperLogLog msg_hll;                         ///< Distinct message texts (window edge rounded to a slice).
+    HyperLogLog src_hll;                         ///< Distinct sources (window edge rounded to a slice).
+    std::vector<TemplateCount> top_templates[3]; ///< Like StatsSnapshot::top_templates, within the window.
+};
+
+/** @brief Exponentially decayed arrival rates (see @ref StatsWindow::rate_horizons). */
+struct LevelRates {
+    std::chrono::milliseconds horizon{ 0 }; ///< Time constant of the decay.
+    double per_sec[3]{ 0.0, 0.0, 0.0 };     ///< Records per second by level.
+};
+
 /**
  * @brief Snapshot of aggregated metrics.
  * @details Arrays use index order: [ERROR, WARN, INFO].
@@ -26,20 +63,97 @@ struct StatsSnapshot {
     std::size_t max_len{ 0 };
     /** @brief Average message length. */
     double avg_len{ 0.0 };
+    /** @brief Message-length quantiles since start. */
+    LengthQuantiles len_q;
+    /** @brief Sketch behind @ref len_q (lets shards merge). */
+    QuantileSketch len_sketch;
+    /** @brief Estimated distinct message texts since start. */
+    std::uint64_t distinct_messages{ 0 };
+    /** @brief Estimated distinct sources (connections, datagram senders) since start. */
+    std::uint64_t distinct_sources{ 0 };
+    /** @brief Sketch behind @ref distinct_messages. */
+    HyperLogLog msg_hll;
+    /** @brief Sketch behind @ref distinct_sources. */
+    HyperLogLog src_hll;
 
-    /** @brief Records seen within the last hour (rolling window). */
+    /** @brief Records within the sliding window (the last hour by default). */
     std::uint64_t last_hour_total{ 0 };
-    /** @brief Last-hour totals by level. */
+    /** @brief Window totals by level. */
     std::uint64_t last_hour_by_level[3]{ 0, 0, 0 };
-    /** @brief Last-hour average message length. */
+    /** @brief Window average message length. */
     double last_hour_avg_len{ 0.0 };
+    /** @brief Window message-length quantiles (window edge rounded to a slice, see @ref StatsCollector::kSlices). */
+    LengthQuantiles last_hour_len_q;
+    /** @brief Sketch behind @ref last_hour_len_q. */
+    QuantileSketch last_hour_len_sketch;
+    /** @brief Window estimate of distinct message texts (edge rounded like @ref last_hour_len_q). */
+    std::uint64_t last_hour_distinct_messages{ 0 };
+    /** @brief Window estimate of distinct sources. */
+    std::uint64_t last_hour_distinct_sources{ 0 };
+    /** @brief Sketch behind @ref last_hour_distinct_messages. */
+    HyperLogLog last_hour_msg_hll;
+    /** @brief Sketch behind @ref last_hour_distinct_sources. */
+    HyperLogLog last_hour_src_hll;
+    /** @brief Like @ref top_templates, within the window (edge rounded like @ref last_hour_len_q). */
+    std::vector<TemplateCount> last_hour_top_templates[3];
+
+    /** @brief One entry per @ref StatsWindow::windows, same order. */
+    std::vector<WindowStats> windows;
+    /** @brief One entry per @ref StatsWindow::rate_horizons, same order. */
+    std::vector<LevelRates> rates;
+
+    /**
+     * @brief Most frequent message templates by level since start, highest count first.
+     * @details Up to TopTemplates::kCapacity each (the whole summary, so
+     * shards can merge); only records added with their text are counted.
+     */
+    std::vector<TemplateCount> top_templates[3];
+};
+
+/** @brief Shape of the sliding windows of a @ref StatsCollector. */
+struct StatsWindow {
+    /** @brief How far back the main window (last_hour_* fields) reaches. */
+    std::chrono::milliseconds length{ std::chrono::hours (1) };
+    /** @brief Bucket width; records leave a window one bucket at a time. */
+    std::chrono::milliseconds resolution{ std::chrono::seconds (1) };
+    /**
+     * @brief Further windows reported in StatsSnapshot::windows.
+     * @details All windows read the same bucket ring, which spans the
+     * longest of them and @ref length (24h at 1s buckets is ~3.5 MB).
+     */
+    std::vector<std::chrono::milliseconds> windows{ std::chrono::minutes (1), std::chrono::minutes (5),
+        std::chrono::minutes (15) };
+    /** @brief Time constants of the decayed rates in StatsSnapshot::rates. */
+    std::vector<std::chrono::milliseconds> rate_horizons{ std::chrono::minutes (1), std::chrono::minutes (5),
+        std::chrono::minutes (15) };
 };
 
 /**
- * @brief Thread-safe collector of log stats with a 1-hour sliding window.
+ * @brief Fold @p part into @p into, as if one collector had seen both streams.
+ * @details Counts add up, min/max combine, averages are weighted by the
+ * record counts behind them, quantiles are re-read from the merged
+ * sketches, and rates add up. Windows and rates are matched by position,
+ * so both collectors should share one @ref StatsWindow.
+ * @throws std::bad_alloc Growing the window, rate and template lists.
+ */
+void merge_snapshot (StatsSnapshot& into, const StatsSnapshot& part);
+
+/**
+ * @brief Thread-safe collector of log stats with sliding windows.
+ * @details @ref add may be called from any number of threads and takes no
+ * lock on its common path; @ref snapshot reports the totals since start,
+ * the windows of @ref StatsWindow and the decayed rates. A window may
+ * include up to one resolution step of older records, and its quantiles,
+ * distinct counts and template rankings move in steps of 1 / @ref kSlices
+ * of its length. Records older than the window ring or stamped more than
+ * @ref kMaxLead ahead count towards the totals only. A snapshot taken
+ * during concurrent adds may see a record's total before its level count.
  */
 class StatsCollector {
     public:
+    /** @brief Collector with the given window (one hour of one-second buckets by default). */
+    explicit StatsCollector (const StatsWindow& window = {});
+
     /**
      * @brief Add one record.
      * @param epoch_ms Timestamp in ms since Unix epoch (UTC).
@@ -49,35 +163,100 @@ class StatsCollector {
     void add (std::uint64_t epoch_ms, LogLevel lvl, std::size_t msg_len) noexcept;
 
     /**
-     * @brief Compute a snapshot for the given "now".
+     * @brief Add one record given its message text; also counts its template and distinct text.
+     * @param msg Message bytes; borrowed for the duration of the call only.
+     * @param source Id of the connection or sender, for the distinct-source
+     * estimates; 0 if unknown (not counted).
+     */
+    void add (std::uint64_t epoch_ms, LogLevel lvl, std::string_view msg, std::uint64_t source = 0) noexcept;
+
+    /**
+     * @brief Compute a snapshot for the given "now" and advance the decayed rates to it.
      * @param now_ms Current time in ms since Unix epoch.
-     * @return Aggregated statistics at this moment.
+     * @return Aggregated statistics at this moment; windows leave out records
+     * stamped after @p now_ms until a later snapshot catches up with them.
+     * @throws std::bad_alloc Filling the window, rate and template lists; the
+     * collector stays usable.
      */
-    StatsSnapshot snapshot (std::uint64_t now_ms) noexcept;
+    StatsSnapshot snapshot (std::uint64_t now_ms);
+
+    /** @brief Threads that get a slot of their own for the cumulative totals. */
+    static constexpr std::size_t kSlots = 32;
+    /** @brief Slices each window is kept in (its edge moves in steps of 1 / kSlices of its length). */
+    static constexpr std::size_t kSlices = 60;
+    /** @brief How far past the clock (or the newest record) a record may be stamped and still enter the windows. */
+    static constexpr std::chrono::milliseconds kMaxLead{ 60'000 };
 
     private:
-    struct Entry {
-        std::uint64_t epoch_ms;
-        LogLevel lvl;
-        std::size_t len;
+    /** @brief One thread's share of the cumulative totals. */
+    struct alignas (64) Slot {
+        std::atomic<std::uint64_t> total{ 0 };
+        std::atomic<std::uint64_t> by_level[3]{ { 0 }, { 0 }, { 0 } };
+        std::atomic<std::uint64_t> sum_len{ 0 };
+        std::atomic<std::size_t> min_len{ static_cast<std::size_t> (-1) };
+        std::atomic<std::size_t> max_len{ 0 };
+        std::atomic<std::uint64_t> len_hist[QuantileSketch::kBuckets]{};
+        std::mutex top_mu;                   ///< Guards @ref top.
+        std::unique_ptr<TopTemplates[]> top; ///< Templates by level (null until the first text record).
+    };
+
+    /** @brief Window tallies of one resolution interval. */
+    struct Bucket {
+        std::atomic<std::uint64_t> stamp{ 0 }; ///< epoch_ms / resolution + 1 of the records held (0 = unused).
+        std::atomic<std::uint64_t> by_level[3]{ { 0 }, { 0 }, { 0 } };
+        std::atomic<std::uint64_t> sum_len{ 0 };
+
+        void clear () noexcept;
     };
 
-    // Cumulative totals (printed statistics)
-    std::uint64_t _total{ 0 };
-    std::uint64_t _by_level[3]{ 0, 0, 0 };
-    std::size_t _min_len{ static_cast<std::size_t> (-1) };
-    std::size_t _max_len{ 0 };
-    long double _sum_len{ 0.0L };
+    /** @brief Window length histogram of one slice of the window. */
+    struct Slice {
+        std::atomic<std::uint64_t> stamp{ 0 }; ///< epoch_ms / slice width + 1 (0 = unused).
+        std::atomic<std::uint64_t> len_hist[QuantileSketch::kBuckets]{};
+        std::atomic<std::uint8_t> msg_hll[HyperLogLog::kRegisters]{};
+        std::atomic<std::uint8_t> src_hll[HyperLogLog::kRegisters]{};
+        std::mutex top_mu;                   ///< Guards @ref top.
+        std::unique_ptr<TopTemplates[]> top; ///< Templates by level (null until the first text record).
+
+        void clear () noexcept;
+    };
+
+    /** @brief Slices of one window length. */
+    struct SliceRing {
+        std::uint64_t len_ms{ 0 };        ///< Window length.
+        std::uint64_t width_ms{ 1 };      ///< Slice width.
+        std::size_t n{ 0 };               ///< Slices in the ring.
+        std::unique_ptr<Slice[]> slices;  ///< Ring, slot = stamp % n.
+        std::vector<std::size_t> windows; ///< Windows read from it: 0 = main, w + 1 = _win_ms[w].
+    };
 
-    std::deque<Entry> _window;
-    std::uint64_t _win_total{ 0 };
-    std::uint64_t _win_by_level[3]{ 0, 0, 0 };
-    long double _win_sum_len{ 0.0L };
+    // Cumulative totals (printed statistics), summed by snapshot().
+    Slot _slots[kSlots + 1]; ///< Per-thread slots, then the shared overflow slot.
+    std::atomic<std::uint8_t> _msg_hll[HyperLogLog::kRegisters]{}; ///< Distinct messages since start.
+    std::atomic<std::uint8_t> _src_hll[HyperLogLog::kRegisters]{}; ///< Distinct sources since start.
 
-    mutable std::mutex _mu;
+    std::uint64_t _res_ms{ 1 };         ///< Bucket width.
+    std::uint64_t _len_ms{ 0 };         ///< Main window length.
+    std::vector<std::uint64_t> _win_ms; ///< Further window lengths.
+    std::size_t _nbuckets{ 0 };         ///< Buckets in the ring.
+    std::unique_ptr<Bucket[]> _buckets; ///< Ring, slot = stamp % _nbuckets.
+    std::vector<SliceRing> _rings;      ///< One per distinct window length, the main window's first.
+    std::mutex _mu;                     ///< Serializes bucket/slice recycling against snapshot().
+    std::uint64_t _newest_ms{ 0 };      ///< Newest record or snapshot time seen (guarded by @ref _mu).
+
+    std::vector<LevelRates> _rates;     ///< Decayed rates (guarded by @ref _mu).
+    std::uint64_t _rate_at_ms{ 0 };     ///< When @ref _rates were last advanced (0 = not yet).
+    std::uint64_t _rate_base[3]{};      ///< Per-level totals at @ref _rate_at_ms.
+
+    /**
+     * @brief Element of @p ring (@p n long, @p width_ms each) for a record at
+     * @p epoch_ms, recycled if it still holds an older one; null if the
+     * record is older than the ring reaches or more than @ref kMaxLead ahead.
+     */
+    template <class T> T* claim (T* ring, std::size_t n, std::uint64_t width_ms, std::uint64_t epoch_ms) noexcept;
 
-    /** @brief Drop entries older than @p cutoff_ms from the window. */
-    void prune_older_than (std::uint64_t cutoff_ms) noexcept;
+    /** @brief Fold the arrivals since the last call into @ref _rates (caller holds @ref _mu). */
+    void advance_rates_locked (const std::uint64_t (&totals)[3], std::uint64_t now_ms) noexcept;
 
     /** @brief Map level to index: ERROR=0, WARN=1, INFO=2. */
     static int idx (const LogLevel l) noexcept {
@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * @file
+ * @brief Message template normalization and a streaming top-K of templates.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace logger {
+/** @brief Longest template kept; messages are grouped by their first this-many normalized bytes. */
+constexpr std::size_t kMaxTemplateLen = 64;
+
+/**
+ * @brief Reduce a message to its template in one pass.
+ * @details Every word ([0-9A-Za-z_] run) that holds a digit and is
+ * otherwise hex ("42", "7f3a9c01", "0x1F") becomes '#'; in other words each
+ * digit run becomes '#' ("user42" -> "user#"). Everything else is copied,
+ * so "took 12 ms for req 7f3a9c01" -> "took # ms for req #". At most
+ * 4 * @p cap input bytes are read.
+ * @param out Destination with room for @p cap bytes (not NUL-terminated).
+ * @return Bytes written (at most @p cap).
+ */
+std::size_t normalize_template (std::string_view msg, char* out, std::size_t cap) noexcept;
+
+/** @brief One entry of a @ref TopTemplates report. */
+struct TemplateCount {
+    std::string text;         ///< Normalized template.
+    std::uint64_t count{ 0 }; ///< Estimated occurrences (never below the true count).
+    std::uint64_t error{ 0 }; ///< Overestimate bound: the true count is at least count - error.
+};
+
+/**
+ * @brief Most frequent templates of a stream (Space-Saving).
+ * @details Tracks @ref kCapacity templates in fixed arrays: a hit bumps its
+ * counter, a miss takes over the smallest counter and inherits its count
+ * as the error. Any template seen more than total / @ref kCapacity times
+ * is guaranteed to be tracked. A min-heap over the counters and an
+ * open-addressed index keyed by template hash make every update O(1) for
+ * the fixed capacity (a few sift steps, no allocation). Not thread-safe.
+ */
+class TopTemplates {
+    public:
+    static constexpr std::size_t kCapacity = 64;
+
+    /** @brief Normalize @p msg (see @ref normalize_template) and count it. */
+    void add (std::string_view msg) noexcept;
+
+    /**
+     * @brief Count @p weight occurrences of an already normalized template.
+     * @param hash hash_bytes of @p tmpl.
+     * @param error Overestimate already carried by @p weight (when merging).
+     */
+    void offer (std::uint64_t hash, std::string_view tmpl, std::uint64_t weight = 1, std::uint64_t error = 0) noexcept;
+
+    /**
+     * @brief Fold @p other in by offering each of its counters.
+     * @details Counts stay upper bounds and the errors bound the excess,
+     * though the merged summary can be less precise than one that saw
+     * both streams.
+     */
+    void merge (const TopTemplates& other) noexcept;
+
+    /** @brief Up to @p k tracked templates, highest count first. */
+    std::vector<TemplateCount> top (std::size_t k = kCapacity) const;
+
+    /** @brief Occurrences counted (sum of offered weights). */
+    std::uint64_t total () const noexcept {
+        return _total;
+    }
+
+    private:
+    static constexpr std::size_t kIndexSize = 2 * kCapacity; ///< Power of two, at most half full.
+
+    struct Counter {
+        std::uint64_t hash{ 0 };
+        std::uint64_t count{ 0 };
+        std::uint64_t error{ 0 };
+        std::uint8_t len{ 0 };
+        char text[kMaxTemplateLen];
+    };
+
+    Counter _c[kCapacity];              ///< Counters; the first @ref _size are in use.
+    std::uint8_t _heap[kCapacity]{};    ///< Counter numbers, min-heap on count.
+    std::uint8_t _pos[kCapacity]{};     ///< Heap position of each counter.
+    std::uint8_t _index[kIndexSize]{};  ///< Counter number + 1 by hash, linear probing (0 = empty).
+    std::size_t _size{ 0 };             ///< Counters in use.
+    std::uint64_t _total{ 0 };          ///< Sum of offered weights.
+
+    /** @brief Index slot holding @p hash, or the empty slot where it would go. */
+    std::size_t find (std::uint64_t hash) const noexcept;
+
+    /** @brief Drop the index entry at @p slot, shifting later probes back. */
+    void unindex (std::size_t slot) noexcept;
+
+    /** @brief Restore heap order after the count at heap position @p i grew. */
+    void sift_down (std::size_t i) noexcept;
+
+    /** @brief Move the counter at heap position @p i towards the root. */
+    void sift_up (std::size_t i) noexcept;
+};
+} // namespace logger
@@ -4,6 +4,7 @@
  * @brief Time and parsing utilities.
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
@@ -22,6 +23,68 @@ std::uint64_t now_epoch_ms () noexcept;
  */
 std::string iso8601_utc (std::uint64_t epoch_ms) noexcept;
 
+/** @brief Length of the "YYYY-MM-DDTHH:MM:SSZ" form. */
+constexpr std::size_t kIso8601Len = 20;
+
+/**
+ * @brief Format timestamp as ISO-8601 UTC into a caller buffer.
+ * @param epoch_ms Milliseconds since Unix epoch (UTC).
+ * @param out Destination with room for @ref kIso8601Len chars (not NUL-terminated).
+ * @return Number of chars written (always @ref kIso8601Len).
+ */
+std::size_t format_iso8601_utc (std::uint64_t epoch_ms, char* out) noexcept;
+
+/** @brief Sub-second digits emitted by @ref TimestampFormatter. */
+enum class TimePrecision : std::uint8_t {
+    Seconds, ///< "YYYY-MM-DDTHH:MM:SSZ"
+    Millis,  ///< "YYYY-MM-DDTHH:MM:SS.mmmZ"
+    Micros   ///< "YYYY-MM-DDTHH:MM:SS.uuuuuuZ"
+};
+
+/** @brief Longest output of @ref TimestampFormatter. */
+constexpr std::size_t kIso8601MaxLen = 27;
+
+/**
+ * @brief ISO-8601 UTC formatter that caches the current date and second.
+ * @details gmtime_r runs once per UTC day; within a day the time of day is
+ * derived arithmetically, and within a second only the sub-second digits
+ * are patched. Output matches @ref format_iso8601_utc for
+ * TimePrecision::Seconds.
+ * @note Not thread-safe: keep one per thread or use it under a lock.
+ */
+class TimestampFormatter {
+    public:
+    explicit TimestampFormatter (TimePrecision precision = TimePrecision::Seconds) noexcept : _precision (precision) {
+    }
+
+    /**
+     * @brief Format milliseconds since epoch into @p out.
+     * @param out Room for @ref kIso8601MaxLen chars (not NUL-terminated).
+     * @return Number of chars written.
+     */
+    std::size_t format (std::uint64_t epoch_ms, char* out) noexcept;
+
+    /**
+     * @brief Format microseconds since epoch into @p out.
+     * @return Number of chars written.
+     */
+    std::size_t format_us (std::uint64_t epoch_us, char* out) noexcept;
+
+    /** @brief Selected precision. */
+    TimePrecision precision () const noexcept {
+        return _precision;
+    }
+
+    private:
+    /** @brief Refresh @ref _prefix for @p sec (epoch seconds). */
+    void update_second (std::uint64_t sec) noexcept;
+
+    TimePrecision _precision;
+    std::uint64_t _sec{ ~0ull }; ///< Second rendered in @ref _prefix.
+    std::uint64_t _day{ ~0ull }; ///< UTC day rendered in @ref _prefix.
+    char _prefix[19]{};          ///< "YYYY-MM-DDTHH:MM:SS".
+};
+
 /**
  * @brief Parse "host:port" into parts.
  * @param in Input string (e.g., "example.com:8080").
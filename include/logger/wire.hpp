@@ -0,0 +1,91 @@
+#pragma once
+/**
+ * @file
+ * @brief Binary framing of the SocketSink → stats_collector stream.
+ */
+
+#include "log_level.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace logger {
+/**
+ * @brief Length-prefixed binary wire protocol, version 1.
+ * @details A client opts in by sending @ref kHello as the first bytes of a
+ * connection; a collector that understands it answers @ref kAccept, and
+ * from then on the client sends blocks. Anything else (or no answer) means
+ * the peer only speaks the text protocol, "epoch_ms|LEVEL|message\n".
+ *
+ * Block:  varint body_len, u8 flags, body, [u32 crc32(body) if flags & @ref kFlagCrc]
+ * Record: varint message_len, u64 epoch_ms, u8 level, message bytes
+ *
+ * Integers are little-endian; varints are LEB128. A block body holds whole
+ * records and is delivered all or nothing: a collector ignores a block cut
+ * short by a dropped connection. Messages may contain any byte, '\n'
+ * included.
+ */
+namespace wire {
+constexpr std::string_view kHello  = "LGWIRE/1\n";
+constexpr std::string_view kAccept = "LGWIRE/1 OK\n";
+
+constexpr std::uint8_t kFlagCrc         = 0x01;
+constexpr std::size_t kRecordFixedBytes = 8 + 1;
+constexpr std::size_t kMaxVarintBytes   = 10;
+constexpr std::size_t kMaxBlockHeader   = kMaxVarintBytes + 1;
+constexpr std::uint64_t kMaxBlockBytes  = 64ull << 20; ///< Larger lengths are treated as corruption.
+constexpr std::size_t kMaxMessageBytes  = kMaxBlockBytes - kMaxVarintBytes - kRecordFixedBytes;
+
+/** @brief Result of a decode step. */
+enum class Decode { Ok, NeedMore, Corrupt };
+
+/** @brief One decoded record; @ref message points into the block. */
+struct RecordView {
+    std::uint64_t epoch_ms{ 0 };
+    LogLevel level{ LogLevel::Info };
+    std::string_view message;
+};
+
+/** @brief Append @p v as a LEB128 varint. */
+void put_varint (std::string& out, std::uint64_t v);
+
+/** @brief Write @p v as a LEB128 varint into @p out; returns the bytes used. */
+std::size_t put_varint (char* out, std::uint64_t v) noexcept;
+
+/** @brief Read a varint from the front of @p in and advance past it. */
+Decode get_varint (std::string_view& in, std::uint64_t& v) noexcept;
+
+/** @brief CRC-32 (IEEE 802.3) of @p n bytes, continuing from @p crc. */
+std::uint32_t crc32 (const char* data, std::size_t n, std::uint32_t crc = 0) noexcept;
+
+/** @brief Append one encoded record; messages beyond @ref kMaxMessageBytes are cut. */
+void append_record (std::string& out, std::uint64_t epoch_ms, LogLevel level, std::string_view msg);
+
+/**
+ * @brief Encode the header of a block with a @p body_len byte body.
+ * @return Bytes written to @p out (at most @ref kMaxBlockHeader).
+ */
+std::size_t block_header (char* out, std::size_t body_len, bool crc) noexcept;
+
+/**
+ * @brief Split the next block off the front of @p in.
+ * @param body Block body on success (points into @p in).
+ * @param consumed Bytes of @p in the block occupies on success.
+ * @return Corrupt on an implausible length, unknown flags or a checksum mismatch.
+ */
+Decode next_block (std::string_view in, std::string_view& body, std::size_t& consumed) noexcept;
+
+/** @brief Decode the record at the front of @p body and advance past it. */
+Decode next_record (std::string_view& body, RecordView& out) noexcept;
+
+/** @brief Encoded size of the record at the front of @p records (0 if its header is incomplete or invalid). */
+std::size_t record_size (std::string_view records) noexcept;
+
+/** @brief Length of the complete records within the first @p len bytes of @p records. */
+std::size_t whole_records (std::string_view records, std::size_t len) noexcept;
+
+/** @brief Append @p records rendered as text lines ('\n' in messages becomes a space). */
+bool append_as_text (std::string& out, std::string_view records);
+} // namespace wire
+} // namespace logger
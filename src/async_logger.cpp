@@ -0,0 +1,196 @@
+#include "logger/logger.hpp"
+#include "logger/log_entry.hpp"
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace logger {
+namespace {
+constexpr std::size_t kDrainBatch = 256;
+constexpr int kPushSpins          = 64;
+constexpr auto kIdleWait          = std::chrono::milliseconds (100);
+constexpr auto kDoneWait          = std::chrono::milliseconds (10);
+
+/** @brief Counts a producer as in flight for its lifetime. */
+class InFlight {
+    public:
+    explicit InFlight (std::atomic<int>& n) noexcept : _n (n) {
+        _n.fetch_add (1);
+    }
+    ~InFlight () {
+        _n.fetch_sub (1, std::memory_order_release);
+    }
+
+    InFlight (const InFlight&)            = delete;
+    InFlight& operator= (const InFlight&) = delete;
+
+    private:
+    std::atomic<int>& _n;
+};
+} // namespace
+
+AsyncLogger::AsyncLogger (std::unique_ptr<ILogSink> sink, const LogLevel default_level, const AsyncOptions opts)
+: _sink (std::move (sink)), _default (default_level), _overflow (opts.overflow),
+  _ring (opts.capacity, opts.message_reserve) {
+    _worker = std::thread ([this] { run (); });
+}
+
+AsyncLogger::~AsyncLogger () {
+    stop ();
+}
+
+Status AsyncLogger::log (const LogLevel level, const std::string_view msg) noexcept {
+    if (!enabled (level)) {
+        return Status::Filtered;
+    }
+    // Registered before the check (both seq_cst), so stop() either sees us
+    // in flight and waits, or we see the flag.
+    const InFlight in_flight (_producers);
+    if (_stop.load ()) {
+        _dropped_newest.fetch_add (1, std::memory_order_relaxed);
+        return Status::Dropped;
+    }
+    const std::uint64_t ts = now_epoch_ms ();
+    for (int spin = 0; !_ring.try_push (ts, level, msg); ++spin) {
+        switch (_overflow) {
+        case OverflowPolicy::DropNewest:
+            _dropped_newest.fetch_add (1, std::memory_order_relaxed);
+            return Status::Dropped;
+        case OverflowPolicy::DropOldest: {
+            if (_ring.try_drop ()) {
+                _dropped_oldest.fetch_add (1, std::memory_order_relaxed);
+                _consumed.fetch_add (1, std::memory_order_release);
+            }
+            break;
+        }
+        case OverflowPolicy::Block:
+            if (_stop.load (std::memory_order_acquire)) {
+                _dropped_newest.fetch_add (1, std::memory_order_relaxed);
+                return Status::Dropped;
+            }
+            if (spin < kPushSpins) {
+                std::this_thread::yield ();
+                break;
+            }
+            _waiters.fetch_add (1);
+            wake_consumer ();
+            {
+                std::unique_lock lk (_done_mu);
+                _done_cv.wait_for (lk, kDoneWait);
+            }
+            _waiters.fetch_sub (1);
+            break;
+        }
+    }
+    _enqueued.fetch_add (1, std::memory_order_release);
+    wake_consumer ();
+    return Status::Ok;
+}
+
+void AsyncLogger::wake_consumer () noexcept {
+    // Pairs with the fence in run(): either the worker sees the new record
+    // before sleeping, or we see it sleeping and notify.
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (_sleeping.load (std::memory_order_relaxed)) {
+        std::lock_guard lk (_wake_mu);
+        _wake_cv.notify_one ();
+    }
+}
+
+void AsyncLogger::run () noexcept {
+    std::vector<LogEntry> batch (kDrainBatch);
+    for (;;) {
+        std::size_t n = 0;
+        while (n < batch.size () && _ring.try_pop (batch[n]))
+            ++n;
+        if (n > 0) {
+            std::string err;
+            const std::size_t ok = _sink ? _sink->write_batch (batch.data (), n, err) : 0;
+            if (ok < n || !err.empty ()) {
+                _write_errors.fetch_add (n - ok, std::memory_order_relaxed);
+                std::lock_guard lk (_err_mu);
+                _last_err = err.empty () ? "Unknown sink error" : err;
+            }
+            _written.fetch_add (ok, std::memory_order_relaxed);
+            _consumed.fetch_add (n, std::memory_order_release);
+            if (_waiters.load () > 0) {
+                std::lock_guard lk (_done_mu);
+                _done_cv.notify_all ();
+            }
+            continue;
+        }
+        if (_stop.load (std::memory_order_acquire) && _ring.empty ())
+            break;
+
+        std::unique_lock lk (_wake_mu);
+        _sleeping.store (true, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        if (_ring.empty () && !_stop.load (std::memory_order_acquire))
+            _wake_cv.wait_for (lk, kIdleWait);
+        _sleeping.store (false, std::memory_order_relaxed);
+    }
+    _worker_done.store (true, std::memory_order_release);
+    std::lock_guard lk (_done_mu);
+    _done_cv.notify_all ();
+}
+
+void AsyncLogger::flush () noexcept {
+    const std::uint64_t target = _enqueued.load (std::memory_order_acquire);
+    if (_consumed.load (std::memory_order_acquire) < target) {
+        _waiters.fetch_add (1);
+        wake_consumer ();
+        while (_consumed.load (std::memory_order_acquire) < target && !_worker_done.load (std::memory_order_acquire)) {
+            std::unique_lock lk (_done_mu);
+            _done_cv.wait_for (lk, kDoneWait);
+        }
+        _waiters.fetch_sub (1);
+    }
+    if (_sink)
+        _sink->flush ();
+}
+
+void AsyncLogger::stop () noexcept {
+    std::lock_guard lk (_stop_mu);
+    if (!_worker.joinable ())
+        return;
+    _stop.store (true);
+    {
+        std::lock_guard wk (_wake_mu);
+        _wake_cv.notify_one ();
+    }
+    _worker.join ();
+    // Producers that passed the stop check just before it was set may still
+    // push; blocked ones see the flag within kDoneWait and give up.
+    {
+        std::lock_guard dk (_done_mu);
+        _done_cv.notify_all ();
+    }
+    while (_producers.load (std::memory_order_acquire) != 0)
+        std::this_thread::yield ();
+    for (LogEntry e; _ring.try_pop (e);) {
+        if (std::string err; _sink && _sink->write (e, err))
+            _written.fetch_add (1, std::memory_order_relaxed);
+        else
+            _write_errors.fetch_add (1, std::memory_order_relaxed);
+        _consumed.fetch_add (1, std::memory_order_release);
+    }
+    if (_sink)
+        _sink->flush ();
+}
+
+std::string AsyncLogger::last_error () const {
+    std::lock_guard lk (_err_mu);
+    return _last_err;
+}
+
+AsyncCounters AsyncLogger::counters () const noexcept {
+    AsyncCounters c;
+    c.enqueued       = _enqueued.load (std::memory_order_relaxed);
+    c.written        = _written.load (std::memory_order_relaxed);
+    c.dropped_newest = _dropped_newest.load (std::memory_order_relaxed);
+    c.dropped_oldest = _dropped_oldest.load (std::memory_order_relaxed);
+    c.write_errors   = _write_errors.load (std::memory_order_relaxed);
+    return c;
+}
+} // namespace logger
@@ -0,0 +1,280 @@
+#include "logger/binary_log.hpp"
+#include "logger/utils.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace logger {
+namespace binlog {
+namespace {
+struct FormatTable {
+    std::mutex mu;
+    std::deque<std::string> texts; ///< Indexed by id; deque keeps views stable.
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+};
+
+FormatTable& table () {
+    static FormatTable t;
+    return t;
+}
+} // namespace
+
+std::uint32_t register_format (const std::string_view fmt) noexcept {
+    auto& t = table ();
+    // Out of memory the call site keeps kUnregistered and retries next time;
+    // its records carry the format text meanwhile.
+    try {
+        std::lock_guard lk (t.mu);
+        if (const auto it = t.ids.find (fmt); it != t.ids.end ())
+            return it->second;
+        const auto id = static_cast<std::uint32_t> (t.texts.size ());
+        if (id == kUnregistered)
+            return kUnregistered;
+        t.texts.emplace_back (fmt);
+        try {
+            t.ids.emplace (t.texts.back (), id);
+        } catch (...) {
+            t.texts.pop_back ();
+            throw;
+        }
+        return id;
+    } catch (...) {
+        return kUnregistered;
+    }
+}
+
+std::string_view format_text (const std::uint32_t id) noexcept {
+    auto& t = table ();
+    std::lock_guard lk (t.mu);
+    return id < t.texts.size () ? std::string_view (t.texts[id]) : std::string_view{};
+}
+} // namespace binlog
+
+namespace {
+bool write_all (const int fd, const char* data, std::size_t len, std::string& err) noexcept {
+    while (len > 0) {
+        const ssize_t n = ::write (fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err = std::string ("BinaryLogger: write failed: ") + std::strerror (errno);
+            return false;
+        }
+        data += n;
+        len -= static_cast<std::size_t> (n);
+    }
+    return true;
+}
+} // namespace
+
+BinaryLogger::BinaryLogger (const std::string& path, const LogLevel default_level, const std::size_t buffer_bytes) noexcept
+: _default (default_level) {
+    _fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd == -1)
+        return;
+    _buf.resize (std::max (buffer_bytes, binlog::kMaxRecord));
+    struct stat st{};
+    if (::fstat (_fd, &st) == 0 && st.st_size == 0) {
+        std::memcpy (_buf.data (), binlog::kMagic, sizeof (binlog::kMagic));
+        _used = sizeof (binlog::kMagic);
+    }
+}
+
+BinaryLogger::~BinaryLogger () {
+    flush ();
+    if (_fd != -1)
+        ::close (_fd);
+}
+
+bool BinaryLogger::drain (std::string& err) noexcept {
+    if (_used == 0)
+        return true;
+    const bool ok = write_all (_fd, _buf.data (), _used, err);
+    _used         = 0;
+    return ok;
+}
+
+bool BinaryLogger::emit_format (const std::uint32_t fmt_id) noexcept {
+    if (fmt_id == binlog::kUnregistered || (fmt_id < _emitted.size () && _emitted[fmt_id]))
+        return true;
+    const std::string_view text = binlog::format_text (fmt_id);
+    const auto len              = static_cast<std::uint16_t> (std::min<std::size_t> (text.size (), 0xFFFF));
+    const std::size_t need      = 1 + 4 + 2 + len;
+    if (_used + need > _buf.size () && !drain (_last_err))
+        return false;
+    char* p = _buf.data () + _used;
+    p[0]    = binlog::kFormatRecord;
+    std::memcpy (p + 1, &fmt_id, 4);
+    std::memcpy (p + 5, &len, 2);
+    if (need > _buf.size ()) {
+        if (!write_all (_fd, p, 7, _last_err) || !write_all (_fd, text.data (), len, _last_err))
+            return false;
+    } else {
+        std::memcpy (p + 7, text.data (), len);
+        _used += need;
+    }
+    if (fmt_id >= _emitted.size ())
+        _emitted.resize (fmt_id + 1, false);
+    _emitted[fmt_id] = true;
+    return true;
+}
+
+Status BinaryLogger::append (const std::uint32_t fmt_id, const char* rec, const std::size_t len) noexcept {
+    std::lock_guard lk (_mu);
+    if (_fd == -1) {
+        _last_err = "BinaryLogger: log file is not open";
+        return Status::IoError;
+    }
+    if (!emit_format (fmt_id))
+        return Status::IoError;
+    if (_used + len > _buf.size () && !drain (_last_err))
+        return Status::IoError;
+    std::memcpy (_buf.data () + _used, rec, len);
+    _used += len;
+    return Status::Ok;
+}
+
+std::string BinaryLogger::last_error () const {
+    std::lock_guard lk (_mu);
+    return _last_err;
+}
+
+void BinaryLogger::flush () noexcept {
+    std::lock_guard lk (_mu);
+    if (_fd != -1)
+        drain (_last_err);
+}
+
+namespace {
+template <class T> bool read_pod (std::istream& in, T& v) {
+    return static_cast<bool> (in.read (reinterpret_cast<char*> (&v), sizeof (v)));
+}
+
+bool render (const std::string_view fmt, const std::string_view args, std::string& out) {
+    std::size_t ap = 0;
+    char num[32];
+    for (std::size_t i = 0; i < fmt.size (); ++i) {
+        if (fmt[i] != '{' || i + 1 >= fmt.size () || fmt[i + 1] != '}' || ap >= args.size ()) {
+            out += fmt[i];
+            continue;
+        }
+        ++i;
+        const char tag = args[ap++];
+        if (tag == 's') {
+            std::uint16_t len = 0;
+            if (ap + 2 > args.size ())
+                return false;
+            std::memcpy (&len, args.data () + ap, 2);
+            if (ap + 2 + len > args.size ())
+                return false;
+            out.append (args.data () + ap + 2, len);
+            ap += 2u + len;
+            continue;
+        }
+        if (ap + 8 > args.size ())
+            return false;
+        std::to_chars_result res{};
+        if (tag == 'i') {
+            std::int64_t v;
+            std::memcpy (&v, args.data () + ap, 8);
+            res = std::to_chars (num, num + sizeof (num), v);
+        } else if (tag == 'u') {
+            std::uint64_t v;
+            std::memcpy (&v, args.data () + ap, 8);
+            res = std::to_chars (num, num + sizeof (num), v);
+        } else if (tag == 'd') {
+            double v;
+            std::memcpy (&v, args.data () + ap, 8);
+            res = std::to_chars (num, num + sizeof (num), v);
+        } else {
+            return false;
+        }
+        out.append (num, res.ptr);
+        ap += 8;
+    }
+    return true;
+}
+} // namespace
+
+bool decode_binary_log (std::istream& in, std::ostream& out, std::string& err) {
+    char magic[sizeof (binlog::kMagic)];
+    if (!in.read (magic, sizeof (magic)) || std::memcmp (magic, binlog::kMagic, sizeof (magic)) != 0) {
+        err = "log_decode: not a binary log (bad magic)";
+        return false;
+    }
+    std::unordered_map<std::uint32_t, std::string> formats;
+    std::string args, line;
+    char ts[kIso8601Len];
+    for (int type; (type = in.get ()) != std::char_traits<char>::eof ();) {
+        if (type == binlog::kFormatRecord) {
+            std::uint32_t id  = 0;
+            std::uint16_t len = 0;
+            if (!read_pod (in, id) || !read_pod (in, len)) {
+                err = "log_decode: truncated format record";
+                return false;
+            }
+            std::string& text = formats[id];
+            text.resize (len);
+            if (!in.read (text.data (), len)) {
+                err = "log_decode: truncated format record";
+                return false;
+            }
+        } else if (type == binlog::kLogRecord) {
+            std::uint64_t epoch_ms = 0;
+            std::uint8_t lvl       = 0;
+            std::uint32_t id       = 0;
+            std::uint16_t len      = 0;
+            if (!read_pod (in, epoch_ms) || !read_pod (in, lvl) || !read_pod (in, id) || !read_pod (in, len)) {
+                err = "log_decode: truncated log record";
+                return false;
+            }
+            args.resize (len);
+            if (!in.read (args.data (), len)) {
+                err = "log_decode: truncated log record";
+                return false;
+            }
+            std::string_view fmt, rest = args;
+            if (id == binlog::kUnregistered) {
+                // The format text is the first argument.
+                std::uint16_t flen = 0;
+                if (args.size () >= 3 && args[0] == 's')
+                    std::memcpy (&flen, args.data () + 1, 2);
+                if (args.size () < 3 || args[0] != 's' || 3u + flen > args.size ()) {
+                    err = "log_decode: malformed arguments";
+                    return false;
+                }
+                fmt  = rest.substr (3, flen);
+                rest = rest.substr (3u + flen);
+            } else if (const auto it = formats.find (id); it != formats.end ()) {
+                fmt = it->second;
+            } else {
+                err = "log_decode: record references unknown format id " + std::to_string (id);
+                return false;
+            }
+            line.assign (ts, format_iso8601_utc (epoch_ms, ts));
+            line += ' ';
+            line += to_string (static_cast<LogLevel> (lvl));
+            line += ' ';
+            if (!render (fmt, rest, line)) {
+                err = "log_decode: malformed arguments";
+                return false;
+            }
+            line += '\n';
+            out.write (line.data (), static_cast<std::streamsize> (line.size ()));
+        } else {
+            err = "log_decode: unknown record type";
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace logger
@@ -0,0 +1,161 @@
+#include "logger/datagram_sink.hpp"
+#include "logger/log_level.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+#include <netdb.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace logger {
+namespace {
+constexpr std::size_t kSendmmsgMax = 1024; // UIO_MAXIOV
+} // namespace
+
+DatagramSink::DatagramSink (std::string host, const std::uint16_t port) noexcept
+: _host (std::move (host)), _port (port) {
+}
+
+DatagramSink::DatagramSink (UnixPath path) noexcept : _unix_path (std::move (path.path)) {
+}
+
+DatagramSink::~DatagramSink () {
+    if (_fd != -1)
+        ::close (_fd);
+}
+
+bool DatagramSink::open_locked (std::string& err) noexcept {
+    if (_fd != -1)
+        return true;
+    if (!_unix_path.empty ()) {
+        sockaddr_storage addr{};
+        socklen_t len = 0;
+        if (!fill_unix_address (_unix_path, addr, len)) {
+            err = "DatagramSink: unix socket path too long: " + _unix_path;
+            return false;
+        }
+        const int fd = ::socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        // A local receiver queues only net.unix.max_dgram_qlen datagrams (10
+        // by default): sends wait for it to catch up, but never longer than
+        // kUnixSendTimeout per call, so a stalled receiver cannot hold _mu.
+        timeval tv{};
+        tv.tv_usec = static_cast<suseconds_t> (kUnixSendTimeout.count () * 1000);
+        if (fd == -1 || ::setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv)) != 0 ||
+        ::connect (fd, reinterpret_cast<const sockaddr*> (&addr), len) != 0) {
+            err = std::string ("DatagramSink: connect failed: ") + std::strerror (errno);
+            if (fd != -1)
+                ::close (fd);
+            return false;
+        }
+        _fd = fd;
+        return true;
+    }
+
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* res              = nullptr;
+    const std::string port_str = std::to_string (_port);
+    if (const int rc = getaddrinfo (_host.c_str (), port_str.c_str (), &hints, &res); rc != 0) {
+        err = std::string ("get addr info: ") + gai_strerror (rc);
+        return false;
+    }
+    // connect() only fixes the destination; no packet is sent.
+    for (const addrinfo* p = res; p != nullptr && _fd == -1; p = p->ai_next) {
+        const int fd = ::socket (p->ai_family, p->ai_socktype | SOCK_CLOEXEC, p->ai_protocol);
+        if (fd == -1)
+            continue;
+        if (::connect (fd, p->ai_addr, p->ai_addrlen) == 0)
+            _fd = fd;
+        else
+            ::close (fd);
+    }
+    freeaddrinfo (res);
+    if (_fd == -1) {
+        err = "DatagramSink: no usable address";
+        return false;
+    }
+    return true;
+}
+
+void DatagramSink::append_locked (const std::uint64_t epoch_ms, const LogLevel level, std::string_view msg) {
+    const std::string_view lvl = to_string (level);
+    char digits[20];
+    const auto res           = std::to_chars (digits, digits + sizeof (digits), epoch_ms);
+    const std::size_t prefix = static_cast<std::size_t> (res.ptr - digits) + 1 + lvl.size () + 1;
+    if (prefix + msg.size () + 1 > kMaxDatagram)
+        msg = msg.substr (0, kMaxDatagram - prefix - 1);
+    _buf.append (digits, res.ptr);
+    _buf += '|';
+    _buf += lvl;
+    _buf += '|';
+    _buf += msg;
+    _buf += '\n';
+    _ends.push_back (_buf.size ());
+}
+
+std::size_t DatagramSink::send_locked (const std::size_t count, std::string& err) noexcept {
+    if (!open_locked (err)) {
+        _dropped.fetch_add (count, std::memory_order_relaxed);
+        return 0;
+    }
+    _iov.resize (count);
+    _msgs.resize (count);
+    for (std::size_t i = 0, begin = 0; i < count; begin = _ends[i++]) {
+        _iov[i]                     = iovec{ _buf.data () + begin, _ends[i] - begin };
+        _msgs[i]                    = mmsghdr{};
+        _msgs[i].msg_hdr.msg_iov    = &_iov[i];
+        _msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    // UDP never waits; AF_UNIX waits up to SO_SNDTIMEO (see open_locked).
+    const int flags  = MSG_NOSIGNAL | (_unix_path.empty () ? MSG_DONTWAIT : 0);
+    std::size_t done = 0;
+    while (done < count) {
+        const auto vlen = static_cast<unsigned> (std::min (count - done, kSendmmsgMax));
+        const int n     = ::sendmmsg (_fd, _msgs.data () + done, vlen, flags);
+        if (n > 0) {
+            done += static_cast<std::size_t> (n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        const int e = errno;
+        err         = std::string ("DatagramSink: send failed: ") + std::strerror (e);
+        if (e != EAGAIN && e != EWOULDBLOCK) {
+            // e.g. the receiver went away; open a fresh socket next time.
+            ::close (_fd);
+            _fd = -1;
+        }
+        break;
+    }
+    _dropped.fetch_add (count - done, std::memory_order_relaxed);
+    return done;
+}
+
+bool DatagramSink::write (const LogEntry& e, std::string& err) noexcept {
+    return write_view (LogEntryView{ e.epoch_ms, e.level, e.message }, err);
+}
+
+bool DatagramSink::write_view (const LogEntryView& e, std::string& err) noexcept {
+    std::lock_guard lk (_mu);
+    _buf.clear ();
+    _ends.clear ();
+    append_locked (e.epoch_ms, e.level, e.message);
+    return send_locked (1, err) == 1;
+}
+
+std::size_t DatagramSink::write_batch (const LogEntry* entries, const std::size_t count, std::string& err) noexcept {
+    std::lock_guard lk (_mu);
+    _buf.clear ();
+    _ends.clear ();
+    for (std::size_t i = 0; i < count; ++i)
+        append_locked (entries[i].epoch_ms, entries[i].level, entries[i].message);
+    return send_locked (count, err);
+}
+} // namespace logger
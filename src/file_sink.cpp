@@ -1,34 +1,710 @@
 #include "logger/file_sink.hpp"
 #include "logger/log_level.hpp"
 #include "logger/utils.hpp"
-#include <iostream>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <regex>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef LOGGER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define LOGGER_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 namespace logger {
+namespace {
+constexpr std::uint64_t kRotateBackoffMinMs = 1000;  ///< First retry delay after a failed rotation.
+constexpr std::uint64_t kRotateBackoffMaxMs = 60000; ///< Cap of the doubling retry delay.
+
+bool write_fully (const int fd, iovec* iov, int cnt, std::string& err) noexcept {
+    while (cnt > 0) {
+        ssize_t n = ::writev (fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err = std::string ("FileSink: write failed: ") + std::strerror (errno);
+            return false;
+        }
+        while (cnt > 0 && static_cast<std::size_t> (n) >= iov->iov_len) {
+            n -= static_cast<ssize_t> (iov->iov_len);
+            ++iov;
+            --cnt;
+        }
+        if (cnt > 0) {
+            iov->iov_base = static_cast<char*> (iov->iov_base) + n;
+            iov->iov_len -= static_cast<std::size_t> (n);
+        }
+    }
+    return true;
+}
+
+bool exists (const std::string& path) noexcept {
+    struct stat st{};
+    return ::stat (path.c_str (), &st) == 0;
+}
+
+void replace_all (std::string& s, const std::string_view from, const std::string_view to) {
+    for (std::size_t pos = 0; (pos = s.find (from, pos)) != std::string::npos; pos += to.size ())
+        s.replace (pos, from.size (), to);
+}
+
+std::string utc_stamp (const std::uint64_t epoch_ms) {
+    const auto tt = static_cast<std::time_t> (epoch_ms / 1000ull);
+    std::tm tm{};
+    gmtime_r (&tt, &tm);
+    char buf[32];
+    std::strftime (buf, sizeof (buf), "%Y%m%dT%H%M%S", &tm);
+    return buf;
+}
+
+/** @brief Regex matching files produced by @p pattern for @p path (plus ".gz"). */
+std::regex rotated_regex (std::string pattern, const std::string& path) {
+    static const std::regex special (R"([.^$|()\[\]{}*+?\\])");
+    replace_all (pattern, "{path}", "\x01");
+    replace_all (pattern, "{n}", "\x02");
+    replace_all (pattern, "{time}", "\x03");
+    std::string re = std::regex_replace (pattern, special, "\\$&");
+    replace_all (re, "\x01", std::regex_replace (path, special, "\\$&"));
+    replace_all (re, "\x02", "\\d+");
+    replace_all (re, "\x03", "\\d{8}T\\d{6}");
+    return std::regex (re + "(\\.\\d+)?(\\.gz)?");
+}
+
+/** @brief Existing rotated files, oldest first. */
+std::deque<std::string> discover_rotated (const std::string& pattern, const std::string& path) {
+    namespace fs = std::filesystem;
+    std::deque<std::string> out;
+    std::string probe = pattern;
+    replace_all (probe, "{path}", path);
+    const fs::path dir = fs::path (probe).parent_path ().empty () ? fs::path (".") : fs::path (probe).parent_path ();
+    if (dir.string ().find ('{') != std::string::npos)
+        return out;
+    std::error_code ec;
+    const std::regex re = rotated_regex (pattern, path);
+    std::vector<std::pair<fs::file_time_type, std::string>> found;
+    for (fs::directory_iterator it (dir, ec), end; !ec && it != end; it.increment (ec)) {
+        std::string name = (fs::path (probe).parent_path ().empty () ? it->path ().filename () : it->path ()).string ();
+        if (name != path && std::regex_match (name, re))
+            found.emplace_back (fs::last_write_time (it->path (), ec), name);
+    }
+    std::sort (found.begin (), found.end ());
+    for (auto& f : found)
+        out.push_back (std::move (f.second));
+    return out;
+}
+
+#ifdef LOGGER_HAVE_IO_URING
+// No liburing: the three syscalls and the shared rings are used directly.
+int uring_setup (const unsigned entries, io_uring_params* p) noexcept {
+    return static_cast<int> (::syscall (__NR_io_uring_setup, entries, p));
+}
+
+int uring_enter (const int ring, const unsigned submit, const unsigned min_complete, const unsigned flags) noexcept {
+    return static_cast<int> (::syscall (__NR_io_uring_enter, ring, submit, min_complete, flags, nullptr, 0));
+}
+
+int uring_register (const int ring, const unsigned op, const void* arg, const unsigned n) noexcept {
+    return static_cast<int> (::syscall (__NR_io_uring_register, ring, op, arg, n));
+}
+
+template <class T> T* at (void* base, const std::uint32_t off) noexcept {
+    return reinterpret_cast<T*> (static_cast<char*> (base) + off);
+}
+#endif
+
+/** @brief gzip @p src to "<src>.gz"; returns the surviving file name. */
+std::string compress_file (const std::string& src) noexcept {
+#ifdef LOGGER_HAVE_ZLIB
+    const std::string dst = src + ".gz";
+    const std::string tmp = dst + ".tmp";
+    const int in          = ::open (src.c_str (), O_RDONLY | O_CLOEXEC);
+    if (in == -1)
+        return src;
+    gzFile out = gzopen (tmp.c_str (), "wb");
+    bool ok    = out != nullptr;
+    char buf[64 * 1024];
+    for (ssize_t n; ok && (n = ::read (in, buf, sizeof (buf))) != 0;) {
+        if (n < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        ok = gzwrite (out, buf, static_cast<unsigned> (n)) == static_cast<int> (n);
+    }
+    ::close (in);
+    if (out != nullptr && gzclose (out) != Z_OK)
+        ok = false;
+    if (!ok || ::rename (tmp.c_str (), dst.c_str ()) != 0) {
+        ::unlink (tmp.c_str ());
+        return src;
+    }
+    ::unlink (src.c_str ());
+    return dst;
+#else
+    return src;
+#endif
+}
+} // namespace
+
+#ifdef LOGGER_HAVE_IO_URING
+/**
+ * @brief io_uring ring with the sink's buffers registered.
+ * @details Writes go through a second descriptor opened without O_APPEND
+ * so each request carries its own offset. Only the thread holding
+ * FileSink::_mu touches the ring, so no SQ/CQ locking is needed.
+ */
+struct FileSink::Uring {
+    /** @brief State of one registered buffer. */
+    struct Slot {
+        char* data{ nullptr };
+        std::size_t len{ 0 };    ///< Bytes queued.
+        std::size_t done{ 0 };   ///< Bytes the kernel reported written.
+        std::uint64_t off{ 0 };  ///< File offset of data[0].
+        bool busy{ false };      ///< Queued and not yet completed.
+    };
+
+    ~Uring ();
+
+    /** @brief Set up the ring, register @p count buffers of @p bytes at @p mem and open @p path. */
+    bool open (const std::string& path, char* mem, std::size_t count, std::size_t bytes) noexcept;
+    /** @brief Reopen @p path after a rotation (call when idle). */
+    bool reopen (const std::string& path, std::string& err) noexcept;
+    /** @brief Queue @p len bytes of the current buffer at @p off; the buffer stays busy until completion. */
+    bool submit (std::size_t len, std::uint64_t off, std::string& err) noexcept;
+    /**
+     * @brief A free buffer to fill next, waiting for a completion if all are busy.
+     * @details Failures of finished writes are stored in @p err.
+     */
+    char* next (std::string& err) noexcept;
+    /** @brief Wait until nothing is queued. */
+    bool wait_idle (std::string& err) noexcept;
+    /** @brief Bytes of failed writes given up since the last call. */
+    std::uint64_t take_lost () noexcept {
+        return std::exchange (_lost, 0);
+    }
+
+    private:
+    /** @brief Put slot @p i (its unwritten part) on the SQ and enter the kernel. */
+    bool push (unsigned i, std::string& err) noexcept;
+    /** @brief Process completions, blocking for one first if @p wait and none is ready. */
+    bool reap (bool wait, std::string& err) noexcept;
+
+    int _ring{ -1 };
+    int _fd{ -1 };
+    void* _rings{ MAP_FAILED };
+    std::size_t _rings_len{ 0 };
+    io_uring_sqe* _sqes{ nullptr };
+    std::size_t _sqes_len{ 0 };
+    unsigned* _sq_tail{ nullptr };
+    unsigned* _sq_mask{ nullptr };
+    unsigned* _sq_array{ nullptr };
+    unsigned* _cq_head{ nullptr };
+    unsigned* _cq_tail{ nullptr };
+    unsigned* _cq_mask{ nullptr };
+    io_uring_cqe* _cqes{ nullptr };
+    std::vector<Slot> _slots;
+    unsigned _current{ 0 }; ///< Slot being filled.
+    unsigned _busy{ 0 };    ///< Slots in flight.
+    std::uint64_t _lost{ 0 }; ///< See @ref take_lost.
+};
+
+FileSink::Uring::~Uring () {
+    if (_fd != -1)
+        ::close (_fd);
+    if (_sqes != nullptr)
+        ::munmap (_sqes, _sqes_len);
+    if (_rings != MAP_FAILED)
+        ::munmap (_rings, _rings_len);
+    if (_ring != -1)
+        ::close (_ring); // also unregisters the buffers
+}
+
+bool FileSink::Uring::open (const std::string& path, char* mem, const std::size_t count, const std::size_t bytes) noexcept {
+    io_uring_params p{};
+    _ring = uring_setup (static_cast<unsigned> (count), &p);
+    // SINGLE_MMAP is 5.4; FAST_POLL (5.7) also guarantees IOSQE_ASYNC (5.6).
+    if (_ring == -1 || (p.features & IORING_FEAT_SINGLE_MMAP) == 0 || (p.features & IORING_FEAT_FAST_POLL) == 0)
+        return false;
+    _rings_len = std::max<std::size_t> (p.sq_off.array + p.sq_entries * sizeof (unsigned),
+    p.cq_off.cqes + p.cq_entries * sizeof (io_uring_cqe));
+    _rings = ::mmap (nullptr, _rings_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQ_RING);
+    if (_rings == MAP_FAILED)
+        return false;
+    _sqes_len = p.sq_entries * sizeof (io_uring_sqe);
+    void* sqes = ::mmap (nullptr, _sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+    _sqes     = static_cast<io_uring_sqe*> (sqes);
+    _sq_tail  = at<unsigned> (_rings, p.sq_off.tail);
+    _sq_mask  = at<unsigned> (_rings, p.sq_off.ring_mask);
+    _sq_array = at<unsigned> (_rings, p.sq_off.array);
+    _cq_head  = at<unsigned> (_rings, p.cq_off.head);
+    _cq_tail  = at<unsigned> (_rings, p.cq_off.tail);
+    _cq_mask  = at<unsigned> (_rings, p.cq_off.ring_mask);
+    _cqes     = at<io_uring_cqe> (_rings, p.cq_off.cqes);
+
+    std::vector<iovec> iov (count);
+    _slots.resize (count);
+    for (std::size_t i = 0; i < count; ++i) {
+        _slots[i].data = mem + i * bytes;
+        iov[i]         = iovec{ _slots[i].data, bytes };
+    }
+    // Pinned pages count against RLIMIT_MEMLOCK on older kernels.
+    if (uring_register (_ring, IORING_REGISTER_BUFFERS, iov.data (), static_cast<unsigned> (count)) != 0)
+        return false;
+    _fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    return _fd != -1;
+}
+
+bool FileSink::Uring::reopen (const std::string& path, std::string& err) noexcept {
+    ::close (_fd);
+    _fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (_fd != -1)
+        return true;
+    err = std::string ("FileSink: reopen after rotate failed: ") + std::strerror (errno);
+    return false;
+}
+
+bool FileSink::Uring::push (const unsigned i, std::string& err) noexcept {
+    const Slot& s       = _slots[i];
+    const unsigned tail = *_sq_tail; // only this thread moves the SQ tail
+    const unsigned idx  = tail & *_sq_mask;
+    io_uring_sqe& q     = _sqes[idx];
+    std::memset (&q, 0, sizeof (q));
+    q.opcode    = IORING_OP_WRITE_FIXED;
+    q.flags     = IOSQE_ASYNC; // straight to a kernel worker: never writes back inline
+    q.fd        = _fd;
+    q.off       = s.off + s.done;
+    q.addr      = reinterpret_cast<std::uintptr_t> (s.data + s.done);
+    q.len       = static_cast<std::uint32_t> (s.len - s.done);
+    q.buf_index = static_cast<std::uint16_t> (i);
+    q.user_data = i;
+    _sq_array[idx] = idx;
+    __atomic_store_n (_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    for (;;) {
+        if (uring_enter (_ring, 1, 0, 0) == 1)
+            return true;
+        if (errno == EINTR)
+            continue;
+        // Not consumed (nothing else is queued): take the SQE back.
+        __atomic_store_n (_sq_tail, tail, __ATOMIC_RELEASE);
+        err = std::string ("FileSink: io_uring submit failed: ") + std::strerror (errno);
+        return false;
+    }
+}
+
+bool FileSink::Uring::reap (const bool wait, std::string& err) noexcept {
+    unsigned head = *_cq_head;
+    if (wait && head == __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE)) {
+        while (uring_enter (_ring, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            if (errno == EINTR)
+                continue;
+            // The ring itself is broken: give up on what is in flight.
+            err = std::string ("FileSink: io_uring wait failed: ") + std::strerror (errno);
+            for (Slot& s : _slots) {
+                if (s.busy)
+                    _lost += s.len - s.done;
+                s.busy = false;
+            }
+            _busy = 0;
+            return false;
+        }
+    }
+    bool ok = true;
+    for (const unsigned tail = __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE); head != tail; ++head) {
+        const io_uring_cqe& c = _cqes[head & *_cq_mask];
+        const auto i          = static_cast<unsigned> (c.user_data);
+        Slot& s               = _slots[i];
+        if (c.res > 0)
+            s.done += static_cast<std::size_t> (c.res);
+        const bool retry = c.res == -EINTR || c.res == -EAGAIN || (c.res > 0 && s.done < s.len);
+        if (retry && push (i, err))
+            continue; // short write: the rest is queued again
+        if (!retry && c.res <= 0)
+            err = c.res < 0 ? std::string ("FileSink: write failed: ") + std::strerror (-c.res) : "FileSink: write failed: no progress";
+        if (s.done < s.len)
+            _lost += s.len - s.done;
+        ok     = ok && !retry && c.res > 0;
+        s.busy = false;
+        --_busy;
+    }
+    __atomic_store_n (_cq_head, head, __ATOMIC_RELEASE);
+    return ok;
+}
+
+bool FileSink::Uring::submit (const std::size_t len, const std::uint64_t off, std::string& err) noexcept {
+    Slot& s = _slots[_current];
+    s.len   = len;
+    s.done  = 0;
+    s.off   = off;
+    if (!push (_current, err))
+        return false;
+    s.busy = true;
+    ++_busy;
+    return true;
+}
+
+char* FileSink::Uring::next (std::string& err) noexcept {
+    for (bool wait = false;; wait = true) {
+        // Finished writes are usually picked up without a syscall.
+        reap (wait, err);
+        for (std::size_t k = 1; k <= _slots.size (); ++k) {
+            const auto i = static_cast<unsigned> ((_current + k) % _slots.size ());
+            if (!_slots[i].busy) {
+                _current = i;
+                return _slots[i].data;
+            }
+        }
+    }
+}
+
+bool FileSink::Uring::wait_idle (std::string& err) noexcept {
+    bool ok = true;
+    while (_busy > 0)
+        ok = reap (true, err) && ok;
+    return ok;
+}
+#else
+/** @brief Stand-in where io_uring headers are unavailable: never opens. */
+struct FileSink::Uring {
+    bool open (const std::string&, char*, std::size_t, std::size_t) noexcept {
+        return false;
+    }
+    bool reopen (const std::string&, std::string&) noexcept {
+        return false;
+    }
+    bool submit (std::size_t, std::uint64_t, std::string&) noexcept {
+        return false;
+    }
+    char* next (std::string&) noexcept {
+        return nullptr;
+    }
+    bool wait_idle (std::string&) noexcept {
+        return true;
+    }
+    std::uint64_t take_lost () noexcept {
+        return 0;
+    }
+};
+#endif
+
+FileSink::FileSink (const std::string& path, const FileSinkOptions opts) noexcept : _opts (opts), _path (path) {
+    _fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd == -1)
+        return;
+    struct stat st{};
+    if (::fstat (_fd, &st) == 0)
+        _file_bytes = static_cast<std::uint64_t> (st.st_size);
+    _cap = _opts.buffer_bytes > 0 ? _opts.buffer_bytes : 1;
+    if (_opts.io_uring) {
+        const std::size_t count = std::max<std::size_t> (_opts.uring_buffers, 2);
+        _mem.reset (new char[count * _cap]);
+        _uring = std::make_unique<Uring> ();
+        if (!_uring->open (path, _mem.get (), count, _cap))
+            _uring.reset ();
+    }
+    if (!_uring)
+        _mem.reset (new char[_cap]);
+    _buf = _mem.get ();
+    if (_opts.flush_interval.count () > 0)
+        _flusher = std::thread ([this] { flusher_loop (); });
+    const bool rotates = _opts.rotate_bytes > 0 || _opts.rotate_interval.count () > 0;
+    if (rotates && (_opts.compress || _opts.max_files > 0))
+        _housekeeper = std::thread (
+        [this, kept = discover_rotated (_opts.rotate_pattern, _path)] () mutable { housekeeper_loop (std::move (kept)); });
+}
+
+FileSink::~FileSink () {
+    {
+        std::lock_guard lk (_mu);
+        _stop = true;
+    }
+    _cv.notify_all ();
+    if (_flusher.joinable ())
+        _flusher.join ();
+    if (_fd != -1) {
+        std::string err;
+        flush_locked (err);
+        ::close (_fd);
+    }
+    _uring.reset ();
+    {
+        std::lock_guard lk (_hk_mu);
+        _hk_stop = true;
+    }
+    _hk_cv.notify_all ();
+    if (_housekeeper.joinable ())
+        _housekeeper.join ();
+}
 
-FileSink::FileSink (const std::string& path) noexcept {
-    _ofs.open (path, std::ios::out | std::ios::app);
+bool FileSink::should_rotate (const std::uint64_t epoch_ms, const std::size_t need) noexcept {
+    if (epoch_ms < _rotate_retry_ms)
+        return false; // backing off; a boundary crossed meanwhile is still seen afterwards
+    if (!_rotated.empty ())
+        return true;
+    const std::uint64_t pending = _file_bytes + _used;
+    if (_opts.rotate_bytes > 0 && pending > 0 && pending + need > _opts.rotate_bytes)
+        return true;
+    if (_opts.rotate_interval.count () > 0) {
+        const auto iv      = static_cast<std::uint64_t> (_opts.rotate_interval.count ()) * 1000ull;
+        const bool crossed = _rotate_at_ms != 0 && epoch_ms >= _rotate_at_ms;
+        if (_rotate_at_ms == 0 || crossed)
+            _rotate_at_ms = (epoch_ms / iv + 1) * iv;
+        return crossed && pending > 0;
+    }
+    return false;
+}
+
+bool FileSink::rotate_locked (std::string& err) noexcept {
+    if (!flush_locked (err))
+        return false;
+    if (_rotated.empty ()) {
+        std::string name = _opts.rotate_pattern;
+        replace_all (name, "{path}", _path);
+        replace_all (name, "{time}", utc_stamp (now_epoch_ms ()));
+        const bool numbered = name.find ("{n}") != std::string::npos;
+        std::string candidate;
+        for (;; ++_seq) {
+            candidate = name;
+            if (numbered)
+                replace_all (candidate, "{n}", std::to_string (_seq));
+            else if (exists (candidate) || exists (candidate + ".gz"))
+                candidate += "." + std::to_string (_seq);
+            if (!exists (candidate) && !exists (candidate + ".gz"))
+                break;
+        }
+        if (::rename (_path.c_str (), candidate.c_str ()) != 0) {
+            err = "FileSink: rotate failed: " + candidate + ": " + std::strerror (errno);
+            return false;
+        }
+        _rotated = std::move (candidate);
+    }
+    // Until the path reopens, lines keep going to the renamed file.
+    const int fd = ::open (_path.c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        err = std::string ("FileSink: reopen after rotate failed: ") + std::strerror (errno);
+        return false;
+    }
+    // The ring is idle after the flush; without its descriptor it cannot
+    // write, so the sink falls back to write(2) on the new one.
+    if (std::string uerr; _uring && !_uring->reopen (_path, uerr))
+        _uring.reset ();
+    ::close (_fd);
+    _fd         = fd;
+    _file_bytes = 0;
+    if (_housekeeper.joinable ()) {
+        std::lock_guard lk (_hk_mu);
+        _closed.push_back (std::move (_rotated));
+        _hk_cv.notify_one ();
+    }
+    _rotated.clear ();
+    return true;
 }
 
-FileSink::~FileSink () = default;
+void FileSink::rotate_failed_locked (const std::uint64_t epoch_ms, std::string& err) noexcept {
+    // Reported once per run of failures; writes carry on in the current file.
+    if (_rotate_backoff_ms == 0 && _deferred_err.empty ())
+        _deferred_err.swap (err);
+    _rotate_backoff_ms = std::clamp<std::uint64_t> (2 * _rotate_backoff_ms, kRotateBackoffMinMs, kRotateBackoffMaxMs);
+    _rotate_retry_ms   = epoch_ms + _rotate_backoff_ms;
+}
+
+void FileSink::housekeeper_loop (std::deque<std::string> kept) noexcept {
+    std::unique_lock lk (_hk_mu);
+    for (;;) {
+        _hk_cv.wait (lk, [this] { return _hk_stop || !_closed.empty (); });
+        if (_closed.empty ())
+            break;
+        std::string file = std::move (_closed.front ());
+        _closed.pop_front ();
+        lk.unlock ();
+        if (_opts.compress)
+            file = compress_file (file);
+        kept.push_back (std::move (file));
+        while (_opts.max_files > 0 && kept.size () > _opts.max_files) {
+            ::unlink (kept.front ().c_str ());
+            kept.pop_front ();
+        }
+        lk.lock ();
+    }
+}
+
+bool FileSink::drain_locked (std::string& err) noexcept {
+    if (_used == 0)
+        return true;
+    const std::uint64_t off = _file_bytes;
+    _file_bytes += _used;
+    if (_uring) {
+        if (!_uring->submit (_used, off, err)) {
+            _file_bytes = off; // nothing queued: the bytes stay buffered for the next drain
+            return false;
+        }
+        _used = 0;
+        _buf  = _uring->next (_deferred_err);
+        settle_uring_locked (_deferred_err);
+        return true;
+    }
+    iovec iov{ _buf, _used };
+    if (write_fully (_fd, &iov, 1, err)) {
+        _used = 0;
+        return true;
+    }
+    // Keep what the kernel did not take; the next drain retries it.
+    _file_bytes -= iov.iov_len;
+    std::memmove (_buf, iov.iov_base, iov.iov_len);
+    _used = iov.iov_len;
+    return false;
+}
+
+bool FileSink::flush_locked (std::string& err) noexcept {
+    const bool ok = drain_locked (err);
+    if (!_uring)
+        return ok;
+    const bool idle = _uring->wait_idle (err);
+    settle_uring_locked (err);
+    return idle && ok;
+}
+
+void FileSink::settle_uring_locked (std::string& err) noexcept {
+    std::uint64_t lost = _uring->take_lost ();
+    if (lost == 0)
+        return;
+    // Requests carry offsets from _file_bytes, while oversized lines go
+    // through O_APPEND: after a failed request both continue at the real end.
+    _uring->wait_idle (err);
+    lost += _uring->take_lost ();
+    _lost_bytes.fetch_add (lost, std::memory_order_relaxed);
+    sync_file_bytes_locked ();
+}
+
+void FileSink::sync_file_bytes_locked () noexcept {
+    struct stat st{};
+    if (::fstat (_fd, &st) == 0)
+        _file_bytes = static_cast<std::uint64_t> (st.st_size);
+}
+
+bool FileSink::append_locked (const std::uint64_t epoch_ms,
+const LogLevel level,
+const std::string_view msg,
+std::string& err) noexcept {
+    char ts[kIso8601MaxLen];
+    const std::size_t ts_len   = _ts.format (epoch_ms, ts);
+    const std::string_view lvl = to_string (level);
+    const std::size_t need     = ts_len + 1 + lvl.size () + 1 + msg.size () + 1;
+    if (should_rotate (epoch_ms, need)) {
+        if (std::string rerr; rotate_locked (rerr))
+            _rotate_backoff_ms = 0;
+        else
+            rotate_failed_locked (epoch_ms, rerr);
+    }
+    if (_used + need > _cap && !drain_locked (err))
+        return false;
+    if (need > _cap) {
+        // Written straight from the caller's memory, after queued buffers.
+        if (_uring) {
+            const bool idle = _uring->wait_idle (err);
+            settle_uring_locked (err);
+            if (!idle)
+                return false;
+        }
+        _file_bytes += need;
+        char sp     = ' ';
+        char nl     = '\n';
+        iovec iov[] = { { ts, ts_len }, { &sp, 1 }, { const_cast<char*> (lvl.data ()), lvl.size () }, { &sp, 1 },
+            { const_cast<char*> (msg.data ()), msg.size () }, { &nl, 1 } };
+        if (write_fully (_fd, iov, 6, err))
+            return true;
+        sync_file_bytes_locked (); // part of the line may be in the file
+        return false;
+    }
+    char* p = _buf + _used;
+    std::memcpy (p, ts, ts_len);
+    p += ts_len;
+    *p++ = ' ';
+    std::memcpy (p, lvl.data (), lvl.size ());
+    p += lvl.size ();
+    *p++ = ' ';
+    std::memcpy (p, msg.data (), msg.size ());
+    p += msg.size ();
+    *p++ = '\n';
+    _used += need;
+    return true;
+}
 
 bool FileSink::write (const LogEntry& e, std::string& err) noexcept {
+    return write_view (LogEntryView{ e.epoch_ms, e.level, e.message }, err);
+}
+
+bool FileSink::write_view (const LogEntryView& e, std::string& err) noexcept {
     std::lock_guard lk (_mu);
-    if (!_ofs.is_open ()) {
+    if (_fd == -1) {
         err = "FileSink: log file is not open";
         return false;
     }
-    _ofs << iso8601_utc (e.epoch_ms) << ' ' << std::string (to_string (e.level)) << ' ' << e.message << '\n';
-    if (!_ofs) {
-        err = "FileSink: write failed";
+    if (!append_locked (e.epoch_ms, e.level, e.message, err))
         return false;
+    if (_opts.flush_on_error && e.level == LogLevel::Error && !flush_locked (err))
+        return false;
+    return !take_deferred_locked (err);
+}
+
+std::size_t FileSink::write_batch (const LogEntry* entries, const std::size_t count, std::string& err) noexcept {
+    std::lock_guard lk (_mu);
+    if (_fd == -1) {
+        err = "FileSink: log file is not open";
+        return 0;
+    }
+    bool saw_error = false;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!append_locked (entries[i].epoch_ms, entries[i].level, entries[i].message, err))
+            return i;
+        saw_error = saw_error || entries[i].level == LogLevel::Error;
     }
+    if (_opts.flush_on_error && saw_error && !flush_locked (err))
+        return 0;
+    take_deferred_locked (err);
+    return count;
+}
+
+bool FileSink::take_deferred_locked (std::string& err) noexcept {
+    if (_deferred_err.empty ())
+        return false;
+    err.swap (_deferred_err);
+    _deferred_err.clear ();
     return true;
 }
 
 void FileSink::flush () noexcept {
     std::lock_guard lk (_mu);
-    if (_ofs.is_open ())
-        _ofs.flush ();
+    if (_fd != -1)
+        flush_locked (_deferred_err);
 }
 
+void FileSink::flusher_loop () noexcept {
+    std::unique_lock lk (_mu);
+    while (!_stop) {
+        _cv.wait_for (lk, _opts.flush_interval);
+        if (_used > 0) {
+            if (std::string err; !drain_locked (err))
+                _deferred_err = err;
+        }
+    }
+}
 } // namespace logger
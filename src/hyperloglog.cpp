@@ -0,0 +1,26 @@
+#include "logger/hyperloglog.hpp"
+
+#include <cmath>
+
+namespace logger {
+void HyperLogLog::merge (const HyperLogLog& other) noexcept {
+    for (std::size_t i = 0; i < kRegisters; ++i)
+        raise (i, other._reg[i]);
+}
+
+std::uint64_t HyperLogLog::estimate () const noexcept {
+    const double m   = static_cast<double> (kRegisters);
+    double sum       = 0.0;
+    std::size_t zero = 0;
+    for (const std::uint8_t r : _reg) {
+        sum += std::ldexp (1.0, -static_cast<int> (r));
+        zero += r == 0;
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double e           = alpha * m * m / sum;
+    // Linear counting is more accurate while many registers are still empty.
+    if (e <= 2.5 * m && zero != 0)
+        e = m * std::log (m / static_cast<double> (zero));
+    return static_cast<std::uint64_t> (std::llround (e));
+}
+} // namespace logger
@@ -0,0 +1,246 @@
+#include "logger/line_framer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOGGER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace logger {
+namespace {
+const char* find_generic (const char* p, const char* end, const char c) noexcept {
+    const void* hit = std::memchr (p, c, static_cast<std::size_t> (end - p));
+    return hit != nullptr ? static_cast<const char*> (hit) : end;
+}
+
+#ifdef LOGGER_X86_SIMD
+const char* find_sse2 (const char* p, const char* end, const char c) noexcept {
+    const __m128i needle = _mm_set1_epi8 (c);
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+        if (const int mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, needle)); mask != 0)
+            return p + __builtin_ctz (static_cast<unsigned> (mask));
+    }
+    for (; p < end; ++p)
+        if (*p == c)
+            return p;
+    return end;
+}
+
+__attribute__ ((target ("avx2"))) const char* find_avx2 (const char* p, const char* end, const char c) noexcept {
+    const __m256i needle = _mm256_set1_epi8 (c);
+    for (; end - p >= 64; p += 64) {
+        const __m256i a = _mm256_cmpeq_epi8 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p)), needle);
+        const __m256i b = _mm256_cmpeq_epi8 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + 32)), needle);
+        const auto lo   = static_cast<std::uint32_t> (_mm256_movemask_epi8 (a));
+        const auto hi   = static_cast<std::uint32_t> (_mm256_movemask_epi8 (b));
+        const auto mask = (static_cast<std::uint64_t> (hi) << 32) | lo;
+        if (mask != 0)
+            return p + __builtin_ctzll (mask);
+    }
+    for (; end - p >= 32; p += 32) {
+        const __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p));
+        if (const auto mask = static_cast<std::uint32_t> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, needle))); mask != 0)
+            return p + __builtin_ctz (mask);
+    }
+    return find_sse2 (p, end, c);
+}
+#endif
+
+/** @brief Append the offsets of the set bits of @p mask (relative to @p base). */
+inline std::size_t emit (std::uint64_t mask, const std::uint32_t base, std::uint32_t* out) noexcept {
+    std::size_t k = 0;
+    for (; mask != 0; mask &= mask - 1)
+        out[k++] = base + static_cast<std::uint32_t> (__builtin_ctzll (mask));
+    return k;
+}
+
+std::size_t index_scalar (const char* p, const std::size_t from, const std::size_t n, std::uint32_t* out, const std::size_t max_out) noexcept {
+    std::size_t k = 0, i = from;
+    for (; i < n && k < max_out; ++i)
+        if (p[i] == '\n' || p[i] == '|')
+            out[k++] = static_cast<std::uint32_t> (i);
+    return k;
+}
+
+/** @brief Scalar tail after the vector blocks: scans from @p from while slots last. */
+std::size_t index_tail (const char* p, const std::size_t from, const std::size_t n, std::uint32_t* out, const std::size_t slots, std::size_t& scanned) noexcept {
+    const std::size_t k = index_scalar (p, from, n, out, slots);
+    // Out of slots: stop right after the last delimiter written.
+    if (k < slots)
+        scanned = n;
+    else
+        scanned = k > 0 ? out[k - 1] + 1 : from;
+    return k;
+}
+
+#ifdef LOGGER_X86_SIMD
+std::size_t index_sse2 (const char* p, const std::size_t n, std::uint32_t* out, const std::size_t max_out, std::size_t& scanned) noexcept {
+    const __m128i nl  = _mm_set1_epi8 ('\n');
+    const __m128i bar = _mm_set1_epi8 ('|');
+    std::size_t k = 0, i = 0;
+    for (; n - i >= 64 && max_out - k >= 64; i += 64) {
+        std::uint64_t mask = 0;
+        for (int j = 0; j < 4; ++j) {
+            const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i + 16 * j));
+            const int m     = _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (v, nl), _mm_cmpeq_epi8 (v, bar)));
+            mask |= static_cast<std::uint64_t> (static_cast<std::uint16_t> (m)) << (16 * j);
+        }
+        k += emit (mask, static_cast<std::uint32_t> (i), out + k);
+    }
+    return k + index_tail (p, i, n, out + k, max_out - k, scanned);
+}
+
+__attribute__ ((target ("avx2"))) std::size_t
+index_avx2 (const char* p, const std::size_t n, std::uint32_t* out, const std::size_t max_out, std::size_t& scanned) noexcept {
+    const __m256i nl  = _mm256_set1_epi8 ('\n');
+    const __m256i bar = _mm256_set1_epi8 ('|');
+    std::size_t k = 0, i = 0;
+    for (; n - i >= 64 && max_out - k >= 64; i += 64) {
+        const __m256i a = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + i));
+        const __m256i b = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + i + 32));
+        const auto lo   = static_cast<std::uint32_t> (
+        _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8 (a, nl), _mm256_cmpeq_epi8 (a, bar))));
+        const auto hi = static_cast<std::uint32_t> (
+        _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8 (b, nl), _mm256_cmpeq_epi8 (b, bar))));
+        k += emit ((static_cast<std::uint64_t> (hi) << 32) | lo, static_cast<std::uint32_t> (i), out + k);
+    }
+    return k + index_tail (p, i, n, out + k, max_out - k, scanned);
+}
+#endif
+
+SimdLevel detect () noexcept {
+#ifdef LOGGER_X86_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return SimdLevel::Avx2;
+    if (__builtin_cpu_supports ("sse2"))
+        return SimdLevel::Sse2;
+#endif
+    return SimdLevel::Generic;
+}
+
+using FindFn = const char* (*) (const char*, const char*, char) noexcept;
+
+FindFn pick (const SimdLevel level) noexcept {
+    switch (level) {
+#ifdef LOGGER_X86_SIMD
+    case SimdLevel::Avx2: return find_avx2;
+    case SimdLevel::Sse2: return find_sse2;
+#endif
+    default: return find_generic;
+    }
+}
+
+/** @brief Compare @p s with upper-case @p upper, ignoring ASCII case. */
+bool equals_upper (const std::string_view s, const std::string_view upper) noexcept {
+    if (s.size () != upper.size ())
+        return false;
+    for (std::size_t i = 0; i < s.size (); ++i)
+        if ((s[i] & ~0x20) != upper[i])
+            return false;
+    return true;
+}
+} // namespace
+
+SimdLevel detected_simd_level () noexcept {
+    static const SimdLevel level = detect ();
+    return level;
+}
+
+bool simd_supported (const SimdLevel level) noexcept {
+    return static_cast<int> (level) <= static_cast<int> (detected_simd_level ());
+}
+
+const char* find_byte (const char* p, const char* end, const char c) noexcept {
+    static const FindFn find = pick (detected_simd_level ());
+    return find (p, end, c);
+}
+
+const char* find_byte (const char* p, const char* end, const char c, const SimdLevel level) noexcept {
+    return pick (level) (p, end, c);
+}
+
+std::size_t index_delimiters (const char* p, const std::size_t n, std::uint32_t* out, const std::size_t max_out, std::size_t& scanned) noexcept {
+    return index_delimiters (p, n, out, max_out, scanned, detected_simd_level ());
+}
+
+std::size_t index_delimiters (const char* p,
+const std::size_t n,
+std::uint32_t* out,
+const std::size_t max_out,
+std::size_t& scanned,
+const SimdLevel level) noexcept {
+    switch (level) {
+#ifdef LOGGER_X86_SIMD
+    case SimdLevel::Avx2: return index_avx2 (p, n, out, max_out, scanned);
+    case SimdLevel::Sse2: return index_sse2 (p, n, out, max_out, scanned);
+#endif
+    default: return index_tail (p, 0, n, out, max_out, scanned);
+    }
+}
+
+bool parse_text_fields (const std::string_view line,
+const std::size_t bar1,
+const std::size_t bar2,
+std::uint64_t& epoch_ms,
+LogLevel& level,
+std::string_view& msg) noexcept {
+    std::uint64_t epoch = 0;
+    for (std::size_t i = 0; i < bar1; ++i) {
+        const auto d = static_cast<unsigned> (line[i] - '0');
+        if (d > 9)
+            return false;
+        epoch = epoch * 10 + d;
+    }
+    const std::string_view lvl = line.substr (bar1 + 1, bar2 - bar1 - 1);
+    if (equals_upper (lvl, "INFO"))
+        level = LogLevel::Info;
+    else if (equals_upper (lvl, "WARN"))
+        level = LogLevel::Warning;
+    else if (equals_upper (lvl, "ERROR"))
+        level = LogLevel::Error;
+    else
+        return false;
+    epoch_ms = epoch;
+    msg      = line.substr (bar2 + 1);
+    if (!msg.empty () && msg.back () == '\r')
+        msg.remove_suffix (1);
+    return true;
+}
+
+bool parse_text_record (const std::string_view line, std::uint64_t& epoch_ms, LogLevel& level, std::string_view& msg) noexcept {
+    const char* const begin = line.data ();
+    const char* const end   = begin + line.size ();
+    const char* p1          = find_byte (begin, end, '|');
+    if (p1 == end)
+        return false;
+    const char* p2 = find_byte (p1 + 1, end, '|');
+    if (p2 == end)
+        return false;
+    return parse_text_fields (line, static_cast<std::size_t> (p1 - begin), static_cast<std::size_t> (p2 - begin), epoch_ms, level, msg);
+}
+
+char* LineFramer::reserve (const std::size_t min) {
+    if (!_buf)
+        _buf.reset (new char[_cap = std::max (_cap, min)]);
+    if (room () < min) {
+        const std::size_t used = _tail - _head;
+        if (used + min > _cap) {
+            // Only a line longer than the buffer gets here.
+            const std::size_t cap = std::max (_cap * 2, used + min);
+            std::unique_ptr<char[]> grown (new char[cap]);
+            std::memcpy (grown.get (), _buf.get () + _head, used);
+            _buf = std::move (grown);
+            _cap = cap;
+        } else {
+            std::memmove (_buf.get (), _buf.get () + _head, used);
+        }
+        _head = 0;
+        _tail = used;
+    }
+    return _buf.get () + _tail;
+}
+} // namespace logger
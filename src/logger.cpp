@@ -1,6 +1,8 @@
 #include "logger/logger.hpp"
+#include "logger/datagram_sink.hpp"
 #include "logger/file_sink.hpp"
 #include "logger/log_entry.hpp"
+#include "logger/mmap_file_sink.hpp"
 #include "logger/socket_sink.hpp"
 #include <utility>
 
@@ -10,14 +12,11 @@ Logger::Logger (std::unique_ptr<ILogSink> sink, const LogLevel default_level) no
 }
 
 Status Logger::log (LogLevel level, const std::string_view msg) noexcept {
-    if (static_cast<int> (level) > static_cast<int> (_default.load ())) {
+    if (!enabled (level)) {
         return Status::Filtered;
     }
-    LogEntry e;
-    e.epoch_ms = now_epoch_ms ();
-    e.level    = level;
-    e.message.assign (msg.begin (), msg.end ());
-    if (std::string err; !_sink || !_sink->write (e, err)) {
+    const LogEntryView e{ now_epoch_ms (), level, msg };
+    if (std::string err; !_sink || !_sink->write_view (e, err)) {
         std::lock_guard lk (_mu);
         _last_err = err.empty () ? "Unknown sink error" : err;
         return Status::IoError;
@@ -38,7 +37,36 @@ std::unique_ptr<ILogSink> make_file_sink (const std::string& path) noexcept {
     return std::make_unique<FileSink> (path);
 }
 
+std::unique_ptr<ILogSink> make_file_sink (const std::string& path, const FileSinkOptions& opts) noexcept {
+    return std::make_unique<FileSink> (path, opts);
+}
+
+std::unique_ptr<ILogSink> make_mmap_file_sink (const std::string& base_path, const std::size_t segment_bytes) noexcept {
+    return std::make_unique<MmapFileSink> (base_path, segment_bytes);
+}
+
 std::unique_ptr<ILogSink> make_socket_sink (const std::string& host, std::uint16_t port) noexcept {
     return std::make_unique<SocketSink> (host, port);
 }
+
+std::unique_ptr<ILogSink>
+make_socket_sink (const std::string& host, const std::uint16_t port, const SocketSinkOptions& opts) noexcept {
+    return std::make_unique<SocketSink> (host, port, opts);
+}
+
+std::unique_ptr<ILogSink> make_unix_socket_sink (const std::string& path) noexcept {
+    return std::make_unique<SocketSink> (UnixPath{ path });
+}
+
+std::unique_ptr<ILogSink> make_unix_socket_sink (const std::string& path, const SocketSinkOptions& opts) noexcept {
+    return std::make_unique<SocketSink> (UnixPath{ path }, opts);
+}
+
+std::unique_ptr<ILogSink> make_udp_sink (const std::string& host, const std::uint16_t port) noexcept {
+    return std::make_unique<DatagramSink> (host, port);
+}
+
+std::unique_ptr<ILogSink> make_unix_datagram_sink (const std::string& path) noexcept {
+    return std::make_unique<DatagramSink> (UnixPath{ path });
+}
 } // namespace logger
@@ -0,0 +1,210 @@
+#include "logger/mmap_file_sink.hpp"
+#include "logger/log_level.hpp"
+#include "logger/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace logger {
+struct MmapFileSink::Segment {
+    int fd{ -1 };
+    char* base{ nullptr };
+    std::size_t size{ 0 };
+    std::string path;
+    std::atomic<std::size_t> reserved{ 0 };                                  ///< Bytes handed out.
+    std::atomic<std::size_t> end{ std::numeric_limits<std::size_t>::max () }; ///< First reservation that did not fit.
+    std::atomic<int> refs{ 0 };                                              ///< Writers currently inside.
+};
+
+namespace {
+thread_local TimestampFormatter t_ts;
+
+std::string segment_path (const std::string& base, const unsigned index) {
+    char suffix[16];
+    std::snprintf (suffix, sizeof (suffix), ".%06u", index);
+    return base + suffix;
+}
+
+void lower_to (std::atomic<std::size_t>& v, const std::size_t x) noexcept {
+    std::size_t cur = v.load (std::memory_order_relaxed);
+    while (x < cur && !v.compare_exchange_weak (cur, x, std::memory_order_relaxed)) {
+    }
+}
+} // namespace
+
+MmapFileSink::MmapFileSink (std::string base_path, const std::size_t segment_bytes) noexcept
+: _base (std::move (base_path)), _segment_bytes (segment_bytes) {
+    struct stat st{};
+    while (::stat (segment_path (_base, _next_index).c_str (), &st) == 0)
+        ++_next_index;
+    std::string err;
+    _cur.store (open_segment (err), std::memory_order_release);
+}
+
+MmapFileSink::~MmapFileSink () {
+    if (Segment* seg = _cur.exchange (nullptr)) {
+        seal (seg);
+        delete seg;
+    }
+}
+
+MmapFileSink::Segment* MmapFileSink::open_segment (std::string& err) noexcept {
+    auto seg  = std::make_unique<Segment> ();
+    seg->path = segment_path (_base, _next_index++);
+    seg->size = _segment_bytes;
+    seg->fd   = ::open (seg->path.c_str (), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (seg->fd == -1) {
+        err = "MmapFileSink: open failed: " + seg->path + ": " + std::strerror (errno);
+        return nullptr;
+    }
+    const auto len = static_cast<off_t> (seg->size);
+    if (::fallocate (seg->fd, 0, 0, len) != 0 && ::ftruncate (seg->fd, len) != 0) {
+        err = std::string ("MmapFileSink: preallocate failed: ") + std::strerror (errno);
+        ::close (seg->fd);
+        return nullptr;
+    }
+    void* p = ::mmap (nullptr, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (p == MAP_FAILED) {
+        err = std::string ("MmapFileSink: mmap failed: ") + std::strerror (errno);
+        ::close (seg->fd);
+        return nullptr;
+    }
+    seg->base = static_cast<char*> (p);
+    return seg.release ();
+}
+
+void MmapFileSink::seal (Segment* seg) noexcept {
+    while (seg->refs.load (std::memory_order_acquire) != 0)
+        std::this_thread::yield ();
+    lower_to (seg->end, seg->reserved.load (std::memory_order_acquire));
+    const std::size_t used = std::min (seg->end.load (), seg->size);
+    ::munmap (seg->base, seg->size);
+    seg->base = nullptr;
+    if (::ftruncate (seg->fd, static_cast<off_t> (used)) != 0) {
+        // Keep the zero tail; readers still stop at the first NUL.
+    }
+    ::close (seg->fd);
+    seg->fd = -1;
+}
+
+MmapFileSink::Segment* MmapFileSink::acquire () noexcept {
+    for (;;) {
+        Segment* seg = _cur.load (std::memory_order_acquire);
+        if (seg == nullptr)
+            return nullptr;
+        seg->refs.fetch_add (1, std::memory_order_acq_rel);
+        if (_cur.load (std::memory_order_acquire) == seg)
+            return seg;
+        seg->refs.fetch_sub (1, std::memory_order_release);
+    }
+}
+
+void MmapFileSink::release (Segment* seg) noexcept {
+    seg->refs.fetch_sub (1, std::memory_order_release);
+}
+
+bool MmapFileSink::roll (Segment* full, std::string& err) noexcept {
+    std::lock_guard lk (_roll_mu);
+    if (_cur.load (std::memory_order_acquire) != full)
+        return true; // another writer already rolled over
+    Segment* next = open_segment (err);
+    if (next == nullptr)
+        return false;
+    _cur.store (next, std::memory_order_release);
+    seal (full);
+    _retired.emplace_back (full);
+    return true;
+}
+
+bool MmapFileSink::write (const LogEntry& e, std::string& err) noexcept {
+    return write_view (LogEntryView{ e.epoch_ms, e.level, e.message }, err);
+}
+
+bool MmapFileSink::write_view (const LogEntryView& e, std::string& err) noexcept {
+    char ts[kIso8601MaxLen];
+    const std::size_t ts_len   = t_ts.format (e.epoch_ms, ts);
+    const std::string_view lvl = to_string (e.level);
+    const std::size_t len      = ts_len + 1 + lvl.size () + 1 + e.message.size () + 1;
+    if (len > _segment_bytes) {
+        err = "MmapFileSink: record larger than a segment";
+        return false;
+    }
+    for (;;) {
+        Segment* seg = acquire ();
+        if (seg == nullptr) {
+            err = "MmapFileSink: no segment is open";
+            return false;
+        }
+        const std::size_t off = seg->reserved.fetch_add (len, std::memory_order_relaxed);
+        if (off + len <= seg->size) {
+            char* p = seg->base + off;
+            std::memcpy (p, ts, ts_len);
+            p += ts_len;
+            *p++ = ' ';
+            std::memcpy (p, lvl.data (), lvl.size ());
+            p += lvl.size ();
+            *p++ = ' ';
+            std::memcpy (p, e.message.data (), e.message.size ());
+            p[e.message.size ()] = '\n';
+            release (seg);
+            return true;
+        }
+        lower_to (seg->end, off);
+        release (seg);
+        if (!roll (seg, err))
+            return false;
+    }
+}
+
+void MmapFileSink::flush () noexcept {
+    if (Segment* seg = acquire ()) {
+        ::msync (seg->base, seg->size, MS_ASYNC);
+        release (seg);
+    }
+}
+
+std::string MmapFileSink::current_path () const {
+    std::lock_guard lk (_roll_mu);
+    const Segment* seg = _cur.load (std::memory_order_acquire);
+    return seg ? seg->path : std::string{};
+}
+
+std::size_t MmapFileSink::valid_length (const char* data, std::size_t size) noexcept {
+    // Only the preallocated tail is cut: an unfilled reservation further up
+    // leaves a zero gap with complete lines after it.
+    while (size > 0 && data[size - 1] == '\0')
+        --size;
+    return size;
+}
+
+std::string MmapFileSink::recover (const char* data, const std::size_t size) {
+    std::string out;
+    const char* p         = data;
+    const char* const end = data + valid_length (data, size);
+    while (p < end) {
+        const char* nl      = static_cast<const char*> (std::memchr (p, '\n', static_cast<std::size_t> (end - p)));
+        const char* rec_end = nl ? nl + 1 : end;
+        // A NUL inside means the line was torn by a crash or lies in a gap:
+        // drop the bytes up to the last NUL and keep the line after it.
+        const char* start = p;
+        for (const char* q = p; q < rec_end; ++q)
+            if (*q == '\0')
+                start = q + 1;
+        if (nl != nullptr && start < nl)
+            out.append (start, rec_end);
+        p = rec_end;
+    }
+    return out;
+}
+} // namespace logger
@@ -0,0 +1,84 @@
+#include "logger/mpsc_ring.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace logger {
+MpscRing::MpscRing (const std::size_t capacity, const std::size_t message_reserve) {
+    std::size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+    _slots = std::make_unique<Slot[]> (cap);
+    _mask  = cap - 1;
+    for (std::size_t i = 0; i < cap; ++i) {
+        _slots[i].seq.store (i, std::memory_order_relaxed);
+        _slots[i].entry.message.reserve (message_reserve);
+    }
+}
+
+bool MpscRing::try_push (const std::uint64_t epoch_ms, const LogLevel level, const std::string_view msg) noexcept {
+    std::size_t pos = _tail.load (std::memory_order_relaxed);
+    Slot* slot      = nullptr;
+    for (;;) {
+        slot                 = &_slots[pos & _mask];
+        const std::size_t sq = slot->seq.load (std::memory_order_acquire);
+        const auto diff      = static_cast<std::ptrdiff_t> (sq) - static_cast<std::ptrdiff_t> (pos);
+        if (diff == 0) {
+            if (_tail.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = _tail.load (std::memory_order_relaxed);
+        }
+    }
+    slot->entry.epoch_ms = epoch_ms;
+    slot->entry.level    = level;
+    slot->entry.message.assign (msg.data (), msg.size ());
+    slot->seq.store (pos + 1, std::memory_order_release);
+    return true;
+}
+
+MpscRing::Slot* MpscRing::claim_head (std::size_t& pos) noexcept {
+    pos = _head.load (std::memory_order_relaxed);
+    for (;;) {
+        Slot* slot           = &_slots[pos & _mask];
+        const std::size_t sq = slot->seq.load (std::memory_order_acquire);
+        const auto diff      = static_cast<std::ptrdiff_t> (sq) - static_cast<std::ptrdiff_t> (pos + 1);
+        if (diff == 0) {
+            if (_head.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                return slot;
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = _head.load (std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MpscRing::try_pop (LogEntry& out) noexcept {
+    std::size_t pos;
+    Slot* const slot = claim_head (pos);
+    if (!slot)
+        return false;
+    out.epoch_ms = slot->entry.epoch_ms;
+    out.level    = slot->entry.level;
+    out.message.swap (slot->entry.message);
+    slot->seq.store (pos + _mask + 1, std::memory_order_release);
+    return true;
+}
+
+bool MpscRing::try_drop () noexcept {
+    std::size_t pos;
+    Slot* const slot = claim_head (pos);
+    if (!slot)
+        return false;
+    slot->seq.store (pos + _mask + 1, std::memory_order_release);
+    return true;
+}
+
+bool MpscRing::empty () const noexcept {
+    const std::size_t pos = _head.load (std::memory_order_acquire);
+    return _slots[pos & _mask].seq.load (std::memory_order_acquire) != pos + 1;
+}
+} // namespace logger
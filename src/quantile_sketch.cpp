@@ -0,0 +1,41 @@
+#include "logger/quantile_sketch.hpp"
+
+#include <cmath>
+
+namespace logger {
+std::uint64_t QuantileSketch::lower_bound (const std::size_t i) noexcept {
+    if (i < (2u << kSubBits))
+        return i;
+    const std::size_t e = (i >> kSubBits) + kSubBits - 1;
+    const std::uint64_t m = (i & ((1u << kSubBits) - 1)) | (1u << kSubBits);
+    return m << (e - kSubBits);
+}
+
+std::uint64_t QuantileSketch::representative (const std::size_t i) noexcept {
+    if (i < (2u << kSubBits))
+        return i;
+    const std::uint64_t lo    = lower_bound (i);
+    const std::uint64_t width = std::uint64_t{ 1 } << ((i >> kSubBits) - 1);
+    return lo + (width - 1) / 2;
+}
+
+void QuantileSketch::merge (const QuantileSketch& other) noexcept {
+    for (std::size_t i = 0; i < kBuckets; ++i)
+        _counts[i] += other._counts[i];
+    _count += other._count;
+}
+
+std::uint64_t QuantileSketch::quantile (const double q) const noexcept {
+    if (_count == 0)
+        return 0;
+    const double want  = std::ceil (q * static_cast<double> (_count));
+    const auto rank    = want < 1.0 ? std::uint64_t{ 1 } : static_cast<std::uint64_t> (want);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += _counts[i];
+        if (seen >= rank)
+            return representative (i);
+    }
+    return representative (kBuckets - 1);
+}
+} // namespace logger
@@ -1,31 +1,321 @@
 #include "logger/socket_sink.hpp"
 #include "logger/log_level.hpp"
 #include "logger/utils.hpp"
+#include "logger/wire.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <charconv>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <utility>
 
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 namespace logger {
-SocketSink::SocketSink (std::string host, const std::uint16_t port) noexcept : _host (std::move (host)), _port (port) {
+namespace {
+constexpr auto kIdleWait           = std::chrono::milliseconds (100);
+constexpr auto kDoneWait           = std::chrono::milliseconds (10);
+constexpr auto kBacklogPoll        = std::chrono::milliseconds (10);
+constexpr std::size_t kReplayChunk = 64 * 1024;
+constexpr std::size_t kReplayAll   = std::numeric_limits<std::size_t>::max ();
+constexpr std::size_t kBlockTarget = 1 << 20; // binary block size when a send is larger
+
+/** @brief Length of the complete lines within the first @p sent bytes of @p data. */
+std::size_t whole_lines (const std::string_view data, const std::size_t sent) noexcept {
+    if (sent == 0)
+        return 0;
+    const std::size_t nl = data.rfind ('\n', sent - 1);
+    return nl == std::string_view::npos ? 0 : nl + 1;
+}
+
+// A spool starts with a tag naming the format of the records after it.
+constexpr std::string_view kSpoolText   = "LGSPOOL T\n";
+constexpr std::string_view kSpoolBinary = "LGSPOOL B\n";
+constexpr std::size_t kSpoolTagBytes    = 10;
+
+std::string_view spool_tag (const WireFormat wire) noexcept {
+    return wire == WireFormat::Binary ? kSpoolBinary : kSpoolText;
+}
+
+/** @brief Append text lines ("epoch_ms|LEVEL|message\n") as binary records; malformed lines are skipped. */
+void append_lines_as_records (std::string& out, std::string_view lines) {
+    for (std::size_t nl; (nl = lines.find ('\n')) != std::string_view::npos; lines.remove_prefix (nl + 1)) {
+        const std::string_view line = lines.substr (0, nl);
+        const std::size_t a         = line.find ('|');
+        const std::size_t b         = a == std::string_view::npos ? a : line.find ('|', a + 1);
+        std::uint64_t epoch_ms      = 0;
+        LogLevel level              = LogLevel::Info;
+        if (b == std::string_view::npos || std::from_chars (line.data (), line.data () + a, epoch_ms).ptr != line.data () + a ||
+        !parse_level (line.substr (a + 1, b - a - 1), level))
+            continue;
+        wire::append_record (out, epoch_ms, level, line.substr (b + 1));
+    }
+}
+
+bool write_all (const int fd, std::string_view data) noexcept {
+    while (!data.empty ()) {
+        const ssize_t n = ::write (fd, data.data (), data.size ());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data.remove_prefix (static_cast<std::size_t> (n));
+    }
+    return true;
+}
+} // namespace
+
+bool fill_unix_address (const std::string& path, sockaddr_storage& out, socklen_t& len) noexcept {
+    sockaddr_un un{};
+    if (path.empty () || path.size () >= sizeof (un.sun_path))
+        return false;
+    un.sun_family = AF_UNIX;
+    std::memcpy (un.sun_path, path.data (), path.size ());
+    std::memset (&out, 0, sizeof (out));
+    std::memcpy (&out, &un, sizeof (un));
+    len = static_cast<socklen_t> (offsetof (sockaddr_un, sun_path) + path.size () + 1);
+    return true;
+}
+
+struct SocketSink::Endpoint {
+    sockaddr_storage addr{};
+    socklen_t len{ 0 };
+    int family{ 0 };
+    int socktype{ 0 };
+    int protocol{ 0 };
+    bool text_only{ false }; ///< Ignored the binary hello: connect in text mode until re-resolved.
+};
+
+int SocketSink::connect_endpoint (const Endpoint& ep, const std::chrono::milliseconds timeout, std::string& err) noexcept {
+    const int fd = ::socket (ep.family, ep.socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ep.protocol);
+    if (fd == -1) {
+        err = std::string ("SocketSink: socket failed: ") + std::strerror (errno);
+        return -1;
+    }
+    if (ep.family != AF_UNIX) {
+        int one = 1;
+        setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    }
+    if (::connect (fd, reinterpret_cast<const sockaddr*> (&ep.addr), ep.len) != 0) {
+        if (errno != EINPROGRESS) {
+            err = std::string ("SocketSink: connect failed: ") + std::strerror (errno);
+            ::close (fd);
+            return -1;
+        }
+        pollfd pfd{ fd, POLLOUT, 0 };
+        int rc;
+        do
+            rc = ::poll (&pfd, 1, static_cast<int> (timeout.count ()));
+        while (rc < 0 && errno == EINTR);
+        int so_error  = rc < 0 ? errno : 0;
+        socklen_t len = sizeof (so_error);
+        if (rc > 0 && getsockopt (fd, SOL_SOCKET, SO_ERROR, &so_error, &len) != 0)
+            so_error = errno;
+        if (rc == 0 || so_error != 0) {
+            err = rc == 0 ? "SocketSink: connect timed out" :
+                            std::string ("SocketSink: connect failed: ") + std::strerror (so_error);
+            ::close (fd);
+            return -1;
+        }
+    }
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) & ~O_NONBLOCK);
+    return fd;
+}
+
+bool SocketSink::negotiate (const int fd, const std::chrono::milliseconds timeout, bool& binary, std::string& err) noexcept {
+    binary = false;
+    if (::send (fd, wire::kHello.data (), wire::kHello.size (), MSG_NOSIGNAL) !=
+    static_cast<ssize_t> (wire::kHello.size ())) {
+        err = std::string ("SocketSink: handshake failed: ") + std::strerror (errno);
+        return false;
+    }
+    // A text-only collector drops the hello as a malformed line and never answers.
+    char reply[wire::kAccept.size ()];
+    std::size_t got     = 0;
+    const auto deadline = std::chrono::steady_clock::now () + timeout;
+    while (got < sizeof (reply)) {
+        const auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds> (deadline - std::chrono::steady_clock::now ());
+        pollfd pfd{ fd, POLLIN, 0 };
+        const int rc = left.count () > 0 ? ::poll (&pfd, 1, static_cast<int> (left.count ())) : 0;
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            break;
+        const ssize_t n = ::recv (fd, reply + got, sizeof (reply) - got, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            err = "SocketSink: connection closed during handshake";
+            return false;
+        }
+        got += static_cast<std::size_t> (n);
+        if (std::string_view (reply, got) != wire::kAccept.substr (0, got))
+            break;
+    }
+    binary = std::string_view (reply, got) == wire::kAccept;
+    return true;
+}
+
+SocketSink::SocketSink (std::string host, const std::uint16_t port, const SocketSinkOptions opts) noexcept
+: _host (std::move (host)), _port (port), _opts (opts) {
+    start ();
+}
+
+SocketSink::SocketSink (UnixPath path, const SocketSinkOptions opts) noexcept
+: _unix_path (std::move (path.path)), _opts (opts) {
+    start ();
+}
+
+void SocketSink::start () noexcept {
+    if (!_opts.spool_path.empty ())
+        open_spool ();
+    if (_opts.background_connect && !_opts.async)
+        _connector = std::thread ([this] { connector_loop (); });
+    if (_opts.async) {
+        _backlog.store (has_backlog_locked (), std::memory_order_relaxed);
+        _ring   = std::make_unique<MpscRing> (_opts.queue_capacity);
+        _sender = std::thread ([this] { sender_loop (); });
+    }
+}
+
+void SocketSink::open_spool () noexcept {
+    // A spool left by an earlier run is replayed before anything new.
+    _spool_fd = ::open (_opts.spool_path.c_str (), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st{};
+    if (_spool_fd == -1 || ::fstat (_spool_fd, &st) != 0)
+        return;
+    _spool_size = static_cast<std::uint64_t> (st.st_size);
+    char tag[kSpoolTagBytes];
+    if (_spool_size < sizeof (tag) || ::pread (_spool_fd, tag, sizeof (tag), 0) != static_cast<ssize_t> (sizeof (tag)))
+        return;
+    const std::string_view found (tag, sizeof (tag));
+    if (found == spool_tag (_opts.wire)) {
+        _spool_off = sizeof (tag);
+        return;
+    }
+    if (found != kSpoolText && found != kSpoolBinary)
+        return; // untagged: written before the tag existed, in this format
     std::string err;
-    connect_socket (err);
+    if (!convert_spool (err)) {
+        // Mixing formats in one file would lose it all; leave it for recovery.
+        ::close (_spool_fd);
+        _spool_fd   = -1;
+        _spool_size = 0;
+        std::lock_guard ek (_err_mu);
+        _last_err = err;
+    }
+}
+
+bool SocketSink::convert_spool (std::string& err) noexcept {
+    const bool from_binary = _opts.wire == WireFormat::Text;
+    int out                = -1;
+    try {
+        const std::string tmp = _opts.spool_path + ".tmp";
+        out                   = ::open (tmp.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok               = out != -1;
+        std::string in, conv (spool_tag (_opts.wire));
+        for (std::uint64_t off = kSpoolTagBytes; ok;) {
+            const std::size_t at = in.size ();
+            in.resize (at + kReplayChunk);
+            const ssize_t got = ::pread (_spool_fd, in.data () + at, kReplayChunk, static_cast<off_t> (off));
+            in.resize (at + static_cast<std::size_t> (std::max<ssize_t> (got, 0)));
+            off += static_cast<std::uint64_t> (std::max<ssize_t> (got, 0));
+            const std::string_view view (in);
+            const std::size_t whole = from_binary ? wire::whole_records (view, view.size ()) : whole_lines (view, view.size ());
+            if (from_binary) {
+                // A header that is complete but invalid will never become a record.
+                const bool corrupt = whole == 0 && view.size () >= wire::kMaxVarintBytes + wire::kRecordFixedBytes &&
+                wire::record_size (view) == 0;
+                ok = !corrupt && wire::append_as_text (conv, view.substr (0, whole));
+            } else {
+                append_lines_as_records (conv, view.substr (0, whole));
+            }
+            in.erase (0, whole);
+            ok = ok && got >= 0 && write_all (out, conv);
+            conv.clear ();
+            if (got <= 0)
+                break; // a record cut at the end is dropped, as replay would
+        }
+        ok = ::close (std::exchange (out, -1)) == 0 && ok;
+        if (!ok || ::rename (tmp.c_str (), _opts.spool_path.c_str ()) != 0) {
+            err = "SocketSink: could not convert the spool to the configured wire format; left untouched";
+            ::unlink (tmp.c_str ());
+            return false;
+        }
+    } catch (const std::bad_alloc&) {
+        if (out != -1)
+            ::close (out);
+        err = "SocketSink: out of memory converting the spool";
+        return false;
+    }
+    ::close (_spool_fd);
+    _spool_fd   = ::open (_opts.spool_path.c_str (), O_RDWR | O_APPEND | O_CLOEXEC);
+    _spool_size = _spool_off = 0;
+    struct stat st{};
+    if (_spool_fd != -1 && ::fstat (_spool_fd, &st) == 0) {
+        _spool_size = static_cast<std::uint64_t> (st.st_size);
+        _spool_off  = kSpoolTagBytes;
+    }
+    return true;
 }
 
 SocketSink::~SocketSink () {
+    if (_sender.joinable ()) {
+        _stop.store (true, std::memory_order_release);
+        {
+            std::lock_guard lk (_wake_mu);
+            _wake_cv.notify_one ();
+        }
+        _sender.join ();
+    }
+    if (_connector.joinable ()) {
+        {
+            std::lock_guard lk (_mu);
+            _connector_stop = true;
+        }
+        _connect_cv.notify_one ();
+        _connector.join ();
+    }
+    {
+        std::lock_guard lk (_mu);
+        std::string err;
+        const bool connected = _connector_stop ? _fd != -1 : try_connect_locked (err);
+        if (has_backlog_locked () && connected)
+            replay_locked (kReplayAll, err);
+        spool_memory_locked (err);
+    }
     close_socket ();
+    if (_spool_fd != -1)
+        ::close (_spool_fd);
 }
 
-bool SocketSink::connect_socket (std::string& err) noexcept {
-    if (_fd != -1)
+bool SocketSink::resolve (std::string& err) noexcept {
+    if (!_unix_path.empty ()) {
+        Endpoint ep;
+        if (!fill_unix_address (_unix_path, ep.addr, ep.len)) {
+            err = "SocketSink: unix socket path too long: " + _unix_path;
+            return false;
+        }
+        ep.family   = AF_UNIX;
+        ep.socktype = SOCK_STREAM;
+        _addrs.assign (1, ep);
         return true;
+    }
     addrinfo hints{};
     hints.ai_family   = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
@@ -36,26 +326,57 @@ bool SocketSink::connect_socket (std::string& err) noexcept {
         err = std::string ("get addr info: ") + gai_strerror (rc);
         return false;
     }
-
+    _addrs.clear ();
     for (const addrinfo* p = res; p != nullptr; p = p->ai_next) {
-        int fd = socket (p->ai_family, p->ai_socktype, p->ai_protocol);
+        Endpoint ep;
+        std::memcpy (&ep.addr, p->ai_addr, p->ai_addrlen);
+        ep.len      = p->ai_addrlen;
+        ep.family   = p->ai_family;
+        ep.socktype = p->ai_socktype;
+        ep.protocol = p->ai_protocol;
+        _addrs.push_back (ep);
+    }
+    freeaddrinfo (res);
+    return true;
+}
+
+int SocketSink::open_connection (bool& binary, std::string& err) noexcept {
+    const auto now = std::chrono::steady_clock::now ();
+    if (_addrs.empty () || now - _resolved_at >= _opts.dns_ttl) {
+        // While DNS is failing, stale addresses are better than none.
+        if (resolve (err))
+            _resolved_at = now;
+        else if (_addrs.empty ())
+            return -1;
+    }
+    binary = false;
+    for (Endpoint& ep : _addrs) {
+        int fd = connect_endpoint (ep, _opts.connect_timeout, err);
         if (fd == -1)
             continue;
-        int one = 1;
-        setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
-        if (connect (fd, p->ai_addr, p->ai_addrlen) == 0) {
-            _fd = fd;
-            break;
+        if (_opts.wire == WireFormat::Text || ep.text_only)
+            return fd;
+        if (!negotiate (fd, _opts.connect_timeout, binary, err)) {
+            ::close (fd);
+            continue;
         }
-        close (fd);
-        // fd = -1;
+        if (binary)
+            return fd;
+        // A late accept on this connection would make the collector read
+        // our text as blocks: start over on a connection that never offered.
+        ::close (fd);
+        ep.text_only = true;
+        if ((fd = connect_endpoint (ep, _opts.connect_timeout, err)) != -1)
+            return fd;
     }
-    freeaddrinfo (res);
-    if (_fd == -1) {
-        err = "SocketSink: connect failed";
-        return false;
-    }
-    return true;
+    _resolved_at = {}; // resolve again next time: the collector may have moved
+    return -1;
+}
+
+bool SocketSink::connect_socket (std::string& err) noexcept {
+    if (_fd == -1)
+        _fd = open_connection (_conn_binary, err);
+    return _fd != -1;
 }
 
 void SocketSink::close_socket () noexcept {
@@ -65,37 +386,468 @@ void SocketSink::close_socket () noexcept {
     }
 }
 
+bool SocketSink::try_connect_locked (std::string& err) noexcept {
+    if (_fd != -1)
+        return true;
+    const auto now = std::chrono::steady_clock::now ();
+    if (now < _next_attempt) {
+        err = "SocketSink: collector unreachable, waiting to reconnect";
+        return false;
+    }
+    if (_connector.joinable ()) {
+        if (!_connecting) {
+            _connecting = true;
+            _connect_cv.notify_one ();
+        }
+        err = "SocketSink: connecting in the background";
+        return false;
+    }
+    const bool ok = connect_socket (err);
+    note_attempt_locked (ok);
+    return ok;
+}
+
+void SocketSink::note_attempt_locked (const bool ok) noexcept {
+    if (ok) {
+        _backoff = std::chrono::milliseconds (0);
+        return;
+    }
+    _backoff      = _backoff.count () == 0 ? _opts.reconnect_min : std::min (_backoff * 2, _opts.reconnect_max);
+    _next_attempt = std::chrono::steady_clock::now () + _backoff;
+}
+
+void SocketSink::connector_loop () noexcept {
+    std::unique_lock lk (_mu);
+    for (;;) {
+        _connect_cv.wait (lk, [this] { return _connector_stop || _connecting; });
+        if (_connector_stop)
+            break;
+        // Resolve and connect without holding the mutex writers need.
+        lk.unlock ();
+        std::string err;
+        bool binary   = false;
+        const int fd  = open_connection (binary, err);
+        lk.lock ();
+        _fd          = fd;
+        _conn_binary = binary;
+        _connecting  = false;
+        note_attempt_locked (fd != -1);
+        if (fd == -1) {
+            std::lock_guard ek (_err_mu);
+            _last_err = err;
+        }
+    }
+}
+
+namespace {
+void append_wire_line (std::string& out, const std::uint64_t epoch_ms, const LogLevel level, const std::string_view msg) {
+    char digits[20];
+    const auto res = std::to_chars (digits, digits + sizeof (digits), epoch_ms);
+    out.append (digits, res.ptr);
+    out += '|';
+    out += to_string (level);
+    out += '|';
+    out += msg;
+    out += '\n';
+}
+} // namespace
+
+void SocketSink::encode (std::string& out, const std::uint64_t epoch_ms, const LogLevel level, const std::string_view msg) const {
+    if (_opts.wire == WireFormat::Binary)
+        wire::append_record (out, epoch_ms, level, msg);
+    else
+        append_wire_line (out, epoch_ms, level, msg);
+}
+
 bool SocketSink::write (const LogEntry& e, std::string& err) noexcept {
+    return write_view (LogEntryView{ e.epoch_ms, e.level, e.message }, err);
+}
+
+bool SocketSink::write_view (const LogEntryView& e, std::string& err) noexcept {
+    if (_ring)
+        return enqueue (e.epoch_ms, e.level, e.message, err);
+    std::lock_guard lk (_mu);
+    _batch.clear ();
+    encode (_batch, e.epoch_ms, e.level, e.message);
+    const Delivery d = deliver_locked (_batch, err);
+    account (d, 1, err);
+    return d != Delivery::Failed;
+}
+
+std::size_t SocketSink::write_batch (const LogEntry* entries, const std::size_t count, std::string& err) noexcept {
+    if (_ring) {
+        for (std::size_t i = 0; i < count; ++i)
+            if (!enqueue (entries[i].epoch_ms, entries[i].level, entries[i].message, err))
+                return i;
+        return count;
+    }
     std::lock_guard lk (_mu);
-    if (_fd == -1) {
-        if (!connect_socket (err))
+    _batch.clear ();
+    for (std::size_t i = 0; i < count; ++i)
+        encode (_batch, entries[i].epoch_ms, entries[i].level, entries[i].message);
+    const Delivery d = deliver_locked (_batch, err);
+    account (d, count, err);
+    return d != Delivery::Failed ? count : 0;
+}
+
+bool SocketSink::send_some (const char* data, const std::size_t len, std::size_t& sent) noexcept {
+    sent = 0;
+    while (sent < len) {
+        const ssize_t n = send (_fd, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += static_cast<std::size_t> (n);
+    }
+    return true;
+}
+
+bool SocketSink::send_block (const std::string_view body) noexcept {
+    char head[wire::kMaxBlockHeader];
+    char tail[4];
+    iovec iov[3] = { { head, wire::block_header (head, body.size (), _opts.wire_checksum) },
+        { const_cast<char*> (body.data ()), body.size () }, { tail, 0 } };
+    if (_opts.wire_checksum) {
+        const std::uint32_t crc = wire::crc32 (body.data (), body.size ());
+        std::memcpy (tail, &crc, sizeof (crc));
+        iov[2].iov_len = sizeof (crc);
+    }
+    msghdr msg{};
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = 3;
+    while (msg.msg_iovlen > 0) {
+        const ssize_t n = ::sendmsg (_fd, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        auto left = static_cast<std::size_t> (n);
+        while (msg.msg_iovlen > 0 && left >= msg.msg_iov->iov_len) {
+            left -= msg.msg_iov->iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<char*> (msg.msg_iov->iov_base) + left;
+            msg.msg_iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+bool SocketSink::transmit_locked (std::string_view data, std::size_t& done) noexcept {
+    done             = 0;
+    std::size_t sent = 0;
+    if (_opts.wire == WireFormat::Text) {
+        const bool ok = send_some (data.data (), data.size (), sent);
+        done          = ok ? data.size () : whole_lines (data, sent);
+        return ok;
+    }
+    if (!_conn_binary) {
+        // Text-only collector; after a failure the whole run is resent.
+        _text_buf.clear ();
+        wire::append_as_text (_text_buf, data);
+        if (!send_some (_text_buf.data (), _text_buf.size (), sent))
+            return false;
+        done = data.size ();
+        return true;
+    }
+    // The collector drops a block cut short, so only whole blocks count as done.
+    while (!data.empty ()) {
+        std::size_t n = wire::whole_records (data, std::min (data.size (), kBlockTarget));
+        if (n == 0)
+            n = std::max<std::size_t> (wire::record_size (data), 1);
+        n = std::min (n, data.size ());
+        if (!send_block (data.substr (0, n)))
             return false;
+        done += n;
+        data.remove_prefix (n);
     }
-    std::string line = std::to_string (e.epoch_ms);
-    line += "|";
-    line += std::string (to_string (e.level));
-    line += "|";
-    line += e.message;
-    line += "\n";
-    const char* data = line.c_str ();
-    size_t left      = line.size ();
-    while (left > 0) {
-        ssize_t n = send (_fd, data, left, MSG_NOSIGNAL);
+    return true;
+}
+
+SocketSink::Delivery SocketSink::deliver_locked (std::string_view data, std::string& err) noexcept {
+    if (has_backlog_locked ()) {
+        // Older records go first: queue behind them and replay a bounded chunk.
+        if (!spill_locked (data, err))
+            return Delivery::Failed;
+        if (try_connect_locked (err))
+            replay_locked (kReplayChunk, err);
+        return Delivery::Spilled;
+    }
+    // One immediate retry covers a collector that restarted while we were idle.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!try_connect_locked (err))
+            break;
+        std::size_t done = 0;
+        if (transmit_locked (data, done))
+            return Delivery::Sent;
+        data.remove_prefix (done);
+        close_socket ();
+        err = "SocketSink: send failed";
+    }
+    return spill_locked (data, err) ? Delivery::Spilled : Delivery::Failed;
+}
+
+bool SocketSink::spill_locked (const std::string_view data, std::string& err) noexcept {
+    if (_spill_head > 0 && _spill_head >= _spill.size () / 2) {
+        _spill.erase (0, _spill_head);
+        _spill_head = 0;
+    }
+    const std::size_t held = _spill.size () - _spill_head;
+    if (held + data.size () > _opts.spill_bytes) {
+        if (_spool_fd == -1 || !spool_memory_locked (err))
+            return false;
+        if (data.size () > _opts.spill_bytes)
+            return spool_write_locked (data, err);
+    }
+    _spill.append (data);
+    return true;
+}
+
+bool SocketSink::spool_write_locked (std::string_view data, std::string& err) noexcept {
+    if (_spool_fd == -1)
+        return false;
+    // A new (or emptied) spool gets the tag first; replay starts past it.
+    const std::string_view tag = _spool_size == 0 ? spool_tag (_opts.wire) : std::string_view{};
+    if (_spool_size + tag.size () + data.size () > _opts.spool_max_bytes) {
+        err = "SocketSink: spool file full";
+        return false;
+    }
+    if (!tag.empty ()) {
+        if (!write_all (_spool_fd, tag)) {
+            err = std::string ("SocketSink: spool write failed: ") + std::strerror (errno);
+            (void)::ftruncate (_spool_fd, 0);
+            return false;
+        }
+        _spool_size = _spool_off = tag.size ();
+    }
+    while (!data.empty ()) {
+        const ssize_t n = ::write (_spool_fd, data.data (), data.size ());
+        if (n < 0 && errno == EINTR)
+            continue;
         if (n <= 0) {
-            close_socket ();
-            if (!connect_socket (err)) {
-                err = "SocketSink: send failed and reconnect failed";
-                return false;
+            err = std::string ("SocketSink: spool write failed: ") + std::strerror (errno);
+            return false;
+        }
+        _spool_size += static_cast<std::uint64_t> (n);
+        data.remove_prefix (static_cast<std::size_t> (n));
+    }
+    return true;
+}
+
+bool SocketSink::spool_memory_locked (std::string& err) noexcept {
+    if (_spill_head == _spill.size ())
+        return true;
+    if (!spool_write_locked (std::string_view (_spill).substr (_spill_head), err))
+        return false;
+    _spill.clear ();
+    _spill_head = 0;
+    return true;
+}
+
+std::string_view SocketSink::backlog_chunk_locked (const bool from_spool, const std::size_t want, std::string& err) noexcept {
+    if (!from_spool)
+        return std::string_view (_spill).substr (_spill_head, want);
+    const std::uint64_t left = _spool_size - _spool_off;
+    const std::size_t n      = left < want ? static_cast<std::size_t> (left) : want;
+    _replay_buf.resize (n);
+    const ssize_t got = ::pread (_spool_fd, _replay_buf.data (), n, static_cast<off_t> (_spool_off));
+    if (got <= 0) {
+        err        = "SocketSink: spool read failed, spool discarded";
+        _spool_off = _spool_size;
+        return {};
+    }
+    return std::string_view (_replay_buf.data (), static_cast<std::size_t> (got));
+}
+
+bool SocketSink::replay_locked (std::size_t budget, std::string& err) noexcept {
+    while (budget > 0 && has_backlog_locked ()) {
+        const bool from_spool  = _spool_off < _spool_size;
+        const auto avail       = backlog_chunk_locked (from_spool, kReplayChunk, err);
+        std::string_view chunk = avail.substr (0, std::min (budget, avail.size ()));
+        if (_opts.wire == WireFormat::Binary && !chunk.empty ()) {
+            std::size_t whole = wire::whole_records (chunk, chunk.size ());
+            if (whole == 0) {
+                // One record larger than the chunk or the budget: replay it on its own.
+                const std::size_t need = wire::record_size (avail);
+                chunk                  = need == 0 ? std::string_view{} : backlog_chunk_locked (from_spool, need, err);
+                whole                  = need != 0 && chunk.size () == need ? need : 0;
             }
-            n = send (_fd, data, left, MSG_NOSIGNAL);
-            if (n <= 0) {
-                err = "SocketSink: send failed after reconnect";
-                return false;
+            if (whole == 0) {
+                err = "SocketSink: corrupt backlog discarded";
+                if (from_spool)
+                    _spool_off = _spool_size;
+                else
+                    _spill_head = _spill.size ();
             }
+            chunk = chunk.substr (0, whole);
+        } else if (const std::size_t whole = whole_lines (chunk, chunk.size ()); whole > 0) {
+            chunk = chunk.substr (0, whole);
+        }
+
+        std::size_t done = 0;
+        const bool ok    = chunk.empty () || transmit_locked (chunk, done);
+        if (from_spool)
+            _spool_off += done;
+        else
+            _spill_head += done;
+        budget -= std::min (budget, std::max<std::size_t> (done, 1));
+        if (_spool_fd != -1 && _spool_off == _spool_size && _spool_size > 0) {
+            if (::ftruncate (_spool_fd, 0) == 0)
+                _spool_size = _spool_off = 0;
+        }
+        if (_spill_head == _spill.size ()) {
+            _spill.clear ();
+            _spill_head = 0;
+        }
+        if (!ok) {
+            close_socket ();
+            err = "SocketSink: send failed during replay";
+            return false;
         }
-        data += n;
-        left -= static_cast<size_t> (n);
     }
     return true;
 }
+
+bool SocketSink::enqueue (const std::uint64_t epoch_ms,
+const LogLevel level,
+const std::string_view msg,
+std::string& err) noexcept {
+    if (!_ring->try_push (epoch_ms, level, msg)) {
+        _dropped.fetch_add (1, std::memory_order_relaxed);
+        err = "SocketSink: send queue full, record dropped";
+        return false;
+    }
+    _enqueued.fetch_add (1, std::memory_order_release);
+    wake_sender ();
+    return true;
+}
+
+void SocketSink::wake_sender () noexcept {
+    // Pairs with the fence in sender_loop(): either the sender sees the new
+    // record before sleeping, or we see it sleeping and notify.
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (_sleeping.load (std::memory_order_relaxed)) {
+        std::lock_guard lk (_wake_mu);
+        _wake_cv.notify_one ();
+    }
+}
+
+void SocketSink::sender_loop () noexcept {
+    using clock = std::chrono::steady_clock;
+    LogEntry e;
+    std::uint64_t pending = 0; // records in _batch
+    clock::time_point first_at;
+    _batch.clear ();
+    for (;;) {
+        while (_batch.size () < _opts.batch_bytes && _ring->try_pop (e)) {
+            if (pending++ == 0)
+                first_at = clock::now ();
+            encode (_batch, e.epoch_ms, e.level, e.message);
+        }
+        const bool stopping      = _stop.load (std::memory_order_acquire);
+        const std::uint64_t done = _consumed.load (std::memory_order_relaxed);
+        const bool flushing      = _flush_target.load (std::memory_order_acquire) > done;
+        if (pending > 0 &&
+        (_batch.size () >= _opts.batch_bytes || clock::now () - first_at >= _opts.linger || stopping || flushing)) {
+            send_batch (pending);
+            pending = 0;
+            continue;
+        }
+        if (stopping && _ring->empty ())
+            break;
+        if (pending == 0 && service_backlog ())
+            continue;
+
+        std::unique_lock lk (_wake_mu);
+        if (pending > 0) {
+            // Lingering: producers do not signal, only flush() and stop do.
+            _wake_cv.wait_until (lk, first_at + _opts.linger);
+            continue;
+        }
+        _sleeping.store (true, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        if (_ring->empty () && !_stop.load (std::memory_order_acquire))
+            _wake_cv.wait_for (lk, _backlog.load (std::memory_order_relaxed) ? kBacklogPoll : kIdleWait);
+        _sleeping.store (false, std::memory_order_relaxed);
+    }
+}
+
+bool SocketSink::service_backlog () noexcept {
+    std::lock_guard lk (_mu);
+    std::string err;
+    bool progressed = false;
+    if (has_backlog_locked () && try_connect_locked (err)) {
+        progressed = replay_locked (_opts.batch_bytes, err);
+        if (!progressed) {
+            std::lock_guard ek (_err_mu);
+            _last_err = err;
+        }
+    }
+    _backlog.store (has_backlog_locked (), std::memory_order_relaxed);
+    return progressed;
+}
+
+void SocketSink::send_batch (const std::uint64_t records) noexcept {
+    std::string err;
+    Delivery d;
+    {
+        std::lock_guard lk (_mu);
+        d = deliver_locked (_batch, err);
+        _backlog.store (has_backlog_locked (), std::memory_order_relaxed);
+    }
+    _batch.clear ();
+    account (d, records, err);
+    _consumed.fetch_add (records, std::memory_order_release);
+    std::lock_guard lk (_wake_mu);
+    _done_cv.notify_all ();
+}
+
+void SocketSink::account (const Delivery d, const std::uint64_t records, const std::string& err) noexcept {
+    switch (d) {
+    case Delivery::Sent: _sent.fetch_add (records, std::memory_order_relaxed); break;
+    case Delivery::Spilled: _spilled.fetch_add (records, std::memory_order_relaxed); break;
+    case Delivery::Failed: {
+        _send_errors.fetch_add (records, std::memory_order_relaxed);
+        std::lock_guard lk (_err_mu);
+        _last_err = err;
+        break;
+    }
+    }
+}
+
+void SocketSink::flush () noexcept {
+    if (!_ring) {
+        // Synchronous mode: push the whole backlog out if the collector is back.
+        std::lock_guard lk (_mu);
+        std::string err;
+        if (has_backlog_locked () && try_connect_locked (err))
+            replay_locked (kReplayAll, err);
+        return;
+    }
+    const std::uint64_t target = _enqueued.load (std::memory_order_acquire);
+    std::unique_lock lk (_wake_mu);
+    if (_flush_target.load (std::memory_order_relaxed) < target)
+        _flush_target.store (target, std::memory_order_release);
+    _wake_cv.notify_one ();
+    while (_consumed.load (std::memory_order_acquire) < target && _sender.joinable ())
+        _done_cv.wait_for (lk, kDoneWait);
+}
+
+SocketSinkCounters SocketSink::counters () const noexcept {
+    SocketSinkCounters c;
+    c.enqueued    = _enqueued.load (std::memory_order_relaxed);
+    c.sent        = _sent.load (std::memory_order_relaxed);
+    c.dropped     = _dropped.load (std::memory_order_relaxed);
+    c.spilled     = _spilled.load (std::memory_order_relaxed);
+    c.send_errors = _send_errors.load (std::memory_order_relaxed);
+    return c;
+}
+
+std::string SocketSink::last_error () const {
+    std::lock_guard lk (_err_mu);
+    return _last_err;
+}
 } // namespace logger
@@ -0,0 +1,91 @@
+#include "logger/source_stats.hpp"
+
+#include <algorithm>
+
+namespace logger {
+SourceStatsTable::SourceStatsTable (const std::size_t max_sources) : _max (std::max<std::size_t> (max_sources, 1)) {
+}
+
+void SourceStatsTable::merge (const std::string_view source, const SourceCounts& delta, const std::uint64_t now_ms) {
+    if (delta.total == 0)
+        return;
+    std::lock_guard lk (_mu);
+    merge_locked (source, delta, now_ms);
+}
+
+void SourceStatsTable::merge (const SourceStatsTable& other) {
+    if (&other == this)
+        return;
+    // Copied out first, so the two locks are never held together.
+    std::vector<SourceStats> rows;
+    {
+        std::lock_guard lk (other._mu);
+        rows.reserve (other._entries.size ());
+        for (const auto& [name, e] : other._entries)
+            rows.push_back (SourceStats{ name, e.counts, e.last_seen_ms });
+    }
+    std::lock_guard lk (_mu);
+    for (const SourceStats& r : rows)
+        if (r.counts.total != 0)
+            merge_locked (r.source, r.counts, r.last_seen_ms);
+}
+
+void SourceStatsTable::merge_locked (const std::string_view source, const SourceCounts& delta, const std::uint64_t now_ms) {
+    std::string name (source);
+    auto it = _entries.find (name);
+    if (it == _entries.end ()) {
+        // The overflow entry does not count against the cap.
+        if (_entries.size () - _entries.count (std::string (kOverflow)) >= _max)
+            name = kOverflow;
+        it = _entries.try_emplace (std::move (name)).first;
+    }
+    it->second.counts.merge (delta);
+    it->second.last_seen_ms = std::max (it->second.last_seen_ms, now_ms);
+}
+
+std::size_t SourceStatsTable::evict_idle (const std::uint64_t before_ms) {
+    std::lock_guard lk (_mu);
+    std::size_t removed = 0;
+    for (auto it = _entries.begin (); it != _entries.end ();) {
+        if (it->second.last_seen_ms < before_ms) {
+            it = _entries.erase (it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+template <class Key> std::vector<SourceStats> SourceStatsTable::top_locked (const std::size_t n, Key key) const {
+    std::vector<SourceStats> out;
+    for (const auto& [name, e] : _entries)
+        if (key (e.counts) > 0)
+            out.push_back (SourceStats{ name, e.counts, e.last_seen_ms });
+    const auto before = [&] (const SourceStats& a, const SourceStats& b) {
+        return key (a.counts) != key (b.counts) ? key (a.counts) > key (b.counts) : a.source < b.source;
+    };
+    if (out.size () > n) {
+        std::partial_sort (out.begin (), out.begin () + static_cast<std::ptrdiff_t> (n), out.end (), before);
+        out.resize (n);
+    } else {
+        std::sort (out.begin (), out.end (), before);
+    }
+    return out;
+}
+
+std::vector<SourceStats> SourceStatsTable::top_by_volume (const std::size_t n) const {
+    std::lock_guard lk (_mu);
+    return top_locked (n, [] (const SourceCounts& c) { return c.total; });
+}
+
+std::vector<SourceStats> SourceStatsTable::top_by_errors (const std::size_t n) const {
+    std::lock_guard lk (_mu);
+    return top_locked (n, [] (const SourceCounts& c) { return c.by_level[0]; });
+}
+
+std::size_t SourceStatsTable::size () const {
+    std::lock_guard lk (_mu);
+    return _entries.size ();
+}
+} // namespace logger
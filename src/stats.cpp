@@ -1,49 +1,480 @@
 #include "logger/stats.hpp"
+
+#include "logger/hash.hpp"
 #include "logger/utils.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <vector>
+
 namespace logger {
+namespace {
+double weighted_avg (const double a, const std::uint64_t na, const double b, const std::uint64_t nb) noexcept {
+    const std::uint64_t n = na + nb;
+    return n == 0 ? 0.0 : (a * static_cast<double> (na) + b * static_cast<double> (nb)) / static_cast<double> (n);
+}
+
+/**
+ * @brief Number of the calling thread, unique among live threads.
+ * @details Taken on first use and handed back at thread exit, so the
+ * lowest numbers stay in use by threads that are still running.
+ */
+class ThreadIndex {
+    public:
+    ThreadIndex () {
+        std::lock_guard lk (mu ());
+        if (free ().empty ()) {
+            _index = next ()++;
+        } else {
+            _index = free ().back ();
+            free ().pop_back ();
+        }
+    }
+
+    ~ThreadIndex () {
+        std::lock_guard lk (mu ());
+        free ().push_back (_index);
+    }
+
+    std::size_t get () const noexcept {
+        return _index;
+    }
+
+    private:
+    static std::mutex& mu () noexcept {
+        static std::mutex m;
+        return m;
+    }
+    static std::vector<std::size_t>& free () noexcept {
+        static std::vector<std::size_t> f;
+        return f;
+    }
+    static std::size_t& next () noexcept {
+        static std::size_t n = 0;
+        return n;
+    }
+
+    std::size_t _index;
+};
+
+std::size_t thread_index () noexcept {
+    thread_local const ThreadIndex index;
+    return index.get ();
+}
+
+/** @brief Raise a register shared between threads to at least @p v. */
+void raise (std::atomic<std::uint8_t>& reg, const std::uint8_t v) noexcept {
+    for (std::uint8_t cur = reg.load (std::memory_order_relaxed);
+    v > cur && !reg.compare_exchange_weak (cur, v, std::memory_order_relaxed);) {
+    }
+}
+
+/** @brief Fold atomic registers into @p into. */
+void read_hll (const std::atomic<std::uint8_t> (&regs)[HyperLogLog::kRegisters], HyperLogLog& into) noexcept {
+    for (std::size_t i = 0; i < HyperLogLog::kRegisters; ++i)
+        into.raise (i, regs[i].load (std::memory_order_relaxed));
+}
+
+/** @brief Fold the template report @p part into @p into. */
+void merge_templates (std::vector<TemplateCount>& into, const std::vector<TemplateCount>& part) {
+    if (part.empty ())
+        return;
+    TopTemplates top;
+    const std::vector<TemplateCount>* lists[]{ &into, &part };
+    for (const auto* list : lists)
+        for (const TemplateCount& t : *list)
+            top.offer (hash_bytes (t.text.data (), t.text.size ()), t.text, t.count, t.error);
+    into = top.top ();
+}
+
+/** @brief Count @p tmpl at level @p l in a lazily allocated per-level summary guarded by @p mu. */
+void offer_template (std::mutex& mu, std::unique_ptr<TopTemplates[]>& top, const int l, const std::uint64_t hash, const std::string_view tmpl) noexcept {
+    std::lock_guard lk (mu);
+    if (!top && !(top = std::unique_ptr<TopTemplates[]> (new (std::nothrow) TopTemplates[3])))
+        return;
+    top[l].offer (hash, tmpl);
+}
+
+/** @brief Add @p v to a counter this thread alone writes (no locked instruction). */
+template <class T> void bump (std::atomic<T>& a, const T v) noexcept {
+    a.store (a.load (std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+} // namespace
+
+LengthQuantiles length_quantiles (const QuantileSketch& sketch, const std::uint64_t min, const std::uint64_t max) noexcept {
+    const auto at = [&] (const double q) { return std::clamp (sketch.quantile (q), min, std::max (min, max)); };
+    LengthQuantiles out;
+    if (sketch.count () == 0)
+        return out;
+    out.p50  = at (0.50);
+    out.p90  = at (0.90);
+    out.p99  = at (0.99);
+    out.p999 = at (0.999);
+    return out;
+}
+
+void merge_snapshot (StatsSnapshot& into, const StatsSnapshot& part) {
+    if (part.total > 0) {
+        // An empty snapshot reports min_len 0, which must not win.
+        into.min_len = into.total == 0 ? part.min_len : std::min (into.min_len, part.min_len);
+        into.max_len = std::max (into.max_len, part.max_len);
+        into.avg_len = weighted_avg (into.avg_len, into.total, part.avg_len, part.total);
+    }
+    into.last_hour_avg_len =
+    weighted_avg (into.last_hour_avg_len, into.last_hour_total, part.last_hour_avg_len, part.last_hour_total);
+    into.total += part.total;
+    into.last_hour_total += part.last_hour_total;
+    for (int i = 0; i < 3; ++i) {
+        into.by_level[i] += part.by_level[i];
+        into.last_hour_by_level[i] += part.last_hour_by_level[i];
+    }
+    if (into.windows.size () < part.windows.size ())
+        into.windows.resize (part.windows.size ());
+    for (std::size_t w = 0; w < part.windows.size (); ++w) {
+        WindowStats& to         = into.windows[w];
+        const WindowStats& from = part.windows[w];
+        to.length               = from.length;
+        to.avg_len              = weighted_avg (to.avg_len, to.total, from.avg_len, from.total);
+        to.total += from.total;
+        for (int i = 0; i < 3; ++i)
+            to.by_level[i] += from.by_level[i];
+        to.msg_hll.merge (from.msg_hll);
+        to.src_hll.merge (from.src_hll);
+        to.distinct_messages = to.msg_hll.estimate ();
+        to.distinct_sources  = to.src_hll.estimate ();
+    }
+    if (into.rates.size () < part.rates.size ())
+        into.rates.resize (part.rates.size ());
+    for (std::size_t r = 0; r < part.rates.size (); ++r) {
+        into.rates[r].horizon = part.rates[r].horizon;
+        for (int i = 0; i < 3; ++i)
+            into.rates[r].per_sec[i] += part.rates[r].per_sec[i];
+    }
+    for (int l = 0; l < 3; ++l) {
+        merge_templates (into.top_templates[l], part.top_templates[l]);
+        merge_templates (into.last_hour_top_templates[l], part.last_hour_top_templates[l]);
+        for (std::size_t w = 0; w < part.windows.size (); ++w)
+            merge_templates (into.windows[w].top_templates[l], part.windows[w].top_templates[l]);
+    }
+    into.len_sketch.merge (part.len_sketch);
+    into.last_hour_len_sketch.merge (part.last_hour_len_sketch);
+    into.len_q           = length_quantiles (into.len_sketch, into.min_len, into.max_len);
+    into.last_hour_len_q = length_quantiles (into.last_hour_len_sketch);
+    into.msg_hll.merge (part.msg_hll);
+    into.src_hll.merge (part.src_hll);
+    into.last_hour_msg_hll.merge (part.last_hour_msg_hll);
+    into.last_hour_src_hll.merge (part.last_hour_src_hll);
+    into.distinct_messages           = into.msg_hll.estimate ();
+    into.distinct_sources            = into.src_hll.estimate ();
+    into.last_hour_distinct_messages = into.last_hour_msg_hll.estimate ();
+    into.last_hour_distinct_sources  = into.last_hour_src_hll.estimate ();
+}
+
+StatsCollector::StatsCollector (const StatsWindow& window) {
+    const auto ms = [] (const std::chrono::milliseconds d) {
+        return static_cast<std::uint64_t> (std::max<std::chrono::milliseconds::rep> (d.count (), 1));
+    };
+    _res_ms            = ms (window.resolution);
+    _len_ms            = std::max (ms (window.length), _res_ms);
+    std::uint64_t span = _len_ms;
+    for (const auto w : window.windows) {
+        _win_ms.push_back (std::max (ms (w), _res_ms));
+        span = std::max (span, _win_ms.back ());
+    }
+    for (const auto h : window.rate_horizons)
+        _rates.push_back (LevelRates{ std::chrono::milliseconds (ms (h)), { 0.0, 0.0, 0.0 } });
+    // One extra bucket: an unaligned window overlaps len / res + 1 of them.
+    // Records up to kMaxLead ahead get slots of their own on top, so they
+    // never push out the ones a window still needs.
+    const std::uint64_t lead = std::min<std::uint64_t> (kMaxLead.count (), span);
+    _nbuckets = static_cast<std::size_t> ((span + _res_ms - 1) / _res_ms + (lead + _res_ms - 1) / _res_ms) + 1;
+    _buckets.reset (new Bucket[_nbuckets]);
+    const auto ring_for = [this] (const std::uint64_t len, const std::size_t window) {
+        for (auto& r : _rings)
+            if (r.len_ms == len) {
+                r.windows.push_back (window);
+                return;
+            }
+        SliceRing& r              = _rings.emplace_back ();
+        const std::uint64_t ahead = std::min<std::uint64_t> (kMaxLead.count (), len);
+        r.len_ms                  = len;
+        r.width_ms                = std::max (_res_ms, (len + kSlices - 1) / kSlices);
+        r.n                       = static_cast<std::size_t> (kSlices + (ahead + r.width_ms - 1) / r.width_ms) + 1;
+        r.slices.reset (new Slice[r.n]);
+        r.windows.push_back (window);
+    };
+    ring_for (_len_ms, 0);
+    for (std::size_t w = 0; w < _win_ms.size (); ++w)
+        ring_for (_win_ms[w], w + 1);
+}
+
 void StatsCollector::add (const std::uint64_t epoch_ms, const LogLevel lvl, const std::size_t msg_len) noexcept {
+    // Each of the first kSlots threads owns a cache-line slot and updates it
+    // with plain relaxed loads and stores; later threads share the overflow
+    // slot through read-modify-writes. snapshot() sums the slots, so adds do
+    // not serialize on the totals.
+    const std::size_t hist = QuantileSketch::index (msg_len);
+    if (const std::size_t t = thread_index (); t < kSlots) {
+        Slot& s = _slots[t];
+        bump<std::uint64_t> (s.total, 1);
+        bump<std::uint64_t> (s.by_level[idx (lvl)], 1);
+        bump<std::uint64_t> (s.sum_len, msg_len);
+        if (msg_len < s.min_len.load (std::memory_order_relaxed))
+            s.min_len.store (msg_len, std::memory_order_relaxed);
+        if (msg_len > s.max_len.load (std::memory_order_relaxed))
+            s.max_len.store (msg_len, std::memory_order_relaxed);
+        bump<std::uint64_t> (s.len_hist[hist], 1);
+    } else {
+        Slot& s = _slots[kSlots];
+        s.total.fetch_add (1, std::memory_order_relaxed);
+        s.by_level[idx (lvl)].fetch_add (1, std::memory_order_relaxed);
+        s.sum_len.fetch_add (msg_len, std::memory_order_relaxed);
+        for (std::size_t cur = s.min_len.load (std::memory_order_relaxed);
+        msg_len < cur && !s.min_len.compare_exchange_weak (cur, msg_len, std::memory_order_relaxed);) {
+        }
+        for (std::size_t cur = s.max_len.load (std::memory_order_relaxed);
+        msg_len > cur && !s.max_len.compare_exchange_weak (cur, msg_len, std::memory_order_relaxed);) {
+        }
+        s.len_hist[hist].fetch_add (1, std::memory_order_relaxed);
+    }
+
+    if (Bucket* b = claim (_buckets.get (), _nbuckets, _res_ms, epoch_ms)) {
+        b->by_level[idx (lvl)].fetch_add (1, std::memory_order_relaxed);
+        b->sum_len.fetch_add (msg_len, std::memory_order_relaxed);
+    }
+    // Every window length has its own slice ring, so a one-minute window is
+    // not cut into the slices of a day-long one; one increment per ring.
+    for (auto& r : _rings)
+        if (Slice* sl = claim (r.slices.get (), r.n, r.width_ms, epoch_ms))
+            sl->len_hist[hist].fetch_add (1, std::memory_order_relaxed);
+}
+
+void StatsCollector::add (const std::uint64_t epoch_ms, const LogLevel lvl, const std::string_view msg, const std::uint64_t source) noexcept {
+    add (epoch_ms, lvl, msg.size ());
+    // A register is only written when the rank goes up, so after warm-up an
+    // update is one relaxed load of a mostly read-only line. The template is
+    // normalized and hashed before any lock: the slot's (uncontended but for
+    // snapshot() and overflow-slot threads) and the slices' cover only the
+    // counter updates. A slice's summary starts over when it is recycled, so
+    // a recent burst is not outranked by history.
+    const std::uint64_t mh = hash_bytes (msg.data (), msg.size ());
+    const std::uint64_t sh = source != 0 ? hash_bytes (&source, sizeof (source)) : 0;
+    raise (_msg_hll[HyperLogLog::index (mh)], HyperLogLog::rank (mh));
+    if (source != 0)
+        raise (_src_hll[HyperLogLog::index (sh)], HyperLogLog::rank (sh));
+
+    char tmpl[kMaxTemplateLen];
+    const std::size_t n   = normalize_template (msg, tmpl, sizeof (tmpl));
+    const std::uint64_t h = hash_bytes (tmpl, n);
+    Slot& s               = _slots[std::min (thread_index (), kSlots)];
+    offer_template (s.top_mu, s.top, idx (lvl), h, std::string_view (tmpl, n));
+    for (auto& r : _rings) {
+        Slice* sl = claim (r.slices.get (), r.n, r.width_ms, epoch_ms);
+        if (!sl)
+            continue;
+        raise (sl->msg_hll[HyperLogLog::index (mh)], HyperLogLog::rank (mh));
+        if (source != 0)
+            raise (sl->src_hll[HyperLogLog::index (sh)], HyperLogLog::rank (sh));
+        offer_template (sl->top_mu, sl->top, idx (lvl), h, std::string_view (tmpl, n));
+    }
+}
+
+void StatsCollector::Bucket::clear () noexcept {
+    for (auto& n : by_level)
+        n.store (0, std::memory_order_relaxed);
+    sum_len.store (0, std::memory_order_relaxed);
+}
+
+void StatsCollector::Slice::clear () noexcept {
+    for (auto& n : len_hist)
+        n.store (0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < HyperLogLog::kRegisters; ++i) {
+        msg_hll[i].store (0, std::memory_order_relaxed);
+        src_hll[i].store (0, std::memory_order_relaxed);
+    }
+    std::lock_guard lk (top_mu);
+    if (top)
+        for (int l = 0; l < 3; ++l)
+            top[l] = TopTemplates{};
+}
+
+void StatsCollector::advance_rates_locked (const std::uint64_t (&totals)[3], const std::uint64_t now_ms) noexcept {
+    // rate = rate * a + (count / dt) * (1 - a) with a = exp(-dt / horizon):
+    // exact for evenly spread arrivals and never looks at history. Rates
+    // follow arrival (not record) time and start from zero.
+    if (_rate_at_ms != 0 && now_ms == _rate_at_ms)
+        return; // no time passed: keep counting from the same baseline
+    if (_rate_at_ms != 0 && now_ms > _rate_at_ms) {
+        const double dt_ms = static_cast<double> (now_ms - _rate_at_ms);
+        for (LevelRates& r : _rates) {
+            const double a = std::exp (-dt_ms / static_cast<double> (r.horizon.count ()));
+            for (int l = 0; l < 3; ++l) {
+                const double seen = static_cast<double> (totals[l] - _rate_base[l]);
+                r.per_sec[l]      = r.per_sec[l] * a + seen * 1000.0 / dt_ms * (1.0 - a);
+            }
+        }
+    }
+    // The next interval starts here (the first call and a clock step back only set the baseline).
+    _rate_at_ms = now_ms;
+    for (int l = 0; l < 3; ++l)
+        _rate_base[l] = totals[l];
+}
+
+template <class T>
+T* StatsCollector::claim (T* ring, const std::size_t n, const std::uint64_t width_ms, const std::uint64_t epoch_ms) noexcept {
+    // Rings are indexed by record time, so their memory is fixed whatever the
+    // rate; only the first record of a new element takes the mutex.
+    const std::uint64_t stamp = epoch_ms / width_ms + 1;
+    T& b                      = ring[stamp % n];
+    if (const std::uint64_t cur = b.stamp.load (std::memory_order_acquire); cur == stamp)
+        return &b;
+    else if (cur > stamp)
+        return nullptr;
     std::lock_guard lk (_mu);
-    _total++;
-    _by_level[idx (lvl)]++;
-    if (_min_len == static_cast<std::size_t> (-1) || msg_len < _min_len)
-        _min_len = msg_len;
-    if (msg_len > _max_len)
-        _max_len = msg_len;
-    _sum_len += static_cast<long double> (msg_len);
-    _window.push_back ({ epoch_ms, lvl, msg_len });
-    _win_total++;
-    _win_by_level[idx (lvl)]++;
-    _win_sum_len += static_cast<long double> (msg_len);
-    prune_older_than (now_epoch_ms () - 3600ull * 1000ull);
-}
-
-void StatsCollector::prune_older_than (const std::uint64_t cutoff_ms) noexcept {
-    while (!_window.empty () && _window.front ().epoch_ms < cutoff_ms) {
-        const auto e = _window.front ();
-        _window.pop_front ();
-        _win_total--;
-        _win_by_level[idx (e.lvl)]--;
-        _win_sum_len -= static_cast<long double> (e.len);
-    }
-}
-
-StatsSnapshot StatsCollector::snapshot (const std::uint64_t now_ms) noexcept {
-    std::lock_guard<std::mutex> lk (_mu);
-    prune_older_than (now_ms - 3600ull * 1000ull);
+    if (const std::uint64_t cur = b.stamp.load (std::memory_order_relaxed); cur == stamp)
+        return &b;
+    else if (cur > stamp)
+        return nullptr;
+    // Only a new element reads the clock. A record from a clock running
+    // ahead would otherwise sit in every window and hold its slot.
+    if (epoch_ms > std::max (_newest_ms, now_epoch_ms ()) + static_cast<std::uint64_t> (kMaxLead.count ()))
+        return nullptr;
+    _newest_ms = std::max (_newest_ms, epoch_ms);
+    // A straggler that saw the old stamp may still land in the fresh element;
+    // that takes a record older than the whole ring racing the recycle.
+    b.clear ();
+    b.stamp.store (stamp, std::memory_order_release);
+    return &b;
+}
+
+StatsSnapshot StatsCollector::snapshot (const std::uint64_t now_ms) {
     StatsSnapshot s;
-    s.total                 = _total;
-    s.by_level[0]           = _by_level[0];
-    s.by_level[1]           = _by_level[1];
-    s.by_level[2]           = _by_level[2];
-    s.min_len               = (_total == 0 ? 0 : _min_len);
-    s.max_len               = _max_len;
-    s.avg_len               = (_total == 0 ? 0.0 : static_cast<double> (_sum_len / static_cast<long double> (_total)));
-    s.last_hour_total       = _win_total;
-    s.last_hour_by_level[0] = _win_by_level[0];
-    s.last_hour_by_level[1] = _win_by_level[1];
-    s.last_hour_by_level[2] = _win_by_level[2];
-    s.last_hour_avg_len = (_win_total == 0 ? 0.0 : static_cast<double> (_win_sum_len / static_cast<long double> (_win_total)));
+    std::uint64_t sum_len = 0;
+    for (const Slot& slot : _slots) {
+        for (std::size_t i = 0; i < QuantileSketch::kBuckets; ++i)
+            if (const std::uint64_t n = slot.len_hist[i].load (std::memory_order_relaxed); n != 0)
+                s.len_sketch.add_bucket (i, n);
+        s.total += slot.total.load (std::memory_order_relaxed);
+        for (int i = 0; i < 3; ++i)
+            s.by_level[i] += slot.by_level[i].load (std::memory_order_relaxed);
+        sum_len += slot.sum_len.load (std::memory_order_relaxed);
+        s.min_len = std::min (s.min_len, slot.min_len.load (std::memory_order_relaxed));
+        s.max_len = std::max (s.max_len, slot.max_len.load (std::memory_order_relaxed));
+    }
+    if (s.total == 0)
+        s.min_len = 0;
+    s.avg_len = (s.total == 0 ? 0.0 : static_cast<double> (sum_len) / static_cast<double> (s.total));
+    s.len_q   = length_quantiles (s.len_sketch, s.min_len, s.max_len);
+    read_hll (_msg_hll, s.msg_hll);
+    read_hll (_src_hll, s.src_hll);
+    s.distinct_messages = s.msg_hll.estimate ();
+    s.distinct_sources  = s.src_hll.estimate ();
+    {
+        TopTemplates top[3];
+        for (Slot& slot : _slots) {
+            std::lock_guard lk (slot.top_mu);
+            if (slot.top)
+                for (int l = 0; l < 3; ++l)
+                    top[l].merge (slot.top[l]);
+        }
+        for (int l = 0; l < 3; ++l)
+            s.top_templates[l] = top[l].top ();
+    }
+
+    // Stamp of the first bucket overlapping [now - len, now].
+    const auto first_of = [&] (const std::uint64_t len) { return (now_ms > len ? (now_ms - len) / _res_ms : 0) + 1; };
+    const std::uint64_t first = first_of (_len_ms);
+    std::uint64_t oldest      = first;
+    std::vector<std::uint64_t> firsts, sums (_win_ms.size (), 0);
+    s.windows.resize (_win_ms.size ());
+    for (std::size_t w = 0; w < _win_ms.size (); ++w) {
+        s.windows[w].length = std::chrono::milliseconds (_win_ms[w]);
+        firsts.push_back (first_of (_win_ms[w]));
+        oldest = std::min (oldest, firsts.back ());
+    }
+    const std::uint64_t last = now_ms / _res_ms + 1; // buckets past "now" are not reported yet
+    std::uint64_t win_sum    = 0;
+    std::lock_guard lk (_mu); // keeps buckets from being recycled meanwhile
+    _newest_ms = std::max (_newest_ms, now_ms);
+    // One pass over the ring serves every window.
+    for (std::size_t i = 0; i < _nbuckets; ++i) {
+        const Bucket& b           = _buckets[i];
+        const std::uint64_t stamp = b.stamp.load (std::memory_order_acquire);
+        if (stamp < oldest || stamp > last)
+            continue;
+        std::uint64_t n[3];
+        for (int l = 0; l < 3; ++l)
+            n[l] = b.by_level[l].load (std::memory_order_relaxed);
+        const std::uint64_t sum = b.sum_len.load (std::memory_order_relaxed);
+        if (stamp >= first) {
+            for (int l = 0; l < 3; ++l)
+                s.last_hour_by_level[l] += n[l];
+            win_sum += sum;
+        }
+        for (std::size_t w = 0; w < firsts.size (); ++w) {
+            if (stamp < firsts[w])
+                continue;
+            for (int l = 0; l < 3; ++l)
+                s.windows[w].by_level[l] += n[l];
+            sums[w] += sum;
+        }
+    }
+    s.last_hour_total   = s.last_hour_by_level[0] + s.last_hour_by_level[1] + s.last_hour_by_level[2];
+    s.last_hour_avg_len = (s.last_hour_total == 0 ? 0.0 : static_cast<double> (win_sum) / static_cast<double> (s.last_hour_total));
+    for (std::size_t w = 0; w < s.windows.size (); ++w) {
+        WindowStats& ws = s.windows[w];
+        ws.total        = ws.by_level[0] + ws.by_level[1] + ws.by_level[2];
+        ws.avg_len      = ws.total == 0 ? 0.0 : static_cast<double> (sums[w]) / static_cast<double> (ws.total);
+    }
+    advance_rates_locked (s.by_level, now_ms);
+    s.rates = _rates;
+
+    // Template summaries of the main window, then of each further one.
+    std::vector<TopTemplates> tops (3 * (1 + _win_ms.size ()));
+    const auto msg_hll_of = [&] (const std::size_t i) -> HyperLogLog& { return i == 0 ? s.last_hour_msg_hll : s.windows[i - 1].msg_hll; };
+    const auto src_hll_of = [&] (const std::size_t i) -> HyperLogLog& { return i == 0 ? s.last_hour_src_hll : s.windows[i - 1].src_hll; };
+    for (auto& r : _rings) {
+        // Stamps of the slices overlapping [now - len, now].
+        const std::uint64_t first = (now_ms > r.len_ms ? (now_ms - r.len_ms) / r.width_ms : 0) + 1;
+        const std::uint64_t last  = now_ms / r.width_ms + 1;
+        // Read into the ring's first window, then copy to the others of the same length.
+        const std::size_t into = r.windows.front ();
+        for (std::size_t i = 0; i < r.n; ++i) {
+            Slice& sl                 = r.slices[i];
+            const std::uint64_t stamp = sl.stamp.load (std::memory_order_acquire);
+            if (stamp < first || stamp > last)
+                continue;
+            std::lock_guard top_lk (sl.top_mu);
+            if (into == 0)
+                for (std::size_t b = 0; b < QuantileSketch::kBuckets; ++b)
+                    if (const std::uint64_t n = sl.len_hist[b].load (std::memory_order_relaxed); n != 0)
+                        s.last_hour_len_sketch.add_bucket (b, n);
+            read_hll (sl.msg_hll, msg_hll_of (into));
+            read_hll (sl.src_hll, src_hll_of (into));
+            for (int l = 0; sl.top && l < 3; ++l)
+                tops[3 * into + l].merge (sl.top[l]);
+        }
+        for (std::size_t k = 1; k < r.windows.size (); ++k) {
+            const std::size_t w = r.windows[k];
+            msg_hll_of (w)      = msg_hll_of (into);
+            src_hll_of (w)      = src_hll_of (into);
+            for (int l = 0; l < 3; ++l)
+                tops[3 * w + l] = tops[3 * into + l];
+        }
+    }
+    s.last_hour_len_q             = length_quantiles (s.last_hour_len_sketch);
+    s.last_hour_distinct_messages = s.last_hour_msg_hll.estimate ();
+    s.last_hour_distinct_sources  = s.last_hour_src_hll.estimate ();
+    for (int l = 0; l < 3; ++l)
+        s.last_hour_top_templates[l] = tops[l].top ();
+    for (std::size_t w = 0; w < s.windows.size (); ++w) {
+        WindowStats& ws      = s.windows[w];
+        ws.distinct_messages = ws.msg_hll.estimate ();
+        ws.distinct_sources  = ws.src_hll.estimate ();
+        for (int l = 0; l < 3; ++l)
+            ws.top_templates[l] = tops[3 * (w + 1) + l].top ();
+    }
     return s;
 }
 } // namespace logger
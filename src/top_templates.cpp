@@ -0,0 +1,207 @@
+#include "logger/top_templates.hpp"
+
+#include "logger/hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace logger {
+namespace {
+enum CharClass : std::uint8_t { kOther, kDigit, kHexLetter, kLetter };
+
+/** @brief Class of every byte value, built at compile time. */
+struct ClassTable {
+    std::uint8_t c[256]{};
+
+    constexpr ClassTable () {
+        for (int i = 0; i < 256; ++i) {
+            if (i >= '0' && i <= '9')
+                c[i] = kDigit;
+            else if ((i >= 'a' && i <= 'f') || (i >= 'A' && i <= 'F'))
+                c[i] = kHexLetter;
+            else if ((i >= 'g' && i <= 'z') || (i >= 'G' && i <= 'Z') || i == '_')
+                c[i] = kLetter;
+        }
+    }
+
+    std::uint8_t operator[] (const char ch) const noexcept {
+        return c[static_cast<unsigned char> (ch)];
+    }
+};
+
+constexpr ClassTable kClass;
+
+/** @brief First ASCII digit in [@p p, @p end), or @p end; eight bytes per step. */
+const char* find_digit (const char* p, const char* end) noexcept {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    constexpr std::uint64_t kOnes = 0x0101010101010101ull;
+    for (; end - p >= 8; p += 8) {
+        std::uint64_t v;
+        std::memcpy (&v, p, sizeof (v));
+        // Digits become bytes below 10; flag those (exact for the lowest flagged byte).
+        const std::uint64_t x = v ^ (kOnes * '0');
+        if (const std::uint64_t hit = (x - kOnes * 10) & ~x & (kOnes * 0x80); hit != 0)
+            return p + (__builtin_ctzll (hit) >> 3);
+    }
+#endif
+    for (; p < end; ++p)
+        if (kClass[*p] == kDigit)
+            return p;
+    return end;
+}
+} // namespace
+
+std::size_t normalize_template (const std::string_view msg, char* out, const std::size_t cap) noexcept {
+    const char* p         = msg.data ();
+    const char* const end = p + std::min (msg.size (), 4 * cap);
+    std::size_t n         = 0;
+    while (p < end && n < cap) {
+        // Text up to the word holding the next digit is copied as is, in bulk.
+        const char* const limit = p + std::min (static_cast<std::size_t> (end - p), cap - n);
+        const char* const digit = find_digit (p, limit);
+        const char* word        = digit;
+        while (digit != limit && word > p && kClass[word[-1]] != kOther)
+            --word;
+        std::memcpy (out + n, p, static_cast<std::size_t> (word - p));
+        n += static_cast<std::size_t> (word - p);
+        p = word;
+        if (digit == limit)
+            break;
+        // Copy the word with digit runs collapsed, then take it back if it was a number.
+        const std::size_t start = n;
+        bool letter             = false;
+        for (std::uint8_t k; p < end && (k = kClass[*p]) != kOther;) {
+            if (k == kDigit) {
+                while (++p < end && kClass[*p] == kDigit) {
+                }
+                if (n < cap)
+                    out[n++] = '#';
+            } else {
+                letter |= k == kLetter;
+                if (n < cap)
+                    out[n++] = *p;
+                ++p;
+            }
+        }
+        // "0x" followed by hex digits counts as one hex number.
+        if (!letter || (p - word > 2 && word[0] == '0' && (word[1] | 0x20) == 'x' &&
+                       std::all_of (word + 2, p, [] (const char ch) { return kClass[ch] != kLetter; }))) {
+            n        = start;
+            out[n++] = '#';
+        }
+    }
+    return n;
+}
+
+void TopTemplates::add (const std::string_view msg) noexcept {
+    char buf[kMaxTemplateLen];
+    const std::size_t n = normalize_template (msg, buf, sizeof (buf));
+    offer (hash_bytes (buf, n), std::string_view (buf, n));
+}
+
+std::size_t TopTemplates::find (const std::uint64_t hash) const noexcept {
+    std::size_t slot = static_cast<std::size_t> (hash) & (kIndexSize - 1);
+    for (; _index[slot] != 0 && _c[_index[slot] - 1].hash != hash; slot = (slot + 1) & (kIndexSize - 1)) {
+    }
+    return slot;
+}
+
+void TopTemplates::unindex (std::size_t slot) noexcept {
+    // Backward-shift deletion: pull up every later entry of the probe run
+    // that would no longer be reachable across the hole.
+    for (std::size_t next = (slot + 1) & (kIndexSize - 1); _index[next] != 0; next = (next + 1) & (kIndexSize - 1)) {
+        const std::size_t home = static_cast<std::size_t> (_c[_index[next] - 1].hash) & (kIndexSize - 1);
+        if (((next - home) & (kIndexSize - 1)) >= ((next - slot) & (kIndexSize - 1))) {
+            _index[slot] = _index[next];
+            slot         = next;
+        }
+    }
+    _index[slot] = 0;
+}
+
+void TopTemplates::sift_down (std::size_t i) noexcept {
+    for (;;) {
+        const std::size_t l = 2 * i + 1, r = l + 1;
+        std::size_t least   = i;
+        if (l < _size && _c[_heap[l]].count < _c[_heap[least]].count)
+            least = l;
+        if (r < _size && _c[_heap[r]].count < _c[_heap[least]].count)
+            least = r;
+        if (least == i)
+            return;
+        std::swap (_heap[i], _heap[least]);
+        _pos[_heap[i]]     = static_cast<std::uint8_t> (i);
+        _pos[_heap[least]] = static_cast<std::uint8_t> (least);
+        i                  = least;
+    }
+}
+
+void TopTemplates::sift_up (std::size_t i) noexcept {
+    for (; i > 0 && _c[_heap[i]].count < _c[_heap[(i - 1) / 2]].count; i = (i - 1) / 2) {
+        const std::size_t parent = (i - 1) / 2;
+        std::swap (_heap[i], _heap[parent]);
+        _pos[_heap[i]]      = static_cast<std::uint8_t> (i);
+        _pos[_heap[parent]] = static_cast<std::uint8_t> (parent);
+    }
+}
+
+void TopTemplates::offer (const std::uint64_t hash, const std::string_view tmpl, const std::uint64_t weight, const std::uint64_t error) noexcept {
+    _total += weight;
+    std::size_t slot = find (hash);
+    if (_index[slot] != 0) {
+        const std::size_t c = _index[slot] - 1;
+        _c[c].count += weight;
+        _c[c].error += error;
+        sift_down (_pos[c]);
+        return;
+    }
+    std::size_t c;
+    std::uint64_t base = 0;
+    const bool evict   = _size == kCapacity;
+    if (!evict) {
+        c        = _size++;
+        _heap[c] = static_cast<std::uint8_t> (c);
+        _pos[c]  = static_cast<std::uint8_t> (c);
+    } else {
+        // Evict the smallest counter; the newcomer may have been among its count.
+        c    = _heap[0];
+        base = _c[c].count;
+        unindex (find (_c[c].hash));
+        slot = find (hash);
+    }
+    Counter& k = _c[c];
+    k.hash     = hash;
+    k.count    = base + weight;
+    k.error    = base + error;
+    k.len      = static_cast<std::uint8_t> (std::min (tmpl.size (), kMaxTemplateLen));
+    std::memcpy (k.text, tmpl.data (), k.len);
+    _index[slot] = static_cast<std::uint8_t> (c + 1);
+    if (evict)
+        sift_down (_pos[c]);
+    else
+        sift_up (_pos[c]);
+}
+
+void TopTemplates::merge (const TopTemplates& other) noexcept {
+    const std::uint64_t total = _total + other._total;
+    for (std::size_t i = 0; i < other._size; ++i) {
+        const Counter& k = other._c[i];
+        offer (k.hash, std::string_view (k.text, k.len), k.count, k.error);
+    }
+    // The offered counts include overestimates; the other side's total does not.
+    _total = total;
+}
+
+std::vector<TemplateCount> TopTemplates::top (const std::size_t k) const {
+    std::vector<TemplateCount> out;
+    out.reserve (_size);
+    for (std::size_t i = 0; i < _size; ++i)
+        out.push_back (TemplateCount{ std::string (_c[i].text, _c[i].len), _c[i].count, _c[i].error });
+    std::sort (out.begin (), out.end (), [] (const TemplateCount& a, const TemplateCount& b) {
+        return a.count != b.count ? a.count > b.count : a.text < b.text;
+    });
+    if (out.size () > k)
+        out.resize (k);
+    return out;
+}
+} // namespace logger
@@ -3,7 +3,7 @@
 #include <cctype>
 #include <chrono>
 #include <cstdint>
-#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <string>
 #include <string_view>
@@ -14,17 +14,89 @@ std::uint64_t now_epoch_ms () noexcept {
     return duration_cast<milliseconds> (system_clock::now ().time_since_epoch ()).count ();
 }
 
-std::string iso8601_utc (const std::uint64_t epoch_ms) noexcept {
+namespace {
+void put2 (char* p, const int v) noexcept {
+    p[0] = static_cast<char> ('0' + v / 10);
+    p[1] = static_cast<char> ('0' + v % 10);
+}
+} // namespace
+
+std::size_t format_iso8601_utc (const std::uint64_t epoch_ms, char* out) noexcept {
     const auto tt = static_cast<std::time_t> (epoch_ms / 1000ull);
     std::tm tm{};
-    if (gmtime_r (&tt, &tm) == nullptr)
-        return "1970-01-01T00:00:00Z";
-    char buf[21];
-    const int n = std::snprintf (buf, sizeof (buf), "%04d-%02d-%02dT%02d:%02d:%02dZ", tm.tm_year + 1900, tm.tm_mon + 1,
-    tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-    if (n != 20)
-        return "1970-01-01T00:00:00Z";
-    return std::string{ buf, 20 };
+    if (gmtime_r (&tt, &tm) == nullptr || tm.tm_year + 1900 > 9999 || tm.tm_year + 1900 < 0) {
+        std::memcpy (out, "1970-01-01T00:00:00Z", kIso8601Len);
+        return kIso8601Len;
+    }
+    const int year = tm.tm_year + 1900;
+    put2 (out, year / 100);
+    put2 (out + 2, year % 100);
+    out[4] = '-';
+    put2 (out + 5, tm.tm_mon + 1);
+    out[7] = '-';
+    put2 (out + 8, tm.tm_mday);
+    out[10] = 'T';
+    put2 (out + 11, tm.tm_hour);
+    out[13] = ':';
+    put2 (out + 14, tm.tm_min);
+    out[16] = ':';
+    put2 (out + 17, tm.tm_sec);
+    out[19] = 'Z';
+    return kIso8601Len;
+}
+
+void TimestampFormatter::update_second (const std::uint64_t sec) noexcept {
+    const std::uint64_t day = sec / 86400ull;
+    if (day != _day) {
+        char full[kIso8601Len];
+        format_iso8601_utc (day * 86400ull * 1000ull, full);
+        std::memcpy (_prefix, full, 11); // "YYYY-MM-DDT"
+        _prefix[13] = ':';
+        _prefix[16] = ':';
+        _day        = day;
+    }
+    const auto sod = static_cast<int> (sec - day * 86400ull);
+    put2 (_prefix + 11, sod / 3600);
+    put2 (_prefix + 14, sod / 60 % 60);
+    put2 (_prefix + 17, sod % 60);
+    _sec = sec;
+}
+
+std::size_t TimestampFormatter::format_us (const std::uint64_t epoch_us, char* out) noexcept {
+    const std::uint64_t sec = epoch_us / 1000000ull;
+    if (sec != _sec)
+        update_second (sec);
+    std::memcpy (out, _prefix, sizeof (_prefix));
+    char* p    = out + sizeof (_prefix);
+    int digits = 0;
+    auto frac  = static_cast<std::uint32_t> (epoch_us % 1000000ull);
+    switch (_precision) {
+    case TimePrecision::Seconds: break;
+    case TimePrecision::Millis:
+        digits = 3;
+        frac /= 1000u;
+        break;
+    case TimePrecision::Micros: digits = 6; break;
+    }
+    if (digits > 0) {
+        *p++ = '.';
+        for (int i = digits - 1; i >= 0; --i) {
+            p[i] = static_cast<char> ('0' + frac % 10u);
+            frac /= 10u;
+        }
+        p += digits;
+    }
+    *p++ = 'Z';
+    return static_cast<std::size_t> (p - out);
+}
+
+std::size_t TimestampFormatter::format (const std::uint64_t epoch_ms, char* out) noexcept {
+    return format_us (epoch_ms * 1000ull, out);
+}
+
+std::string iso8601_utc (const std::uint64_t epoch_ms) noexcept {
+    char buf[kIso8601Len];
+    return std::string{ buf, format_iso8601_utc (epoch_ms, buf) };
 }
 
 bool split_host_port (std::string_view in, std::string& host, std::uint16_t& port) noexcept {
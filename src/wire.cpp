@@ -0,0 +1,175 @@
+#include "logger/wire.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstring>
+
+#ifdef LOGGER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace logger {
+namespace wire {
+namespace {
+#ifndef LOGGER_HAVE_ZLIB
+constexpr std::array<std::uint32_t, 256> make_crc_table () noexcept {
+    std::array<std::uint32_t, 256> t{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[i] = c;
+    }
+    return t;
+}
+constexpr auto kCrcTable = make_crc_table ();
+#endif
+
+std::uint32_t load_u32 (const char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy (&v, p, sizeof (v));
+    return v;
+}
+} // namespace
+
+void put_varint (std::string& out, const std::uint64_t v) {
+    char tmp[kMaxVarintBytes];
+    out.append (tmp, put_varint (tmp, v));
+}
+
+std::size_t put_varint (char* out, std::uint64_t v) noexcept {
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = static_cast<char> (v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = static_cast<char> (v);
+    return n;
+}
+
+Decode get_varint (std::string_view& in, std::uint64_t& v) noexcept {
+    v = 0;
+    for (std::size_t i = 0; i < kMaxVarintBytes; ++i) {
+        if (i == in.size ())
+            return Decode::NeedMore;
+        const auto b = static_cast<unsigned char> (in[i]);
+        v |= static_cast<std::uint64_t> (b & 0x7f) << (7 * i);
+        if ((b & 0x80) == 0) {
+            in.remove_prefix (i + 1);
+            return Decode::Ok;
+        }
+    }
+    return Decode::Corrupt;
+}
+
+std::uint32_t crc32 (const char* data, const std::size_t n, const std::uint32_t crc) noexcept {
+#ifdef LOGGER_HAVE_ZLIB
+    return static_cast<std::uint32_t> (
+    ::crc32_z (crc, reinterpret_cast<const Bytef*> (data), static_cast<z_size_t> (n)));
+#else
+    std::uint32_t c = ~crc;
+    for (std::size_t i = 0; i < n; ++i)
+        c = kCrcTable[(c ^ static_cast<unsigned char> (data[i])) & 0xff] ^ (c >> 8);
+    return ~c;
+#endif
+}
+
+void append_record (std::string& out, const std::uint64_t epoch_ms, const LogLevel level, std::string_view msg) {
+    msg = msg.substr (0, kMaxMessageBytes);
+    char head[kMaxVarintBytes + kRecordFixedBytes];
+    std::size_t n = put_varint (head, msg.size ());
+    std::memcpy (head + n, &epoch_ms, 8);
+    head[n + 8] = static_cast<char> (level);
+    out.append (head, n + kRecordFixedBytes);
+    out.append (msg);
+}
+
+std::size_t block_header (char* out, const std::size_t body_len, const bool crc) noexcept {
+    const std::size_t n = put_varint (out, body_len);
+    out[n]              = static_cast<char> (crc ? kFlagCrc : 0);
+    return n + 1;
+}
+
+Decode next_block (std::string_view in, std::string_view& body, std::size_t& consumed) noexcept {
+    const std::size_t total = in.size ();
+    std::uint64_t len       = 0;
+    if (const Decode d = get_varint (in, len); d != Decode::Ok)
+        return d;
+    if (len > kMaxBlockBytes)
+        return Decode::Corrupt;
+    if (in.empty ())
+        return Decode::NeedMore;
+    const auto flags = static_cast<std::uint8_t> (in[0]);
+    if ((flags & ~kFlagCrc) != 0)
+        return Decode::Corrupt;
+    const std::size_t trailer = (flags & kFlagCrc) ? 4 : 0;
+    if (in.size () < 1 + len + trailer)
+        return Decode::NeedMore;
+    body = in.substr (1, static_cast<std::size_t> (len));
+    if (trailer != 0 && crc32 (body.data (), body.size ()) != load_u32 (body.data () + body.size ()))
+        return Decode::Corrupt;
+    consumed = total - in.size () + 1 + body.size () + trailer;
+    return Decode::Ok;
+}
+
+Decode next_record (std::string_view& body, RecordView& out) noexcept {
+    std::string_view in = body;
+    std::uint64_t len   = 0;
+    if (const Decode d = get_varint (in, len); d != Decode::Ok)
+        return d;
+    if (in.size () < kRecordFixedBytes)
+        return Decode::NeedMore;
+    const auto level = static_cast<std::uint8_t> (in[8]);
+    if (level > static_cast<std::uint8_t> (LogLevel::Info))
+        return Decode::Corrupt;
+    if (in.size () - kRecordFixedBytes < len)
+        return Decode::NeedMore;
+    std::memcpy (&out.epoch_ms, in.data (), 8);
+    out.level   = static_cast<LogLevel> (level);
+    out.message = in.substr (kRecordFixedBytes, static_cast<std::size_t> (len));
+    body        = in.substr (kRecordFixedBytes + out.message.size ());
+    return Decode::Ok;
+}
+
+std::size_t record_size (std::string_view records) noexcept {
+    const std::size_t total = records.size ();
+    std::uint64_t len       = 0;
+    if (get_varint (records, len) != Decode::Ok || records.size () < kRecordFixedBytes ||
+    static_cast<std::uint8_t> (records[8]) > static_cast<std::uint8_t> (LogLevel::Info))
+        return 0;
+    return total - records.size () + kRecordFixedBytes + static_cast<std::size_t> (len);
+}
+
+std::size_t whole_records (const std::string_view records, const std::size_t len) noexcept {
+    std::size_t pos = 0;
+    while (pos < len) {
+        const std::size_t n = record_size (records.substr (pos));
+        if (n == 0 || pos + n > len)
+            break;
+        pos += n;
+    }
+    return pos;
+}
+
+bool append_as_text (std::string& out, std::string_view records) {
+    RecordView r;
+    while (!records.empty ()) {
+        if (next_record (records, r) != Decode::Ok)
+            return false;
+        char digits[20];
+        const auto res = std::to_chars (digits, digits + sizeof (digits), r.epoch_ms);
+        out.append (digits, res.ptr);
+        out += '|';
+        out += to_string (r.level);
+        out += '|';
+        const std::size_t at = out.size ();
+        out += r.message;
+        for (std::size_t i = at; i < out.size (); ++i)
+            if (out[i] == '\n')
+                out[i] = ' ';
+        out += '\n';
+    }
+    return true;
+}
+} // namespace wire
+} // namespace logger
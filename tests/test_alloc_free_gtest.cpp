@@ -0,0 +1,104 @@
+#include "logger/file_sink.hpp"
+#include "logger/logger.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <new>
+#include <string>
+#include <thread>
+
+using namespace logger;
+namespace fs = std::filesystem;
+
+namespace {
+std::atomic<std::size_t> g_allocs{ 0 };
+} // namespace
+
+// Counting replacements for the whole test binary; only deltas matter.
+void* operator new (std::size_t n) {
+    g_allocs.fetch_add (1, std::memory_order_relaxed);
+    if (void* p = std::malloc (n == 0 ? 1 : n))
+        return p;
+    throw std::bad_alloc ();
+}
+void* operator new[] (std::size_t n) {
+    return operator new (n);
+}
+void operator delete (void* p) noexcept {
+    std::free (p);
+}
+void operator delete[] (void* p) noexcept {
+    std::free (p);
+}
+void operator delete (void* p, std::size_t) noexcept {
+    std::free (p);
+}
+void operator delete[] (void* p, std::size_t) noexcept {
+    std::free (p);
+}
+
+TEST (AllocFree, FileSinkSyncPathDoesNotAllocate) {
+    const fs::path tmp = fs::temp_directory_path () / "logger_alloc_free.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    Logger L (make_file_sink (tmp.string ()), LogLevel::Warning);
+    const std::string msg (200, 'x');
+    ASSERT_EQ (L.log (LogLevel::Error, msg), Status::Ok); // warm up stream buffers
+
+    const std::size_t before = g_allocs.load ();
+    for (int i = 0; i < 1000; ++i) {
+        L.log (LogLevel::Warning, msg);
+        L.log (LogLevel::Info, "filtered");
+    }
+    const std::size_t after = g_allocs.load ();
+    L.flush ();
+
+    EXPECT_EQ (after - before, 0u);
+}
+
+namespace {
+/** @brief Sink that holds the worker until released, then discards. */
+class GatedSink final : public ILogSink {
+    public:
+    GatedSink (std::atomic<bool>& entered, std::atomic<bool>& gate) : _entered (entered), _gate (gate) {
+    }
+
+    bool write (const LogEntry&, std::string&) noexcept override {
+        _entered.store (true);
+        while (!_gate.load ())
+            std::this_thread::yield ();
+        return true;
+    }
+
+    private:
+    std::atomic<bool>& _entered;
+    std::atomic<bool>& _gate;
+};
+} // namespace
+
+TEST (AllocFree, AsyncDropOldestOverflowDoesNotAllocate) {
+    std::atomic<bool> entered{ false }, gate{ false };
+    AsyncOptions opts;
+    opts.capacity        = 4;
+    opts.overflow        = OverflowPolicy::DropOldest;
+    opts.message_reserve = 256;
+    AsyncLogger L (std::make_unique<GatedSink> (entered, gate), LogLevel::Info, opts);
+    const std::string msg (200, 'x');
+    L.log (LogLevel::Info, msg);
+    while (!entered.load ()) // the worker pops nothing more until released
+        std::this_thread::yield ();
+    for (int i = 0; i < 16; ++i) // regrow the buffers the worker swapped out
+        L.log (LogLevel::Info, msg);
+
+    const std::size_t before = g_allocs.load ();
+    for (int i = 0; i < 1000; ++i)
+        L.log (LogLevel::Info, msg);
+    const std::size_t after = g_allocs.load ();
+    gate.store (true);
+    L.stop ();
+
+    EXPECT_EQ (after - before, 0u);
+    EXPECT_GT (L.counters ().dropped_oldest, 900u);
+}
@@ -0,0 +1,184 @@
+#include "logger/log_sink.hpp"
+#include "logger/logger.hpp"
+#include "logger/mpsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace logger;
+
+namespace {
+class MemorySink final : public ILogSink {
+    public:
+    explicit MemorySink (std::atomic<bool>* gate = nullptr) : _gate (gate) {
+    }
+
+    bool write (const LogEntry& e, std::string&) noexcept override {
+        while (_gate && !_gate->load ())
+            std::this_thread::yield ();
+        std::lock_guard lk (_mu);
+        _lines.push_back (e.message);
+        return true;
+    }
+
+    std::vector<std::string> lines () {
+        std::lock_guard lk (_mu);
+        return _lines;
+    }
+
+    private:
+    std::atomic<bool>* _gate;
+    std::mutex _mu;
+    std::vector<std::string> _lines;
+};
+} // namespace
+
+TEST (MpscRing, PushPopFifoAndFull) {
+    MpscRing ring (3);
+    ASSERT_EQ (ring.capacity (), 4u);
+    EXPECT_TRUE (ring.empty ());
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE (ring.try_push (i, LogLevel::Info, std::to_string (i)));
+    EXPECT_FALSE (ring.try_push (9, LogLevel::Info, "overflow"));
+
+    LogEntry e;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE (ring.try_pop (e));
+        EXPECT_EQ (e.epoch_ms, static_cast<std::uint64_t> (i));
+        EXPECT_EQ (e.message, std::to_string (i));
+    }
+    EXPECT_FALSE (ring.try_pop (e));
+    EXPECT_TRUE (ring.empty ());
+}
+
+TEST (MpscRing, DropSkipsOldest) {
+    MpscRing ring (2);
+    EXPECT_FALSE (ring.try_drop ());
+    ASSERT_TRUE (ring.try_push (1, LogLevel::Info, "a"));
+    ASSERT_TRUE (ring.try_push (2, LogLevel::Info, "b"));
+    EXPECT_TRUE (ring.try_drop ());
+    ASSERT_TRUE (ring.try_push (3, LogLevel::Info, "c"));
+
+    LogEntry e;
+    ASSERT_TRUE (ring.try_pop (e));
+    EXPECT_EQ (e.message, "b");
+    ASSERT_TRUE (ring.try_pop (e));
+    EXPECT_EQ (e.message, "c");
+    EXPECT_TRUE (ring.empty ());
+}
+
+TEST (AsyncLogger, MultipleProducersAllWritten) {
+    auto sink  = std::make_unique<MemorySink> ();
+    auto* view = sink.get ();
+    AsyncOptions opts;
+    opts.capacity = 64;
+    AsyncLogger L (std::move (sink), LogLevel::Info, opts);
+
+    constexpr int threads    = 4;
+    constexpr int per_thread = 500;
+    std::vector<std::thread> th;
+    for (int t = 0; t < threads; ++t) {
+        th.emplace_back ([&, t] {
+            for (int i = 0; i < per_thread; ++i)
+                EXPECT_EQ (L.log (LogLevel::Info, "msg " + std::to_string (t) + "-" + std::to_string (i)), Status::Ok);
+        });
+    }
+    for (auto& x : th)
+        x.join ();
+    L.flush ();
+
+    EXPECT_EQ (view->lines ().size (), static_cast<size_t> (threads * per_thread));
+    const auto c = L.counters ();
+    EXPECT_EQ (c.enqueued, static_cast<std::uint64_t> (threads * per_thread));
+    EXPECT_EQ (c.written, c.enqueued);
+    EXPECT_EQ (c.dropped_newest + c.dropped_oldest, 0u);
+}
+
+TEST (AsyncLogger, FilteredByDefaultLevel) {
+    AsyncLogger L (std::make_unique<MemorySink> (), LogLevel::Warning);
+    EXPECT_EQ (L.log (LogLevel::Info, "no"), Status::Filtered);
+    EXPECT_EQ (L.log (LogLevel::Error, "yes"), Status::Ok);
+}
+
+TEST (AsyncLogger, DropNewestWhenFull) {
+    std::atomic<bool> gate{ false };
+    auto sink  = std::make_unique<MemorySink> (&gate);
+    auto* view = sink.get ();
+    AsyncOptions opts;
+    opts.capacity = 4;
+    opts.overflow = OverflowPolicy::DropNewest;
+    AsyncLogger L (std::move (sink), LogLevel::Info, opts);
+
+    int dropped = 0;
+    for (int i = 0; i < 100; ++i)
+        if (L.log (LogLevel::Info, std::to_string (i)) == Status::Dropped)
+            ++dropped;
+    gate.store (true);
+    L.flush ();
+
+    const auto c = L.counters ();
+    EXPECT_GT (dropped, 0);
+    EXPECT_EQ (c.dropped_newest, static_cast<std::uint64_t> (dropped));
+    EXPECT_EQ (c.written + c.dropped_newest, 100u);
+    EXPECT_EQ (view->lines ().front (), "0");
+}
+
+TEST (AsyncLogger, DropOldestKeepsNewest) {
+    std::atomic<bool> gate{ false };
+    auto sink  = std::make_unique<MemorySink> (&gate);
+    auto* view = sink.get ();
+    AsyncOptions opts;
+    opts.capacity = 4;
+    opts.overflow = OverflowPolicy::DropOldest;
+    AsyncLogger L (std::move (sink), LogLevel::Info, opts);
+
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ (L.log (LogLevel::Info, std::to_string (i)), Status::Ok);
+    gate.store (true);
+    L.flush ();
+
+    const auto c = L.counters ();
+    EXPECT_GT (c.dropped_oldest, 0u);
+    EXPECT_EQ (c.written + c.dropped_oldest, 100u);
+    EXPECT_EQ (view->lines ().back (), "99");
+}
+
+TEST (AsyncLogger, LogAfterStopIsDropped) {
+    AsyncLogger L (std::make_unique<MemorySink> (), LogLevel::Info);
+    L.stop ();
+    EXPECT_EQ (L.log (LogLevel::Error, "late"), Status::Dropped);
+}
+
+TEST (AsyncLogger, StopReleasesBlockedProducersAndWritesEveryQueuedRecord) {
+    std::atomic<bool> gate{ false };
+    auto sink  = std::make_unique<MemorySink> (&gate);
+    auto* view = sink.get ();
+    AsyncOptions opts;
+    opts.capacity = 2;
+    opts.overflow = OverflowPolicy::Block;
+    AsyncLogger L (std::move (sink), LogLevel::Info, opts);
+
+    std::atomic<int> attempts{ 0 };
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 3; ++t)
+        producers.emplace_back ([&] {
+            for (int i = 0; attempts.fetch_add (1), L.log (LogLevel::Info, std::to_string (i)) == Status::Ok; ++i) {
+            }
+        });
+    std::this_thread::sleep_for (std::chrono::milliseconds (50)); // ring full, producers parked
+    std::thread stopper ([&] { L.stop (); });
+    std::this_thread::sleep_for (std::chrono::milliseconds (20));
+    gate.store (true);
+    stopper.join ();
+    for (auto& p : producers)
+        p.join ();
+
+    const auto c = L.counters ();
+    EXPECT_EQ (c.written, c.enqueued);
+    EXPECT_EQ (view->lines ().size (), c.written);
+    EXPECT_EQ (c.enqueued + c.dropped_newest, static_cast<std::uint64_t> (attempts.load ()));
+}
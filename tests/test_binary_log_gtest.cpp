@@ -0,0 +1,108 @@
+#include "logger/binary_log.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace logger;
+namespace fs = std::filesystem;
+
+static std::vector<std::string> decode_lines (const fs::path& p, bool& ok, std::string& err) {
+    std::ifstream in (p, std::ios::binary);
+    std::ostringstream out;
+    ok = decode_binary_log (in, out, err);
+    std::vector<std::string> lines;
+    std::istringstream iss (out.str ());
+    for (std::string l; std::getline (iss, l);)
+        lines.push_back (l);
+    return lines;
+}
+
+TEST (BinaryLog, RoundTripMatchesFileSinkFormat) {
+    const fs::path tmp = fs::temp_directory_path () / "logger_binary_roundtrip.bin";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+    {
+        BinaryLogger B (tmp.string (), LogLevel::Warning);
+        ASSERT_TRUE (B.is_open ());
+        for (int i = 0; i < 3; ++i)
+            EXPECT_EQ (LOGGER_BIN (B, LogLevel::Error, "req {} took {} ms via {}", i, 1.5, std::string ("db")), Status::Ok);
+        EXPECT_EQ (LOGGER_BIN (B, LogLevel::Warning, "plain text"), Status::Ok);
+        EXPECT_EQ (LOGGER_BIN (B, LogLevel::Info, "filtered {}", 1), Status::Filtered);
+        const std::uint64_t big = 18446744073709551615ull;
+        EXPECT_EQ (LOGGER_BIN (B, LogLevel::Error, "u={} i={} c={} b={}", big, -7, 'x', true), Status::Ok);
+    }
+
+    bool ok = false;
+    std::string err;
+    const auto lines = decode_lines (tmp, ok, err);
+    ASSERT_TRUE (ok) << err;
+    ASSERT_EQ (lines.size (), 5u);
+    const std::regex re (R"(^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}Z (ERROR|WARN|INFO) .*$)");
+    for (const auto& l : lines)
+        EXPECT_TRUE (std::regex_match (l, re)) << l;
+    EXPECT_EQ (lines[0].substr (21), "ERROR req 0 took 1.5 ms via db");
+    EXPECT_EQ (lines[2].substr (21), "ERROR req 2 took 1.5 ms via db");
+    EXPECT_EQ (lines[3].substr (21), "WARN plain text");
+    EXPECT_EQ (lines[4].substr (21), "ERROR u=18446744073709551615 i=-7 c=x b=1");
+}
+
+TEST (BinaryLog, AppendAcrossLoggersRedefinesFormats) {
+    const fs::path tmp = fs::temp_directory_path () / "logger_binary_append.bin";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+    for (int run = 0; run < 2; ++run) {
+        BinaryLogger B (tmp.string (), LogLevel::Info);
+        LOGGER_BIN (B, LogLevel::Info, "run {}", run);
+    }
+    bool ok = false;
+    std::string err;
+    const auto lines = decode_lines (tmp, ok, err);
+    ASSERT_TRUE (ok) << err;
+    ASSERT_EQ (lines.size (), 2u);
+    EXPECT_EQ (lines[1].substr (21), "INFO run 1");
+}
+
+TEST (BinaryLog, DecodeRejectsTextAndTruncation) {
+    std::istringstream text ("2024-01-01T00:00:00Z INFO hi\n");
+    std::ostringstream out;
+    std::string err;
+    EXPECT_FALSE (decode_binary_log (text, out, err));
+    EXPECT_NE (err.find ("magic"), std::string::npos);
+
+    const fs::path tmp = fs::temp_directory_path () / "logger_binary_trunc.bin";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+    {
+        BinaryLogger B (tmp.string (), LogLevel::Info);
+        LOGGER_BIN (B, LogLevel::Info, "a {}", 1);
+        LOGGER_BIN (B, LogLevel::Info, "a {}", 2);
+    }
+    fs::resize_file (tmp, fs::file_size (tmp) - 3);
+    bool ok = true;
+    const auto lines = decode_lines (tmp, ok, err);
+    EXPECT_FALSE (ok);
+    EXPECT_EQ (lines.size (), 1u);
+}
+
+TEST (BinaryLog, UnregisteredFormatTravelsWithTheRecord) {
+    const fs::path tmp = fs::temp_directory_path () / "logger_binary_unregistered.bin";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+    {
+        BinaryLogger B (tmp.string (), LogLevel::Info);
+        // What log_static writes when the format table cannot grow.
+        EXPECT_EQ (B.log (LogLevel::Warning, binlog::kUnregistered, std::string_view ("slow {} ms"), 42), Status::Ok);
+        LOGGER_BIN (B, LogLevel::Info, "after {}", 1);
+    }
+    bool ok = false;
+    std::string err;
+    const auto lines = decode_lines (tmp, ok, err);
+    ASSERT_TRUE (ok) << err;
+    ASSERT_EQ (lines.size (), 2u);
+    EXPECT_EQ (lines[0].substr (21), "WARN slow 42 ms");
+    EXPECT_EQ (lines[1].substr (21), "INFO after 1");
+}
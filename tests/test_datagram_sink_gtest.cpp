@@ -0,0 +1,149 @@
+#include "logger/datagram_sink.hpp"
+#include "logger/log_level.hpp"
+#include "logger/logger.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace logger;
+
+static std::vector<std::string> recv_datagrams (const int fd, const std::size_t want) {
+    timeval tv{};
+    tv.tv_sec = 2;
+    setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    std::vector<std::string> out;
+    std::vector<char> buf (DatagramSink::kMaxDatagram + 1);
+    while (out.size () < want) {
+        const ssize_t n = ::recv (fd, buf.data (), buf.size (), 0);
+        if (n <= 0)
+            break;
+        out.emplace_back (buf.data (), static_cast<std::size_t> (n));
+    }
+    return out;
+}
+
+static std::vector<LogEntry> numbered_entries (const std::size_t n) {
+    std::vector<LogEntry> batch (n);
+    for (std::size_t i = 0; i < n; ++i) {
+        batch[i].epoch_ms = 1000 + i;
+        batch[i].level    = LogLevel::Warning;
+        batch[i].message  = "d" + std::to_string (i);
+    }
+    return batch;
+}
+
+TEST (DatagramSink, UdpBatchIsOneDatagramPerRecord) {
+    const int rfd = ::socket (AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE (rfd, 0);
+    int rcvbuf = 1 << 20;
+    setsockopt (rfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    ASSERT_EQ (bind (rfd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)), 0);
+    socklen_t len = sizeof (addr);
+    ASSERT_EQ (getsockname (rfd, reinterpret_cast<sockaddr*> (&addr), &len), 0);
+
+    auto sink        = make_udp_sink ("127.0.0.1", ntohs (addr.sin_port));
+    const auto batch = numbered_entries (200);
+    std::string err;
+    ASSERT_EQ (sink->write_batch (batch.data (), batch.size (), err), batch.size ()) << err;
+
+    const auto got = recv_datagrams (rfd, batch.size ());
+    ASSERT_EQ (got.size (), batch.size ());
+    for (std::size_t i = 0; i < got.size (); ++i)
+        EXPECT_EQ (got[i], std::to_string (1000 + i) + "|WARN|d" + std::to_string (i) + "\n");
+    close (rfd);
+}
+
+TEST (DatagramSink, UnixDatagramWriteAndBatch) {
+    const std::string path = ::testing::TempDir () + "logger_dgram.sock";
+    ::unlink (path.c_str ());
+    const int rfd = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE (rfd, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    ASSERT_LT (path.size (), sizeof (addr.sun_path));
+    path.copy (addr.sun_path, path.size ());
+    ASSERT_EQ (bind (rfd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)), 0);
+
+    // The receiver queue is tiny, so the sender waits for it.
+    std::vector<std::string> got;
+    std::thread receiver ([&] { got = recv_datagrams (rfd, 101); });
+    DatagramSink sink (UnixPath{ path });
+    std::string err;
+    LogEntry e;
+    e.epoch_ms = 7;
+    e.message  = "single";
+    EXPECT_TRUE (sink.write (e, err)) << err;
+    const auto batch = numbered_entries (100);
+    EXPECT_EQ (sink.write_batch (batch.data (), batch.size (), err), batch.size ()) << err;
+    receiver.join ();
+
+    ASSERT_EQ (got.size (), 101u);
+    EXPECT_EQ (got[0], "7|INFO|single\n");
+    EXPECT_EQ (got[100], "1099|WARN|d99\n");
+    close (rfd);
+    ::unlink (path.c_str ());
+}
+
+TEST (DatagramSink, StalledUnixReceiverDoesNotBlockForever) {
+    const std::string path = ::testing::TempDir () + "logger_dgram_stalled.sock";
+    ::unlink (path.c_str ());
+    const int rfd = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE (rfd, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    path.copy (addr.sun_path, path.size ());
+    ASSERT_EQ (bind (rfd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)), 0);
+
+    // Nobody reads: the queue fills and the rest of the batch is dropped.
+    DatagramSink sink (UnixPath{ path });
+    const auto batch = numbered_entries (100);
+    std::string err;
+    const auto t0        = std::chrono::steady_clock::now ();
+    const std::size_t ok = sink.write_batch (batch.data (), batch.size (), err);
+    EXPECT_LT (std::chrono::steady_clock::now () - t0, 10 * DatagramSink::kUnixSendTimeout);
+    EXPECT_LT (ok, batch.size ());
+    EXPECT_FALSE (err.empty ());
+    EXPECT_EQ (sink.dropped (), batch.size () - ok);
+    close (rfd);
+    ::unlink (path.c_str ());
+}
+
+TEST (DatagramSink, MissingReceiverIsAnError) {
+    DatagramSink sink (UnixPath{ ::testing::TempDir () + "logger_dgram_missing.sock" });
+    std::string err;
+    LogEntry e;
+    EXPECT_FALSE (sink.write (e, err));
+    EXPECT_FALSE (err.empty ());
+}
+
+TEST (DatagramSink, OversizedMessageIsCut) {
+    const int rfd = ::socket (AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE (rfd, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    ASSERT_EQ (bind (rfd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)), 0);
+    socklen_t len = sizeof (addr);
+    ASSERT_EQ (getsockname (rfd, reinterpret_cast<sockaddr*> (&addr), &len), 0);
+
+    DatagramSink sink ("127.0.0.1", ntohs (addr.sin_port));
+    std::string err;
+    LogEntry e;
+    e.message.assign (100000, 'x');
+    ASSERT_TRUE (sink.write (e, err)) << err;
+    const auto got = recv_datagrams (rfd, 1);
+    ASSERT_EQ (got.size (), 1u);
+    EXPECT_EQ (got[0].size (), DatagramSink::kMaxDatagram);
+    EXPECT_EQ (got[0].back (), '\n');
+    close (rfd);
+}
@@ -6,6 +6,12 @@
 #include <gtest/gtest.h>
 #include <regex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef LOGGER_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace logger;
 namespace fs = std::filesystem;
@@ -63,3 +69,323 @@ TEST (FileSink, IoErrorIsReported) {
     EXPECT_FALSE (err.empty ());
     EXPECT_NE (err.find ("FileSink"), std::string::npos);
 }
+
+TEST (FileSink, WriteBatchKeepsOrder) {
+    fs::path tmp = fs::temp_directory_path () / "logger_file_sink_batch.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    std::vector<LogEntry> batch (3);
+    batch[0].level   = LogLevel::Error;
+    batch[0].message = "first";
+    batch[1].level   = LogLevel::Warning;
+    batch[1].message = "second";
+    batch[2].message = "third";
+    {
+        FileSink sink (tmp.string ());
+        std::string err;
+        EXPECT_EQ (sink.write_batch (batch.data (), batch.size (), err), 3u);
+    }
+
+    std::istringstream iss (read_all (tmp));
+    std::string line;
+    std::vector<std::string> got;
+    while (std::getline (iss, line))
+        got.push_back (line.substr (line.find (' ') + 1));
+    ASSERT_EQ (got.size (), 3u);
+    EXPECT_EQ (got[0], "ERROR first");
+    EXPECT_EQ (got[1], "WARN second");
+    EXPECT_EQ (got[2], "INFO third");
+}
+
+TEST (FileSink, BufferedUntilFullOrFlush) {
+    fs::path tmp = fs::temp_directory_path () / "logger_file_sink_buffered.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    FileSinkOptions opts;
+    opts.buffer_bytes = 4096;
+    FileSink sink (tmp.string (), opts);
+    LogEntry e;
+    e.message = "buffered";
+    std::string err;
+    ASSERT_TRUE (sink.write (e, err));
+    EXPECT_EQ (fs::file_size (tmp), 0u);
+
+    e.message.assign (5000, 'x'); // larger than the buffer: written through
+    ASSERT_TRUE (sink.write (e, err));
+    EXPECT_GT (fs::file_size (tmp), 5000u);
+
+    e.message = "tail";
+    ASSERT_TRUE (sink.write (e, err));
+    const auto before = fs::file_size (tmp);
+    sink.flush ();
+    EXPECT_GT (fs::file_size (tmp), before);
+}
+
+TEST (FileSink, DeferredErrorStillBuffersEntry) {
+    if (!fs::exists ("/dev/full"))
+        GTEST_SKIP () << "no /dev/full";
+    FileSink sink ("/dev/full");
+    ASSERT_TRUE (sink.is_open ());
+    LogEntry e;
+    e.message = "first";
+    std::string err;
+    ASSERT_TRUE (sink.write (e, err));
+    sink.flush (); // ENOSPC, kept for the next write
+
+    e.message = "second";
+    EXPECT_FALSE (sink.write (e, err));
+    EXPECT_NE (err.find ("FileSink: write failed"), std::string::npos);
+    // Reported once; the entry above went into the buffer all the same.
+    err.clear ();
+    e.message = "third";
+    EXPECT_TRUE (sink.write (e, err)) << err;
+    EXPECT_TRUE (err.empty ());
+}
+
+TEST (FileSink, FlushOnErrorLevel) {
+    fs::path tmp = fs::temp_directory_path () / "logger_file_sink_flush_error.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    FileSinkOptions opts;
+    opts.buffer_bytes   = 1 << 20;
+    opts.flush_on_error = true;
+    Logger L (make_file_sink (tmp.string (), opts), LogLevel::Info);
+    EXPECT_EQ (L.log (LogLevel::Info, "quiet"), Status::Ok);
+    EXPECT_EQ (fs::file_size (tmp), 0u);
+    EXPECT_EQ (L.log (LogLevel::Error, "loud"), Status::Ok);
+    const std::string all = read_all (tmp);
+    EXPECT_NE (all.find ("INFO quiet"), std::string::npos);
+    EXPECT_NE (all.find ("ERROR loud"), std::string::npos);
+}
+
+TEST (FileSink, FlushIntervalTimer) {
+    fs::path tmp = fs::temp_directory_path () / "logger_file_sink_interval.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    FileSinkOptions opts;
+    opts.buffer_bytes   = 1 << 20;
+    opts.flush_interval = std::chrono::milliseconds (20);
+    FileSink sink (tmp.string (), opts);
+    LogEntry e;
+    e.message = "timed";
+    std::string err;
+    ASSERT_TRUE (sink.write (e, err));
+    for (int i = 0; i < 100 && fs::file_size (tmp) == 0; ++i)
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    EXPECT_NE (read_all (tmp).find ("INFO timed"), std::string::npos);
+}
+
+TEST (FileSink, RotateBySizeKeepsMaxFiles) {
+    fs::path dir = fs::temp_directory_path () / "logger_file_sink_rotate_size";
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    const fs::path live = dir / "app.log";
+
+    FileSinkOptions opts;
+    opts.buffer_bytes = 256;
+    opts.rotate_bytes = 200;
+    opts.max_files    = 2;
+    {
+        FileSink sink (live.string (), opts);
+        LogEntry e;
+        e.message.assign (60, 'r');
+        std::string err;
+        for (int i = 0; i < 20; ++i)
+            ASSERT_TRUE (sink.write (e, err)) << err;
+    }
+    std::vector<std::string> rotated;
+    for (const auto& f : fs::directory_iterator (dir))
+        if (f.path () != live)
+            rotated.push_back (f.path ().filename ().string ());
+    EXPECT_EQ (rotated.size (), 2u);
+    for (const auto& name : rotated) {
+        EXPECT_TRUE (std::regex_match (name, std::regex (R"(app\.log\.\d+)"))) << name;
+        EXPECT_LE (fs::file_size (dir / name), 200u);
+    }
+    EXPECT_GT (fs::file_size (live), 0u);
+    fs::remove_all (dir, ec);
+}
+
+TEST (FileSink, FailedRotationKeepsAppending) {
+    fs::path dir = fs::temp_directory_path () / "logger_file_sink_rotate_fail";
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    const fs::path live = dir / "app.log";
+
+    FileSinkOptions opts;
+    opts.buffer_bytes   = 256;
+    opts.rotate_bytes   = 200;
+    opts.rotate_pattern = (dir / "missing" / "app.{n}").string (); // rename fails: ENOENT
+    {
+        FileSink sink (live.string (), opts);
+        LogEntry e;
+        e.epoch_ms = 1700000000000ull;
+        e.message.assign (60, 'r');
+        std::string err;
+        std::size_t failures = 0;
+        for (int i = 0; i < 20; ++i, e.epoch_ms += 10) {
+            err.clear ();
+            if (!sink.write (e, err)) {
+                ++failures;
+                EXPECT_NE (err.find ("rotate failed"), std::string::npos) << err;
+            }
+        }
+        EXPECT_EQ (failures, 1u) << "reported once, not on every write";
+
+        // Once the directory exists the retry after the backoff succeeds.
+        fs::create_directories (dir / "missing");
+        e.epoch_ms += 2000;
+        EXPECT_TRUE (sink.write (e, err)) << err;
+    }
+    EXPECT_TRUE (fs::exists (dir / "missing" / "app.1"));
+    EXPECT_GT (fs::file_size (dir / "missing" / "app.1"), 20u * 60u);
+    fs::remove_all (dir, ec);
+}
+
+TEST (FileSink, RotateOnIntervalBoundary) {
+    fs::path dir = fs::temp_directory_path () / "logger_file_sink_rotate_time";
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    const fs::path live = dir / "app.log";
+
+    FileSinkOptions opts;
+    opts.rotate_interval = std::chrono::hours (1);
+    opts.rotate_pattern  = "{path}.{time}";
+    {
+        FileSink sink (live.string (), opts);
+        std::string err;
+        LogEntry e;
+        e.epoch_ms = 1700000000000ull / 3600000ull * 3600000ull + 3599000ull; // one second before the hour
+        e.message  = "before";
+        ASSERT_TRUE (sink.write (e, err));
+        e.epoch_ms += 500;
+        ASSERT_TRUE (sink.write (e, err));
+        e.epoch_ms += 1000; // next hour
+        e.message = "after";
+        ASSERT_TRUE (sink.write (e, err));
+    }
+    std::vector<fs::path> rotated;
+    for (const auto& f : fs::directory_iterator (dir))
+        if (f.path () != live)
+            rotated.push_back (f.path ());
+    ASSERT_EQ (rotated.size (), 1u);
+    EXPECT_TRUE (std::regex_match (rotated[0].filename ().string (), std::regex (R"(app\.log\.\d{8}T\d{6})")));
+    const std::string old = read_all (rotated[0]);
+    EXPECT_NE (old.find ("INFO before"), std::string::npos);
+    EXPECT_EQ (old.find ("after"), std::string::npos);
+    EXPECT_NE (read_all (live).find ("INFO after"), std::string::npos);
+    fs::remove_all (dir, ec);
+}
+
+TEST (FileSink, CompressesRotatedFiles) {
+#ifndef LOGGER_HAVE_ZLIB
+    GTEST_SKIP () << "built without zlib";
+#else
+    fs::path dir = fs::temp_directory_path () / "logger_file_sink_rotate_gz";
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    const fs::path live = dir / "app.log";
+
+    FileSinkOptions opts;
+    opts.rotate_bytes = 100;
+    opts.compress     = true;
+    {
+        FileSink sink (live.string (), opts);
+        LogEntry e;
+        e.message.assign (70, 'z');
+        std::string err;
+        ASSERT_TRUE (sink.write (e, err));
+        ASSERT_TRUE (sink.write (e, err));
+    }
+    const fs::path gz = dir / "app.log.1.gz";
+    ASSERT_TRUE (fs::exists (gz));
+    EXPECT_FALSE (fs::exists (dir / "app.log.1"));
+    gzFile in = gzopen (gz.string ().c_str (), "rb");
+    ASSERT_NE (in, nullptr);
+    char buf[256];
+    const int n = gzread (in, buf, sizeof (buf));
+    gzclose (in);
+    ASSERT_GT (n, 0);
+    EXPECT_NE (std::string (buf, static_cast<std::size_t> (n)).find ("INFO " + std::string (70, 'z')), std::string::npos);
+    fs::remove_all (dir, ec);
+#endif
+}
+
+TEST (FileSink, IoUringKeepsOrderAcrossBuffers) {
+    fs::path tmp = fs::temp_directory_path () / "logger_file_sink_uring.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    FileSinkOptions opts;
+    opts.buffer_bytes  = 256;
+    opts.io_uring      = true;
+    opts.uring_buffers = 3;
+    {
+        FileSink sink (tmp.string (), opts);
+        ASSERT_TRUE (sink.is_open ());
+        RecordProperty ("io_uring", sink.uses_io_uring () ? "yes" : "fallback");
+        LogEntry e;
+        std::string err;
+        for (int i = 0; i < 2000; ++i) {
+            e.message = "line " + std::to_string (i);
+            if (i % 500 == 7)
+                e.message += std::string (300, 'x'); // larger than a buffer: written through
+            ASSERT_TRUE (sink.write (e, err)) << err;
+        }
+        e.message = "last";
+        ASSERT_TRUE (sink.write (e, err)) << err;
+        sink.flush ();
+        EXPECT_NE (read_all (tmp).find ("INFO last\n"), std::string::npos);
+    }
+    std::istringstream iss (read_all (tmp));
+    std::string line;
+    int next = 0;
+    while (std::getline (iss, line) && next < 2000) {
+        const std::string want = "INFO line " + std::to_string (next);
+        ASSERT_NE (line.find (want), std::string::npos) << line;
+        ++next;
+    }
+    EXPECT_EQ (next, 2000);
+    EXPECT_NE (line.find ("INFO last"), std::string::npos);
+}
+
+TEST (FileSink, IoUringRotates) {
+    fs::path dir = fs::temp_directory_path () / "logger_file_sink_uring_rotate";
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    const fs::path live = dir / "app.log";
+
+    FileSinkOptions opts;
+    opts.buffer_bytes = 128;
+    opts.rotate_bytes = 1000;
+    opts.io_uring     = true;
+    {
+        FileSink sink (live.string (), opts);
+        LogEntry e;
+        e.message.assign (60, 'u');
+        std::string err;
+        for (int i = 0; i < 40; ++i)
+            ASSERT_TRUE (sink.write (e, err)) << err;
+    }
+    std::uintmax_t total = 0;
+    std::size_t files    = 0;
+    for (const auto& f : fs::directory_iterator (dir)) {
+        EXPECT_LE (fs::file_size (f.path ()), 1000u) << f.path ();
+        const std::string all = read_all (f.path ());
+        EXPECT_EQ (all.find ('\0'), std::string::npos) << f.path ();
+        total += fs::file_size (f.path ());
+        ++files;
+    }
+    EXPECT_GT (files, 3u);
+    EXPECT_EQ (total, 40u * (20 + 1 + 4 + 1 + 60 + 1));
+    fs::remove_all (dir, ec);
+}
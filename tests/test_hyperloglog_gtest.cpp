@@ -0,0 +1,57 @@
+#include "logger/hash.hpp"
+#include "logger/hyperloglog.hpp"
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+
+using namespace logger;
+
+namespace {
+std::uint64_t hash_of (const std::string& s) {
+    return hash_bytes (s.data (), s.size ());
+}
+} // namespace
+
+TEST (HashBytes, EveryLengthAndByteMatters) {
+    std::set<std::uint64_t> seen;
+    const std::string base (40, 'a');
+    for (std::size_t n = 0; n <= base.size (); ++n) {
+        EXPECT_TRUE (seen.insert (hash_bytes (base.data (), n)).second) << n;
+        std::string flipped = base.substr (0, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            flipped[i] = 'b';
+            EXPECT_TRUE (seen.insert (hash_of (flipped)).second) << n << " " << i;
+            flipped[i] = 'a';
+        }
+    }
+    EXPECT_NE (hash_bytes ("abc", 3, 1), hash_bytes ("abc", 3, 2));
+}
+
+TEST (HyperLogLog, EstimatesWithinThreeStandardErrors) {
+    const double rel = 3 * 1.04 / std::sqrt (static_cast<double> (HyperLogLog::kRegisters));
+    for (const std::uint64_t n : { 1ull, 10ull, 100ull, 1000ull, 20000ull, 300000ull }) {
+        HyperLogLog h;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const std::string msg = "message " + std::to_string (i);
+            h.add (hash_of (msg));
+            h.add (hash_of (msg)); // duplicates do not count
+        }
+        EXPECT_NEAR (static_cast<double> (h.estimate ()), static_cast<double> (n), std::max (1.0, rel * static_cast<double> (n))) << n;
+    }
+    EXPECT_EQ (HyperLogLog{}.estimate (), 0u);
+}
+
+TEST (HyperLogLog, MergeIsTheUnion) {
+    HyperLogLog a, b, both;
+    for (int i = 0; i < 50000; ++i) {
+        const std::uint64_t h = hash_of ("item " + std::to_string (i));
+        (i < 30000 ? a : b).add (h);
+        if (i >= 20000 && i < 30000)
+            b.add (h); // overlap
+        both.add (h);
+    }
+    a.merge (b);
+    EXPECT_EQ (a.estimate (), both.estimate ());
+}
@@ -0,0 +1,122 @@
+#include "logger/line_framer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace logger;
+
+TEST (LineFramer, FindByteAgreesAcrossSimdLevels) {
+    std::string buf (300, 'a');
+    for (std::size_t len = 0; len < buf.size (); len += 7) {
+        for (std::size_t at = 0; at <= len; ++at) {
+            std::string s = buf.substr (0, len);
+            if (at < len)
+                s[at] = '\n';
+            const char* end = s.data () + s.size ();
+            for (const SimdLevel level : { SimdLevel::Generic, SimdLevel::Sse2, SimdLevel::Avx2 }) {
+                if (!simd_supported (level))
+                    continue;
+                ASSERT_EQ (find_byte (s.data (), end, '\n', level) - s.data (), static_cast<std::ptrdiff_t> (at))
+                << "len " << len << " level " << static_cast<int> (level);
+            }
+        }
+    }
+}
+
+TEST (LineFramer, ParsesTextRecordsInPlace) {
+    std::uint64_t epoch = 0;
+    LogLevel lvl        = LogLevel::Info;
+    std::string_view msg;
+    const std::string line = "1724054876881|warn|disk | almost full\r";
+    ASSERT_TRUE (parse_text_record (line, epoch, lvl, msg));
+    EXPECT_EQ (epoch, 1724054876881u);
+    EXPECT_EQ (lvl, LogLevel::Warning);
+    EXPECT_EQ (msg, "disk | almost full");
+    EXPECT_EQ (msg.data (), line.data () + 19);
+
+    EXPECT_TRUE (parse_text_record ("1|ERROR|", epoch, lvl, msg));
+    EXPECT_EQ (lvl, LogLevel::Error);
+    EXPECT_TRUE (msg.empty ());
+    EXPECT_FALSE (parse_text_record ("1|DEBUG|x", epoch, lvl, msg));
+    EXPECT_FALSE (parse_text_record ("12a|INFO|x", epoch, lvl, msg));
+    EXPECT_FALSE (parse_text_record ("1 INFO x", epoch, lvl, msg));
+}
+
+TEST (LineFramer, FramesLinesSplitAcrossReceives) {
+    std::string stream;
+    std::vector<std::string> want;
+    for (int i = 0; i < 200; ++i) {
+        want.push_back (std::string (static_cast<std::size_t> (i * 37 % 500), 'x') + std::to_string (i));
+        stream += want.back () + "\n";
+    }
+    want.push_back (std::string (5000, 'L')); // longer than the buffer
+    stream += want.back () + "\n";
+
+    LineFramer framer (256);
+    std::vector<std::string> got;
+    for (std::size_t pos = 0, step = 1; pos < stream.size (); pos += step, step = step % 97 + 13) {
+        const std::size_t n = std::min (step, stream.size () - pos);
+        char* dst           = framer.reserve (n);
+        ASSERT_GE (framer.room (), n);
+        stream.copy (dst, n, pos);
+        framer.commit (n);
+        framer.for_each_line ([&] (const std::string_view line) { got.emplace_back (line); });
+    }
+    EXPECT_EQ (got, want);
+    EXPECT_TRUE (framer.pending ().empty ());
+}
+
+TEST (LineFramer, IndexesEveryDelimiter) {
+    std::string s;
+    for (int i = 0; i < 5000; ++i)
+        s += (i * 7919 % 13 == 0) ? '\n' : (i * 104729 % 17 == 0) ? '|' : 'x';
+    std::vector<std::uint32_t> want;
+    for (std::size_t i = 0; i < s.size (); ++i)
+        if (s[i] == '\n' || s[i] == '|')
+            want.push_back (static_cast<std::uint32_t> (i));
+
+    // Small output arrays force the scan to stop and resume.
+    for (const SimdLevel level : { SimdLevel::Generic, SimdLevel::Sse2, SimdLevel::Avx2 }) {
+        if (!simd_supported (level))
+            continue;
+        for (const std::size_t slots : { std::size_t{ 1 }, std::size_t{ 70 }, std::size_t{ 4096 } }) {
+            std::vector<std::uint32_t> got, out (slots);
+            for (std::size_t done = 0; done < s.size ();) {
+                std::size_t scanned = 0;
+                const std::size_t k =
+                index_delimiters (s.data () + done, s.size () - done, out.data (), slots, scanned, level);
+                ASSERT_GT (scanned, 0u);
+                for (std::size_t i = 0; i < k; ++i)
+                    got.push_back (static_cast<std::uint32_t> (done + out[i]));
+                done += scanned;
+            }
+            EXPECT_EQ (got, want) << "slots " << slots << " level " << static_cast<int> (level);
+        }
+    }
+}
+
+TEST (LineFramer, ForEachRecordSkipsMalformedLines) {
+    std::string stream;
+    for (int i = 0; i < 3000; ++i)
+        stream += std::to_string (i) + (i % 100 == 0 ? "|BAD|" : "|info|") + "msg|" + std::to_string (i) + "\n";
+    stream += "77|WARN|partial";
+
+    LineFramer framer;
+    std::uint64_t next = 0;
+    std::size_t records = 0;
+    for (std::size_t pos = 0; pos < stream.size (); pos += 1000) {
+        const std::size_t n = std::min<std::size_t> (1000, stream.size () - pos);
+        stream.copy (framer.reserve (n), n, pos);
+        framer.commit (n);
+        records += framer.for_each_record ([&] (const std::uint64_t epoch, const LogLevel lvl, const std::string_view msg) {
+            if (next % 100 == 0)
+                ++next;
+            EXPECT_EQ (epoch, next);
+            EXPECT_EQ (lvl, LogLevel::Info);
+            EXPECT_EQ (msg, "msg|" + std::to_string (next));
+            ++next;
+        });
+    }
+    EXPECT_EQ (records, 2970u);
+    EXPECT_EQ (framer.pending (), "77|WARN|partial");
+}
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <gtest/gtest.h>
 #include <regex>
+#include <stdexcept>
 #include <string>
 
 using namespace logger;
@@ -53,3 +54,44 @@ TEST (Logger, LastErrorPopulatedOnSinkFailure) {
     const auto msg = L.last_error ();
     EXPECT_FALSE (msg.empty ());
 }
+
+TEST (Logger, LazyMessageBuiltOnlyWhenEnabled) {
+    const fs::path tmp = fs::temp_directory_path () / "logger_lazy.log";
+    std::error_code ec;
+    fs::remove (tmp, ec);
+
+    Logger L (make_file_sink (tmp.string ()), LogLevel::Warning);
+    int built = 0;
+    auto make = [&] () {
+        ++built;
+        return "n=" + std::to_string (built);
+    };
+
+    EXPECT_EQ (L.log_lazy<LogLevel::Info> (make), Status::Filtered);
+    EXPECT_EQ (LOGGER_INFO (L, make ()), Status::Filtered);
+    EXPECT_EQ (L.log_lazy (LogLevel::Info, make), Status::Filtered);
+    EXPECT_EQ (built, 0);
+
+    EXPECT_EQ (LOGGER_WARN (L, make ()), Status::Ok);
+    EXPECT_EQ (L.log_lazy<LogLevel::Error> (make), Status::Ok);
+    EXPECT_EQ (built, 2);
+    L.flush ();
+    EXPECT_EQ (count_lines (tmp), 2u);
+}
+
+TEST (Logger, LazyMessageExceptionsReachTheCaller) {
+    Logger L (make_file_sink ((fs::temp_directory_path () / "logger_lazy_throw.log").string ()), LogLevel::Info);
+    const auto fails = [] () -> std::string { throw std::runtime_error ("format"); };
+    const auto fixed = [] () noexcept { return "fixed"; };
+    static_assert (!noexcept (L.log_lazy<LogLevel::Info> (fails)), "may throw");
+    static_assert (noexcept (L.log_lazy<LogLevel::Info> (fixed)), "cannot throw");
+
+    EXPECT_THROW (L.log_lazy<LogLevel::Error> (fails), std::runtime_error);
+    EXPECT_THROW (L.log_lazy (LogLevel::Error, fails), std::runtime_error);
+    EXPECT_EQ (L.log_lazy<LogLevel::Error> (fixed), Status::Ok);
+}
+
+TEST (Logger, CompiledLevelIsConstexpr) {
+    static_assert (is_compiled_in (LogLevel::Error), "ERROR is always compiled in");
+    EXPECT_EQ (is_compiled_in (LogLevel::Info), LOGGER_COMPILED_LEVEL >= 2);
+}
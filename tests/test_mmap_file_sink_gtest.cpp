@@ -0,0 +1,95 @@
+#include "logger/logger.hpp"
+#include "logger/mmap_file_sink.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace logger;
+namespace fs = std::filesystem;
+
+static std::string read_all (const fs::path& p) {
+    std::ifstream ifs (p, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf ();
+    return oss.str ();
+}
+
+static fs::path fresh_dir (const char* name) {
+    const fs::path dir = fs::temp_directory_path () / name;
+    std::error_code ec;
+    fs::remove_all (dir, ec);
+    fs::create_directories (dir);
+    return dir;
+}
+
+TEST (MmapFileSink, ConcurrentWritersRollOverSegments) {
+    const fs::path dir = fresh_dir ("logger_mmap_sink_mt");
+    constexpr int threads    = 4;
+    constexpr int per_thread = 500;
+    {
+        Logger L (make_mmap_file_sink ((dir / "app").string (), 4096), LogLevel::Info);
+        std::vector<std::thread> th;
+        for (int t = 0; t < threads; ++t)
+            th.emplace_back ([&, t] {
+                for (int i = 0; i < per_thread; ++i)
+                    EXPECT_EQ (L.log (LogLevel::Info, "msg " + std::to_string (t) + "-" + std::to_string (i)), Status::Ok);
+            });
+        for (auto& x : th)
+            x.join ();
+        L.flush ();
+    }
+
+    const std::regex re (R"(^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}Z INFO msg \d-\d+$)");
+    std::size_t segments = 0, lines = 0;
+    for (const auto& ent : fs::directory_iterator (dir)) {
+        ++segments;
+        const std::string data = read_all (ent.path ());
+        EXPECT_EQ (MmapFileSink::valid_length (data.data (), data.size ()), data.size ()) << "sealed segment has a zero tail";
+        std::istringstream iss (data);
+        for (std::string line; std::getline (iss, line); ++lines)
+            EXPECT_TRUE (std::regex_match (line, re)) << line;
+    }
+    EXPECT_GT (segments, 1u);
+    EXPECT_EQ (lines, static_cast<std::size_t> (threads * per_thread));
+}
+
+TEST (MmapFileSink, ValidLengthStopsAtZeroTail) {
+    const char crashed[] = "2024-01-01T00:00:00Z INFO a\n\0\0\0\0";
+    EXPECT_EQ (MmapFileSink::valid_length (crashed, sizeof (crashed)), 28u);
+    EXPECT_EQ (MmapFileSink::valid_length ("abc", 3), 3u);
+}
+
+TEST (MmapFileSink, RecoverKeepsLinesAfterZeroGap) {
+    // A reservation left unfilled, a line torn by a gap and one torn at the end.
+    const char crashed[] = "a 1\n\0\0\0\0b 2\nc partial\0\0\0d 4\ne torn";
+    const std::string data (crashed, sizeof (crashed) - 1);
+    EXPECT_EQ (MmapFileSink::valid_length (data.data (), data.size ()), data.size ());
+    EXPECT_EQ (MmapFileSink::recover (data.data (), data.size ()), "a 1\nb 2\nd 4\n");
+    const std::string tail = data.substr (0, 12) + std::string (16, '\0');
+    EXPECT_EQ (MmapFileSink::valid_length (tail.data (), tail.size ()), 12u);
+    EXPECT_EQ (MmapFileSink::recover (tail.data (), tail.size ()), "a 1\nb 2\n");
+}
+
+TEST (MmapFileSink, NewSinkDoesNotReuseSegmentsAndRejectsHugeRecords) {
+    const fs::path dir = fresh_dir ("logger_mmap_sink_reopen");
+    const auto base    = (dir / "app").string ();
+    std::string first;
+    {
+        MmapFileSink sink (base, 1024);
+        ASSERT_TRUE (sink.is_open ());
+        first = sink.current_path ();
+    }
+    MmapFileSink sink (base, 1024);
+    EXPECT_NE (sink.current_path (), first);
+
+    LogEntry e;
+    e.message.assign (2048, 'x');
+    std::string err;
+    EXPECT_FALSE (sink.write (e, err));
+    EXPECT_NE (err.find ("MmapFileSink"), std::string::npos);
+}
@@ -0,0 +1,51 @@
+#include "logger/quantile_sketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace logger;
+
+TEST (QuantileSketch, BucketsCoverEveryValueOnce) {
+    for (std::size_t i = 1; i < QuantileSketch::kBuckets; ++i) {
+        const std::uint64_t lo = QuantileSketch::lower_bound (i);
+        EXPECT_GT (lo, QuantileSketch::lower_bound (i - 1));
+        EXPECT_EQ (QuantileSketch::index (lo), i);
+        EXPECT_EQ (QuantileSketch::index (lo - 1), i - 1);
+    }
+    EXPECT_EQ (QuantileSketch::index (QuantileSketch::kMaxValue), QuantileSketch::kBuckets - 1);
+    EXPECT_EQ (QuantileSketch::index (~std::uint64_t{ 0 }), QuantileSketch::kBuckets - 1);
+}
+
+TEST (QuantileSketch, QuantilesWithinRelativeError) {
+    std::mt19937_64 rng (7);
+    std::lognormal_distribution<double> dist (5.0, 1.5); // long tail, like payload sizes
+    std::vector<std::uint64_t> values;
+    QuantileSketch sketch;
+    for (int i = 0; i < 100000; ++i) {
+        const auto v = static_cast<std::uint64_t> (dist (rng));
+        values.push_back (v);
+        sketch.add (v);
+    }
+    std::sort (values.begin (), values.end ());
+    for (const double q : { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+        const std::size_t rank = std::max<std::size_t> (1, static_cast<std::size_t> (std::ceil (q * values.size ())));
+        const double exact     = static_cast<double> (values[rank - 1]);
+        const double got       = static_cast<double> (sketch.quantile (q));
+        EXPECT_LE (std::abs (got - exact), exact / 32.0 + 0.5) << "q " << q;
+    }
+}
+
+TEST (QuantileSketch, MergeEqualsSingleSketch) {
+    QuantileSketch all, a, b;
+    for (std::uint64_t v = 0; v < 5000; ++v) {
+        all.add (v * 37 % 9001);
+        (v % 3 == 0 ? a : b).add (v * 37 % 9001);
+    }
+    a.merge (b);
+    EXPECT_EQ (a.count (), all.count ());
+    for (const double q : { 0.5, 0.9, 0.99, 0.999 })
+        EXPECT_EQ (a.quantile (q), all.quantile (q));
+    EXPECT_EQ (QuantileSketch ().quantile (0.5), 0u);
+}
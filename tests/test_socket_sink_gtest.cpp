@@ -1,16 +1,20 @@
 #include "logger/log_level.hpp"
 #include "logger/logger.hpp"
 #include "logger/socket_sink.hpp"
+#include "logger/wire.hpp"
 #include <atomic>
 #include <cstring>
 #include <gtest/gtest.h>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace logger;
@@ -105,3 +109,511 @@ TEST (SocketSink, SendsEpochLevelMessageLines) {
     EXPECT_EQ (level_str, "WARN");
     EXPECT_EQ (msg_str, "hello world");
 }
+
+TEST (SocketSink, WriteBatchSendsAllLines) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+
+    std::string received;
+    std::thread server ([&] () {
+        int cli = -1;
+        for (int i = 0; i < 300 && cli < 0; ++i) {
+            cli = ::accept (lfd, nullptr, nullptr);
+            if (cli < 0)
+                std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        }
+        ASSERT_GE (cli, 0) << "accept timeout";
+        timeval tv{};
+        tv.tv_sec = 2;
+        setsockopt (cli, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::recv (cli, buf, sizeof (buf), 0)) > 0)
+            received.append (buf, buf + n);
+        close (cli);
+        close (lfd);
+    });
+
+    std::vector<LogEntry> batch (3);
+    for (size_t i = 0; i < batch.size (); ++i) {
+        batch[i].epoch_ms = 1000 + i;
+        batch[i].message  = "m" + std::to_string (i);
+    }
+    {
+        SocketSink sink ("127.0.0.1", port);
+        std::string err;
+        EXPECT_EQ (sink.write_batch (batch.data (), batch.size (), err), 3u) << err;
+    }
+    server.join ();
+    EXPECT_EQ (received, "1000|INFO|m0\n1001|INFO|m1\n1002|INFO|m2\n");
+}
+
+TEST (SocketSink, AsyncCoalescesAndDeliversInOrder) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+
+    std::string received;
+    std::thread server ([&] () {
+        int cli = -1;
+        for (int i = 0; i < 300 && cli < 0; ++i) {
+            cli = ::accept (lfd, nullptr, nullptr);
+            if (cli < 0)
+                std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        }
+        ASSERT_GE (cli, 0) << "accept timeout";
+        timeval tv{};
+        tv.tv_sec = 2;
+        setsockopt (cli, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::recv (cli, buf, sizeof (buf), 0)) > 0)
+            received.append (buf, buf + n);
+        close (cli);
+        close (lfd);
+    });
+
+    SocketSinkOptions opts;
+    opts.async       = true;
+    opts.batch_bytes = 1024;
+    opts.linger      = std::chrono::milliseconds (50);
+    std::string expected;
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        std::string err;
+        LogEntry e;
+        for (int i = 0; i < 500; ++i) {
+            e.epoch_ms = 1000 + i;
+            e.message  = "m" + std::to_string (i);
+            ASSERT_TRUE (sink.write (e, err)) << err;
+            expected += std::to_string (e.epoch_ms) + "|INFO|" + e.message + "\n";
+        }
+        sink.flush ();
+        const SocketSinkCounters c = sink.counters ();
+        EXPECT_EQ (c.enqueued, 500u);
+        EXPECT_EQ (c.sent, 500u);
+        EXPECT_EQ (c.dropped, 0u);
+        EXPECT_EQ (c.send_errors, 0u);
+    }
+    server.join ();
+    EXPECT_EQ (received, expected);
+}
+
+TEST (SocketSink, AsyncStalledCollectorDoesNotBlockCallers) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port); // never accepted, never read
+    ASSERT_GE (lfd, 0);
+
+    SocketSinkOptions opts;
+    opts.async          = true;
+    opts.queue_capacity = 256;
+    Logger L (std::make_unique<SocketSink> ("127.0.0.1", port, opts), LogLevel::Info);
+    const std::string msg (1024, 'x');
+    const auto t0 = std::chrono::steady_clock::now ();
+    int dropped   = 0;
+    for (int i = 0; i < 50000; ++i)
+        dropped += L.log (LogLevel::Info, msg) == Status::IoError;
+    EXPECT_LT (std::chrono::steady_clock::now () - t0, std::chrono::seconds (5));
+    EXPECT_GT (dropped, 0);
+    close (lfd); // resets the pending connection so the sender can finish
+}
+
+static std::string accept_and_read_all (const int lfd) {
+    int cli = -1;
+    for (int i = 0; i < 300 && cli < 0; ++i) {
+        cli = ::accept (lfd, nullptr, nullptr);
+        if (cli < 0)
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    }
+    if (cli < 0)
+        return "accept timeout";
+    timeval tv{};
+    tv.tv_sec = 2;
+    setsockopt (cli, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    std::string received;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::recv (cli, buf, sizeof (buf), 0)) > 0)
+        received.append (buf, buf + n);
+    close (cli);
+    return received;
+}
+
+static int listen_on_port (const uint16_t port) {
+    const int fd      = ::socket (AF_INET, SOCK_STREAM, 0);
+    constexpr int one = 1;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port        = htons (port);
+    if (bind (fd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)) < 0 || listen (fd, 1) < 0) {
+        ::close (fd);
+        return -1;
+    }
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static std::string numbered_lines (SocketSink& sink, const int from, const int to) {
+    std::string expected, err;
+    LogEntry e;
+    for (int i = from; i < to; ++i) {
+        e.epoch_ms = 1000 + static_cast<std::uint64_t> (i);
+        e.message  = "m" + std::to_string (i);
+        EXPECT_TRUE (sink.write (e, err)) << err;
+        expected += std::to_string (e.epoch_ms) + "|INFO|" + e.message + "\n";
+    }
+    return expected;
+}
+
+TEST (SocketSink, SpillsDuringOutageAndReplaysInOrder) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    close (lfd); // collector is down
+
+    SocketSinkOptions opts;
+    opts.spill_bytes   = 1 << 20;
+    opts.reconnect_min = std::chrono::milliseconds (20);
+    std::string expected, received;
+    std::thread server;
+    int srv = -1;
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        const auto t0 = std::chrono::steady_clock::now ();
+        expected      = numbered_lines (sink, 0, 1000);
+        EXPECT_LT (std::chrono::steady_clock::now () - t0, std::chrono::seconds (1));
+        EXPECT_EQ (sink.counters ().spilled, 1000u);
+
+        srv = listen_on_port (port); // collector comes back
+        ASSERT_GE (srv, 0);
+        server = std::thread ([&] { received = accept_and_read_all (srv); });
+        std::this_thread::sleep_for (std::chrono::milliseconds (100)); // past the backoff
+        expected += numbered_lines (sink, 1000, 1001);
+        sink.flush ();
+    }
+    server.join ();
+    close (srv);
+    EXPECT_EQ (received, expected);
+}
+
+TEST (SocketSink, SpoolSurvivesRestartAndReplaysFirst) {
+    const std::string spool = ::testing::TempDir () + "logger_socket_sink.spool";
+    ::unlink (spool.c_str ());
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    close (lfd);
+
+    SocketSinkOptions opts;
+    opts.spill_bytes = 256; // overflows to disk almost at once
+    opts.spool_path  = spool;
+    std::string expected;
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        expected = numbered_lines (sink, 0, 200);
+        EXPECT_EQ (sink.counters ().send_errors, 0u);
+    }
+
+    const int srv = listen_on_port (port);
+    ASSERT_GE (srv, 0);
+    std::string received;
+    std::thread server ([&] { received = accept_and_read_all (srv); });
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        expected += numbered_lines (sink, 200, 201);
+        sink.flush ();
+    }
+    server.join ();
+    close (srv);
+    EXPECT_EQ (received, expected);
+    struct stat st{};
+    ASSERT_EQ (::stat (spool.c_str (), &st), 0);
+    EXPECT_EQ (st.st_size, 0);
+    ::unlink (spool.c_str ());
+}
+
+TEST (SocketSink, ConstructorDoesNotConnect) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+
+    auto sink = std::make_unique<SocketSink> ("127.0.0.1", port);
+    std::this_thread::sleep_for (std::chrono::milliseconds (50));
+    EXPECT_LT (::accept (lfd, nullptr, nullptr), 0); // nothing pending yet
+    std::string received;
+    std::thread server ([&] { received = accept_and_read_all (lfd); });
+    numbered_lines (*sink, 0, 1);
+    sink.reset ();
+    server.join ();
+    close (lfd);
+    EXPECT_EQ (received, "1000|INFO|m0\n");
+}
+
+TEST (SocketSink, ConnectTimesOut) {
+    // A listener whose accept queue is full drops further SYNs, so the
+    // next connect hangs until the sink gives up.
+    uint16_t port = 0;
+    const int lfd = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    ASSERT_EQ (listen (lfd, 0), 0);
+    std::vector<int> fillers;
+    for (int i = 0; i < 8; ++i) {
+        const int c = ::socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        addr.sin_port        = htons (port);
+        ::connect (c, reinterpret_cast<sockaddr*> (&addr), sizeof (addr));
+        fillers.push_back (c);
+    }
+    std::this_thread::sleep_for (std::chrono::milliseconds (50));
+
+    SocketSinkOptions opts;
+    opts.connect_timeout = std::chrono::milliseconds (100);
+    SocketSink sink ("127.0.0.1", port, opts);
+    std::string err;
+    LogEntry e;
+    const auto t0 = std::chrono::steady_clock::now ();
+    EXPECT_FALSE (sink.write (e, err));
+    EXPECT_LT (std::chrono::steady_clock::now () - t0, std::chrono::seconds (2));
+    EXPECT_NE (err.find ("timed out"), std::string::npos) << err;
+    for (const int c : fillers)
+        close (c);
+    close (lfd);
+}
+
+TEST (SocketSink, BackgroundConnectKeepsCallersOffTheNetwork) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    std::string received;
+    std::thread server ([&] { received = accept_and_read_all (lfd); });
+
+    SocketSinkOptions opts;
+    opts.background_connect = true;
+    opts.spill_bytes        = 1 << 16;
+    std::string expected;
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        expected = numbered_lines (sink, 0, 10); // the first ones wait while the helper connects
+        const SocketSinkCounters c = sink.counters ();
+        EXPECT_GE (c.spilled, 1u);
+        EXPECT_EQ (c.spilled + c.sent, 10u);
+        std::this_thread::sleep_for (std::chrono::milliseconds (100));
+        expected += numbered_lines (sink, 10, 20);
+        sink.flush ();
+    }
+    server.join ();
+    close (lfd);
+    EXPECT_EQ (received, expected);
+}
+
+TEST (SocketSink, UnixStreamSendsLines) {
+    const std::string path = ::testing::TempDir () + "logger_stream.sock";
+    ::unlink (path.c_str ());
+    const int lfd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE (lfd, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    path.copy (addr.sun_path, path.size ());
+    ASSERT_EQ (bind (lfd, reinterpret_cast<sockaddr*> (&addr), sizeof (addr)), 0);
+    ASSERT_EQ (listen (lfd, 1), 0);
+    fcntl (lfd, F_SETFL, fcntl (lfd, F_GETFL, 0) | O_NONBLOCK);
+    std::string received;
+    std::thread server ([&] { received = accept_and_read_all (lfd); });
+
+    std::string expected;
+    {
+        auto sink = make_unix_socket_sink (path);
+        expected  = numbered_lines (static_cast<SocketSink&> (*sink), 0, 5);
+    }
+    server.join ();
+    close (lfd);
+    ::unlink (path.c_str ());
+    EXPECT_EQ (received, expected);
+}
+
+/** Accept one client, answer the binary handshake if @p accept, and return the bytes after the hello. */
+static std::string accept_binary_client (const int lfd, const bool accept) {
+    int cli = -1;
+    for (int i = 0; i < 300 && cli < 0; ++i) {
+        cli = ::accept (lfd, nullptr, nullptr);
+        if (cli < 0)
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    }
+    if (cli < 0)
+        return "accept timeout";
+    timeval tv{};
+    tv.tv_sec = 2;
+    setsockopt (cli, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    std::string received;
+    char buf[4096];
+    ssize_t n;
+    while (received.size () < wire::kHello.size () && (n = ::recv (cli, buf, sizeof (buf), 0)) > 0)
+        received.append (buf, buf + n);
+    if (received.compare (0, wire::kHello.size (), wire::kHello) != 0) {
+        close (cli);
+        return "no hello: " + received;
+    }
+    received.erase (0, wire::kHello.size ());
+    if (accept)
+        ::send (cli, wire::kAccept.data (), wire::kAccept.size (), MSG_NOSIGNAL);
+    while ((n = ::recv (cli, buf, sizeof (buf), 0)) > 0)
+        received.append (buf, buf + n);
+    close (cli);
+    return received;
+}
+
+TEST (SocketSink, BinaryWireSendsChecksummedBlocks) {
+    uint16_t port = 0;
+    const int lfd = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    std::string received;
+    std::thread server ([&] { received = accept_binary_client (lfd, true); });
+    {
+        SocketSinkOptions so;
+        so.wire = WireFormat::Binary;
+        SocketSink sink ("127.0.0.1", port, so);
+        std::string err;
+        ASSERT_TRUE (sink.write (LogEntry{ 42, LogLevel::Warning, "two\nlines|with bars" }, err)) << err;
+        std::vector<LogEntry> batch (100);
+        for (std::size_t i = 0; i < batch.size (); ++i)
+            batch[i] = LogEntry{ 1000 + i, LogLevel::Info, "m" + std::to_string (i) };
+        ASSERT_EQ (sink.write_batch (batch.data (), batch.size (), err), batch.size ()) << err;
+    }
+    server.join ();
+    close (lfd);
+
+    std::vector<wire::RecordView> records;
+    std::string_view in = received;
+    while (!in.empty ()) {
+        std::string_view body;
+        std::size_t used = 0;
+        ASSERT_EQ (wire::next_block (in, body, used), wire::Decode::Ok);
+        in.remove_prefix (used);
+        wire::RecordView r;
+        while (!body.empty ()) {
+            ASSERT_EQ (wire::next_record (body, r), wire::Decode::Ok);
+            records.push_back (r);
+        }
+    }
+    ASSERT_EQ (records.size (), 101u);
+    EXPECT_EQ (records[0].epoch_ms, 42u);
+    EXPECT_EQ (records[0].level, LogLevel::Warning);
+    EXPECT_EQ (records[0].message, "two\nlines|with bars");
+    EXPECT_EQ (records[100].epoch_ms, 1099u);
+    EXPECT_EQ (records[100].message, "m99");
+}
+
+TEST (SocketSink, BinaryWireFallsBackToTextForOldCollector) {
+    uint16_t port = 0;
+    const int lfd = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    std::string offered, received;
+    std::thread server ([&] {
+        // The unanswered connection is dropped; text goes over a new one.
+        offered  = accept_binary_client (lfd, false);
+        received = accept_and_read_all (lfd);
+    });
+    {
+        SocketSinkOptions so;
+        so.wire            = WireFormat::Binary;
+        so.connect_timeout = std::chrono::milliseconds (200);
+        SocketSink sink ("127.0.0.1", port, so);
+        std::string err;
+        ASSERT_TRUE (sink.write (LogEntry{ 7, LogLevel::Error, "a\nb" }, err)) << err;
+        ASSERT_TRUE (sink.write (LogEntry{ 8, LogLevel::Info, "c" }, err)) << err;
+    }
+    server.join ();
+    close (lfd);
+    EXPECT_EQ (offered, "");
+    EXPECT_EQ (received, "7|ERROR|a b\n8|INFO|c\n");
+}
+
+/** Decode a stream of binary blocks into text lines (empty string on corrupt input). */
+static std::string blocks_as_text (std::string_view in) {
+    std::string text;
+    while (!in.empty ()) {
+        std::string_view body;
+        std::size_t used = 0;
+        if (wire::next_block (in, body, used) != wire::Decode::Ok || !wire::append_as_text (text, body))
+            return {};
+        in.remove_prefix (used);
+    }
+    return text;
+}
+
+TEST (SocketSink, BinaryWireSpillsAndReplaysWholeRecords) {
+    uint16_t port = 0;
+    int lfd       = make_listen_ipv4 (port);
+    ASSERT_GE (lfd, 0);
+    close (lfd); // collector is down
+
+    const std::string spool = ::testing::TempDir () + "binary_wire.spool";
+    ::unlink (spool.c_str ());
+    SocketSinkOptions opts;
+    opts.wire          = WireFormat::Binary;
+    opts.spill_bytes   = 1000; // most records overflow to the spool
+    opts.spool_path    = spool;
+    opts.reconnect_min = std::chrono::milliseconds (20);
+    std::string expected, received;
+    std::thread server;
+    int srv = -1;
+    {
+        SocketSink sink ("127.0.0.1", port, opts);
+        expected = numbered_lines (sink, 0, 500);
+        srv      = listen_on_port (port);
+        ASSERT_GE (srv, 0);
+        server = std::thread ([&] { received = accept_binary_client (srv, true); });
+        std::this_thread::sleep_for (std::chrono::milliseconds (100)); // past the backoff
+        expected += numbered_lines (sink, 500, 501);
+        sink.flush ();
+    }
+    server.join ();
+    close (srv);
+    ::unlink (spool.c_str ());
+    EXPECT_EQ (blocks_as_text (received), expected);
+}
+
+TEST (SocketSink, SpoolFromTheOtherWireFormatIsConverted) {
+    for (const WireFormat left : { WireFormat::Text, WireFormat::Binary }) {
+        const WireFormat now    = left == WireFormat::Text ? WireFormat::Binary : WireFormat::Text;
+        const std::string spool = ::testing::TempDir () + "converted_wire.spool";
+        ::unlink (spool.c_str ());
+        uint16_t port = 0;
+        int lfd       = make_listen_ipv4 (port);
+        ASSERT_GE (lfd, 0);
+        close (lfd); // collector is down while the spool is written
+
+        SocketSinkOptions opts;
+        opts.wire        = left;
+        opts.spill_bytes = 256;
+        opts.spool_path  = spool;
+        std::string expected;
+        {
+            SocketSink sink ("127.0.0.1", port, opts);
+            expected = numbered_lines (sink, 0, 200);
+        }
+
+        const int srv = listen_on_port (port);
+        ASSERT_GE (srv, 0);
+        std::string received;
+        std::thread server ([&] {
+            received = now == WireFormat::Binary ? blocks_as_text (accept_binary_client (srv, true)) : accept_and_read_all (srv);
+        });
+        opts.wire = now;
+        {
+            SocketSink sink ("127.0.0.1", port, opts);
+            expected += numbered_lines (sink, 200, 201);
+            sink.flush ();
+            EXPECT_EQ (sink.counters ().send_errors, 0u) << sink.last_error ();
+        }
+        server.join ();
+        close (srv);
+        ::unlink (spool.c_str ());
+        EXPECT_EQ (received, expected) << "spool written as " << (left == WireFormat::Text ? "text" : "binary");
+    }
+}
@@ -0,0 +1,108 @@
+#include "logger/source_stats.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace logger;
+
+namespace {
+SourceCounts counts (const std::uint64_t errors, const std::uint64_t infos) {
+    SourceCounts c;
+    for (std::uint64_t i = 0; i < errors; ++i)
+        c.add (LogLevel::Error, 10);
+    for (std::uint64_t i = 0; i < infos; ++i)
+        c.add (LogLevel::Info, 10);
+    return c;
+}
+} // namespace
+
+TEST (SourceStats, RanksByVolumeAndByErrors) {
+    SourceStatsTable t;
+    t.merge ("web-1", counts (1, 50), 1000);
+    t.merge ("web-2", counts (30, 5), 1000);
+    t.merge ("db", counts (0, 10), 1000);
+    t.merge ("web-1", counts (2, 0), 2000); // deltas add up
+    t.merge ("quiet", SourceCounts{}, 2000); // empty delta: not created
+
+    EXPECT_EQ (t.size (), 3u);
+    const auto vol = t.top_by_volume (2);
+    ASSERT_EQ (vol.size (), 2u);
+    EXPECT_EQ (vol[0].source, "web-1");
+    EXPECT_EQ (vol[0].counts.total, 53u);
+    EXPECT_EQ (vol[0].counts.by_level[0], 3u);
+    EXPECT_EQ (vol[0].counts.bytes, 530u);
+    EXPECT_EQ (vol[0].last_seen_ms, 2000u);
+    EXPECT_EQ (vol[1].source, "web-2");
+
+    const auto err = t.top_by_errors (10);
+    ASSERT_EQ (err.size (), 2u); // "db" has no errors
+    EXPECT_EQ (err[0].source, "web-2");
+    EXPECT_EQ (err[1].source, "web-1");
+}
+
+TEST (SourceStats, IdleSourcesAreEvicted) {
+    SourceStatsTable t;
+    t.merge ("old", counts (1, 1), 1000);
+    t.merge ("new", counts (1, 1), 5000);
+    EXPECT_EQ (t.evict_idle (3000), 1u);
+    ASSERT_EQ (t.top_by_volume (10).size (), 1u);
+    EXPECT_EQ (t.top_by_volume (10)[0].source, "new");
+    // A source that comes back starts over.
+    t.merge ("old", counts (0, 1), 6000);
+    EXPECT_EQ (t.top_by_volume (10)[1].counts.total, 1u);
+}
+
+TEST (SourceStats, SourcesBeyondTheCapShareOverflow) {
+    SourceStatsTable t (2);
+    t.merge ("a", counts (0, 1), 1);
+    t.merge ("b", counts (0, 1), 1);
+    t.merge ("c", counts (0, 3), 1);
+    t.merge ("d", counts (0, 4), 1);
+    t.merge ("a", counts (0, 1), 1); // tracked sources keep counting
+    EXPECT_EQ (t.size (), 3u);
+    const auto vol = t.top_by_volume (1);
+    ASSERT_EQ (vol.size (), 1u);
+    EXPECT_EQ (vol[0].source, SourceStatsTable::kOverflow);
+    EXPECT_EQ (vol[0].counts.total, 7u);
+}
+
+TEST (SourceStats, TablesMergeLikeOneTable) {
+    SourceStatsTable a, b, all (2);
+    a.merge ("web-1", counts (1, 5), 1000);
+    a.merge ("db", counts (0, 2), 1000);
+    b.merge ("web-1", counts (2, 0), 3000); // same host on another shard
+    b.merge ("cron", counts (0, 1), 2000);
+    all.merge (a);
+    all.merge (b);
+
+    EXPECT_EQ (all.size (), 3u); // "cron" went to the overflow entry
+    const auto vol = all.top_by_volume (3);
+    ASSERT_EQ (vol.size (), 3u);
+    EXPECT_EQ (vol[0].source, "web-1");
+    EXPECT_EQ (vol[0].counts.total, 8u);
+    EXPECT_EQ (vol[0].counts.by_level[0], 3u);
+    EXPECT_EQ (vol[0].last_seen_ms, 3000u);
+    EXPECT_EQ (vol[1].source, "db");
+    EXPECT_EQ (vol[2].source, SourceStatsTable::kOverflow);
+    EXPECT_EQ (a.size (), 2u); // the merged tables are left as they were
+}
+
+TEST (SourceStats, ConcurrentMergesAreAllCounted) {
+    SourceStatsTable t;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+        threads.emplace_back ([&t, i] {
+            for (int k = 0; k < 1000; ++k)
+                t.merge ("src-" + std::to_string (k % 4), counts (i % 2, 1), 1);
+        });
+    for (auto& th : threads)
+        th.join ();
+    std::uint64_t total = 0, errors = 0;
+    for (const auto& s : t.top_by_volume (10)) {
+        total += s.counts.total;
+        errors += s.counts.by_level[0];
+    }
+    EXPECT_EQ (total, 12000u);
+    EXPECT_EQ (errors, 4000u);
+}
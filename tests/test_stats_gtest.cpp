@@ -0,0 +1,310 @@
+#include "logger/stats.hpp"
+#include "logger/utils.hpp"
+#include <atomic>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace logger;
+
+TEST (Stats, MergedShardsMatchOneCollector) {
+    StatsCollector all, a, b, empty;
+    const std::uint64_t now = now_epoch_ms ();
+    for (std::size_t i = 0; i < 30; ++i) {
+        const LogLevel lvl = static_cast<LogLevel> (i % 3);
+        all.add (now, lvl, i + 1);
+        (i < 10 ? a : b).add (now, lvl, i + 1);
+    }
+    const StatsSnapshot want = all.snapshot (now);
+    StatsSnapshot got        = empty.snapshot (now);
+    merge_snapshot (got, a.snapshot (now));
+    merge_snapshot (got, empty.snapshot (now));
+    merge_snapshot (got, b.snapshot (now));
+
+    EXPECT_EQ (got.total, want.total);
+    EXPECT_EQ (got.min_len, want.min_len);
+    EXPECT_EQ (got.max_len, want.max_len);
+    EXPECT_DOUBLE_EQ (got.avg_len, want.avg_len);
+    EXPECT_EQ (got.last_hour_total, want.last_hour_total);
+    EXPECT_DOUBLE_EQ (got.last_hour_avg_len, want.last_hour_avg_len);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ (got.by_level[i], want.by_level[i]);
+        EXPECT_EQ (got.last_hour_by_level[i], want.last_hour_by_level[i]);
+    }
+}
+
+TEST (Stats, ConcurrentAddsAreAllCounted) {
+    StatsCollector stats;
+    const std::uint64_t now = now_epoch_ms ();
+    // More live threads than slots, so some share the overflow slot.
+    constexpr int kThreads = static_cast<int> (StatsCollector::kSlots) + 8;
+    constexpr int kPer     = 3000;
+    std::atomic<int> started{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+        threads.emplace_back ([&stats, &started, now, t] {
+            stats.add (now, LogLevel::Error, static_cast<std::size_t> (t + 1));
+            started.fetch_add (1);
+            while (started.load () < kThreads)
+                std::this_thread::yield ();
+            for (int i = 1; i < kPer; ++i)
+                stats.add (now, static_cast<LogLevel> (i % 3), static_cast<std::size_t> (t + 1));
+        });
+    for (auto& th : threads)
+        th.join ();
+
+    const StatsSnapshot s = stats.snapshot (now);
+    EXPECT_EQ (s.total, static_cast<std::uint64_t> (kThreads * kPer));
+    EXPECT_EQ (s.by_level[0] + s.by_level[1] + s.by_level[2], s.total);
+    EXPECT_EQ (s.by_level[0], static_cast<std::uint64_t> (kThreads * ((kPer + 2) / 3)));
+    EXPECT_EQ (s.min_len, 1u);
+    EXPECT_EQ (s.max_len, static_cast<std::size_t> (kThreads));
+    EXPECT_DOUBLE_EQ (s.avg_len, (kThreads + 1) / 2.0);
+    EXPECT_EQ (s.last_hour_total, s.total);
+}
+
+TEST (Stats, EmptyCollectorReportsZeros) {
+    StatsCollector stats;
+    const StatsSnapshot s = stats.snapshot (now_epoch_ms ());
+    EXPECT_EQ (s.total, 0u);
+    EXPECT_EQ (s.min_len, 0u);
+    EXPECT_EQ (s.max_len, 0u);
+    EXPECT_EQ (s.avg_len, 0.0);
+}
+
+TEST (Stats, WindowExpiresWholeBuckets) {
+    StatsCollector stats (StatsWindow{ std::chrono::seconds (10), std::chrono::seconds (1) });
+    const std::uint64_t t = 1'700'000'000'000ull;
+    stats.add (t - 20'000, LogLevel::Error, 100); // already outside the window
+    stats.add (t - 5'000, LogLevel::Warning, 10);
+    stats.add (t - 5'000, LogLevel::Warning, 30);
+    stats.add (t, LogLevel::Info, 50);
+
+    StatsSnapshot s = stats.snapshot (t);
+    EXPECT_EQ (s.total, 4u);
+    EXPECT_EQ (s.last_hour_total, 3u);
+    EXPECT_EQ (s.last_hour_by_level[0], 0u);
+    EXPECT_EQ (s.last_hour_by_level[1], 2u);
+    EXPECT_EQ (s.last_hour_by_level[2], 1u);
+    EXPECT_DOUBLE_EQ (s.last_hour_avg_len, 30.0);
+
+    s = stats.snapshot (t + 8'000);
+    EXPECT_EQ (s.last_hour_total, 1u);
+    EXPECT_DOUBLE_EQ (s.last_hour_avg_len, 50.0);
+
+    s = stats.snapshot (t + 11'000);
+    EXPECT_EQ (s.last_hour_total, 0u);
+    EXPECT_EQ (s.last_hour_avg_len, 0.0);
+    EXPECT_EQ (s.total, 4u);
+}
+
+TEST (Stats, RecordOlderThanRingSkipsWindowOnly) {
+    StatsCollector stats (StatsWindow{ std::chrono::seconds (10), std::chrono::seconds (1), {}, {} });
+    const std::uint64_t t = 1'700'000'000'000ull;
+    stats.add (t, LogLevel::Info, 5);
+    // Same ring slot as t (10 + 1 buckets, plus 10 of lead), but an older
+    // interval: must not recycle t's bucket.
+    stats.add (t - 21'000, LogLevel::Info, 7);
+    const StatsSnapshot s = stats.snapshot (t);
+    EXPECT_EQ (s.total, 2u);
+    EXPECT_EQ (s.last_hour_total, 1u);
+    EXPECT_DOUBLE_EQ (s.last_hour_avg_len, 5.0);
+}
+
+TEST (Stats, FutureRecordsStayOutOfTheWindows) {
+    StatsCollector stats (StatsWindow{ std::chrono::seconds (10), std::chrono::seconds (1), {}, {} });
+    const std::uint64_t t = now_epoch_ms ();
+    stats.add (t, LogLevel::Info, 5);
+    stats.add (t + 3'600'000, LogLevel::Error, 9); // clock an hour ahead: never windowed
+    stats.add (t + 5'000, LogLevel::Warning, 7);   // within kMaxLead: reported once due
+
+    StatsSnapshot s = stats.snapshot (t);
+    EXPECT_EQ (s.total, 3u);
+    EXPECT_EQ (s.last_hour_total, 1u);
+    EXPECT_EQ (s.last_hour_len_sketch.count (), 1u);
+    s = stats.snapshot (t + 5'000);
+    EXPECT_EQ (s.last_hour_total, 2u);
+    EXPECT_EQ (s.last_hour_by_level[0], 0u);
+    s = stats.snapshot (t + 3'600'000);
+    EXPECT_EQ (s.last_hour_total, 0u);
+}
+
+TEST (Stats, LengthQuantilesShowTheTail) {
+    StatsCollector a, b;
+    const std::uint64_t now = now_epoch_ms ();
+    // 99% short messages and a 1% tail of large payloads.
+    for (int i = 0; i < 10000; ++i)
+        (i % 2 == 0 ? a : b).add (now, LogLevel::Info, static_cast<std::size_t> (i % 100 == 0 ? 64 * 1024 : 100));
+    StatsSnapshot s = a.snapshot (now);
+    merge_snapshot (s, b.snapshot (now));
+
+    EXPECT_EQ (s.len_sketch.count (), 10000u);
+    // Estimates are bucket midpoints, within 1/32 of the true value.
+    EXPECT_NEAR (static_cast<double> (s.len_q.p50), 100.0, 100.0 / 32);
+    EXPECT_NEAR (static_cast<double> (s.len_q.p90), 100.0, 100.0 / 32);
+    EXPECT_NEAR (static_cast<double> (s.len_q.p99), 100.0, 100.0 / 32);
+    EXPECT_NEAR (static_cast<double> (s.len_q.p999), 64.0 * 1024, 64.0 * 1024 / 32);
+    EXPECT_NEAR (static_cast<double> (s.last_hour_len_q.p50), 100.0, 100.0 / 32);
+    EXPECT_NEAR (static_cast<double> (s.last_hour_len_q.p999), 64.0 * 1024, 64.0 * 1024 / 32);
+    EXPECT_LE (s.len_q.p999, s.max_len);
+}
+
+TEST (Stats, SeveralWindowsShareOneRing) {
+    using std::chrono::minutes;
+    StatsCollector stats (StatsWindow{ minutes (60), std::chrono::seconds (1), { minutes (1), minutes (5), minutes (120) }, {} });
+    const std::uint64_t t = 1'700'000'000'000ull;
+    stats.add (t - 30'000, LogLevel::Error, 10);    // 30 s ago
+    stats.add (t - 180'000, LogLevel::Warning, 20); // 3 min ago
+    stats.add (t - 5'400'000, LogLevel::Info, 30);  // 90 min ago
+
+    const StatsSnapshot s = stats.snapshot (t);
+    ASSERT_EQ (s.windows.size (), 3u);
+    EXPECT_EQ (s.windows[0].length, minutes (1));
+    EXPECT_EQ (s.windows[0].total, 1u);
+    EXPECT_EQ (s.windows[0].by_level[0], 1u);
+    EXPECT_EQ (s.windows[1].total, 2u);
+    EXPECT_DOUBLE_EQ (s.windows[1].avg_len, 15.0);
+    EXPECT_EQ (s.windows[2].total, 3u);
+    EXPECT_EQ (s.windows[2].by_level[2], 1u);
+    EXPECT_EQ (s.last_hour_total, 2u);
+
+    StatsSnapshot merged;
+    merge_snapshot (merged, s);
+    merge_snapshot (merged, s);
+    EXPECT_EQ (merged.windows[1].total, 4u);
+    EXPECT_DOUBLE_EQ (merged.windows[1].avg_len, 15.0);
+}
+
+TEST (Stats, DecayedRatesFollowArrivals) {
+    using std::chrono::minutes;
+    StatsCollector stats (StatsWindow{ minutes (60), std::chrono::seconds (1), {}, { minutes (1), minutes (5) } });
+    const std::uint64_t t = 1'700'000'000'000ull;
+    StatsSnapshot s = stats.snapshot (t); // baseline
+    ASSERT_EQ (s.rates.size (), 2u);
+    EXPECT_EQ (s.rates[0].per_sec[0], 0.0);
+
+    for (int i = 0; i < 6000; ++i) // 100/s over the next minute
+        stats.add (t, LogLevel::Error, 1);
+    s = stats.snapshot (t + 60'000);
+    EXPECT_NEAR (s.rates[0].per_sec[0], 100.0 * (1 - std::exp (-1.0)), 1e-9);
+    EXPECT_NEAR (s.rates[1].per_sec[0], 100.0 * (1 - std::exp (-0.2)), 1e-9);
+    EXPECT_EQ (s.rates[0].per_sec[1], 0.0);
+
+    // Splitting the same minute into many snapshots gives the same answer.
+    StatsCollector fine (StatsWindow{ minutes (60), std::chrono::seconds (1), {}, { minutes (1) } });
+    fine.snapshot (t);
+    for (int step = 1; step <= 60; ++step) {
+        for (int i = 0; i < 100; ++i)
+            fine.add (t, LogLevel::Error, 1);
+        s = fine.snapshot (t + 1000ull * step);
+    }
+    EXPECT_NEAR (s.rates[0].per_sec[0], 100.0 * (1 - std::exp (-1.0)), 1e-6);
+
+    // Quiet minute: the 1m rate decays by e.
+    const double before = stats.snapshot (t + 60'000).rates[0].per_sec[0];
+    EXPECT_NEAR (stats.snapshot (t + 120'000).rates[0].per_sec[0], before * std::exp (-1.0), 1e-9);
+}
+
+TEST (Stats, TemplatesRankedPerLevelAndMerged) {
+    StatsCollector a, b;
+    const std::uint64_t now = now_epoch_ms ();
+    for (int i = 0; i < 300; ++i) {
+        StatsCollector& s = i % 2 ? a : b;
+        s.add (now, LogLevel::Error, "disk " + std::to_string (i % 4) + " failed");
+        if (i % 3 == 0)
+            s.add (now, LogLevel::Error, "socket 0x" + std::to_string (i) + " reset");
+        s.add (now, LogLevel::Info, "served request " + std::to_string (i));
+    }
+    a.add (now, LogLevel::Warning, std::size_t{ 10 }); // length only: no template
+    StatsSnapshot snap = a.snapshot (now);
+    merge_snapshot (snap, b.snapshot (now));
+
+    ASSERT_EQ (snap.top_templates[0].size (), 2u);
+    EXPECT_EQ (snap.top_templates[0][0].text, "disk # failed");
+    EXPECT_EQ (snap.top_templates[0][0].count, 300u);
+    EXPECT_EQ (snap.top_templates[0][1].text, "socket # reset");
+    EXPECT_EQ (snap.top_templates[0][1].count, 100u);
+    EXPECT_TRUE (snap.top_templates[1].empty ());
+    ASSERT_EQ (snap.top_templates[2].size (), 1u);
+    EXPECT_EQ (snap.top_templates[2][0].text, "served request #");
+    EXPECT_EQ (snap.top_templates[2][0].count, 300u);
+    EXPECT_EQ (snap.top_templates[2][0].error, 0u);
+}
+
+TEST (Stats, WindowTemplatesFollowRecentBursts) {
+    const std::uint64_t now = 1'700'000'000'000ull;
+    StatsCollector a, b;
+    for (int i = 0; i < 1000; ++i) // 20 minutes ago
+        (i % 2 ? a : b).add (now - 20 * 60 * 1000, LogLevel::Error, "cache miss " + std::to_string (i));
+    for (int i = 0; i < 100; ++i) // the last minute
+        (i % 2 ? a : b).add (now - 1000, LogLevel::Error, "disk " + std::to_string (i) + " failed");
+    StatsSnapshot s = a.snapshot (now);
+    merge_snapshot (s, b.snapshot (now));
+
+    ASSERT_EQ (s.top_templates[0].size (), 2u);
+    EXPECT_EQ (s.top_templates[0][0].text, "cache miss #");
+    ASSERT_EQ (s.last_hour_top_templates[0].size (), 2u);
+    EXPECT_EQ (s.last_hour_top_templates[0][0].text, "cache miss #");
+    ASSERT_EQ (s.windows.size (), 3u);
+    for (const WindowStats& w : s.windows) {
+        ASSERT_EQ (w.top_templates[0].size (), 1u) << w.length.count ();
+        EXPECT_EQ (w.top_templates[0][0].text, "disk # failed");
+        EXPECT_EQ (w.top_templates[0][0].count, 100u);
+    }
+}
+
+TEST (Stats, ShortWindowsKeepTheirOwnSlices) {
+    const std::uint64_t now = 1'700'000'000'000ull;
+    StatsWindow win;
+    win.length  = std::chrono::hours (24);
+    win.windows = { std::chrono::minutes (1), std::chrono::hours (24) };
+    StatsCollector c (win);
+    // Ten minutes ago: a 24-minute slice of the day would still hold these.
+    for (int i = 0; i < 500; ++i)
+        c.add (now - 10 * 60 * 1000, LogLevel::Error, "old " + std::to_string (i), 1 + i);
+    for (int i = 0; i < 20; ++i)
+        c.add (now - 30 * 1000, LogLevel::Error, "new " + std::to_string (i), 1);
+    const StatsSnapshot s = c.snapshot (now);
+
+    ASSERT_EQ (s.windows.size (), 2u);
+    EXPECT_EQ (s.windows[0].distinct_messages, 20u);
+    EXPECT_EQ (s.windows[0].distinct_sources, 1u);
+    ASSERT_EQ (s.windows[0].top_templates[0].size (), 1u);
+    EXPECT_EQ (s.windows[0].top_templates[0][0].text, "new #");
+    // The day-long window shares the main window's ring.
+    EXPECT_EQ (s.windows[1].distinct_messages, s.last_hour_distinct_messages);
+    EXPECT_EQ (s.windows[1].distinct_sources, s.last_hour_distinct_sources);
+    EXPECT_NEAR (static_cast<double> (s.last_hour_distinct_messages), 520.0, 26.0);
+    ASSERT_EQ (s.windows[1].top_templates[0].size (), 2u);
+    EXPECT_EQ (s.windows[1].top_templates[0][0].text, "old #");
+}
+
+TEST (Stats, DistinctMessagesAndSourcesPerWindow) {
+    const std::uint64_t now = 1'700'000'000'000ull;
+    StatsCollector a, b;
+    // 20 minutes ago: inside the hour, outside the 1/5/15-minute windows.
+    for (int i = 0; i < 5000; ++i)
+        a.add (now - 20 * 60 * 1000, LogLevel::Error, "old failure " + std::to_string (i), 100 + i % 3);
+    for (int i = 0; i < 3000; ++i) {
+        const std::string msg = "fresh failure " + std::to_string (i % 1000);
+        (i % 2 ? a : b).add (now - 1000, LogLevel::Error, msg, 1 + i % 10);
+    }
+    a.add (now, LogLevel::Info, std::size_t{ 5 }); // no text: not counted
+    StatsSnapshot s = a.snapshot (now);
+    merge_snapshot (s, b.snapshot (now));
+
+    const auto near = [] (const std::uint64_t got, const double want) {
+        EXPECT_NEAR (static_cast<double> (got), want, std::max (1.0, 0.05 * want));
+    };
+    near (s.distinct_messages, 6000);
+    near (s.last_hour_distinct_messages, 6000);
+    near (s.distinct_sources, 13);
+    near (s.last_hour_distinct_sources, 13);
+    ASSERT_EQ (s.windows.size (), 3u);
+    for (const WindowStats& w : s.windows) {
+        near (w.distinct_messages, 1000);
+        near (w.distinct_sources, 10);
+    }
+}
@@ -0,0 +1,93 @@
+#include "logger/hash.hpp"
+#include "logger/top_templates.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace logger;
+
+namespace {
+std::string normalized (const std::string_view msg) {
+    char buf[kMaxTemplateLen];
+    return std::string (buf, normalize_template (msg, buf, sizeof (buf)));
+}
+} // namespace
+
+TEST (TopTemplates, NormalizerMasksNumbersAndHexIds) {
+    EXPECT_EQ (normalized ("took 12 ms for req 7f3a9c01"), "took # ms for req #");
+    EXPECT_EQ (normalized ("user42 logged in from 10.0.0.7"), "user# logged in from #.#.#.#");
+    EXPECT_EQ (normalized ("bad ptr 0x1F, face deadbeef"), "bad ptr #, face deadbeef");
+    EXPECT_EQ (normalized ("id=550e8400-e29b-41d4"), "id=#-#-#");
+    EXPECT_EQ (normalized ("no numbers here"), "no numbers here");
+    EXPECT_EQ (normalized (std::string (200, 'x')), std::string (kMaxTemplateLen, 'x'));
+    EXPECT_EQ (normalized (std::string (1000, '7')), "#");
+}
+
+TEST (TopTemplates, FindsHeavyHittersAmongNoise) {
+    TopTemplates top;
+    std::mt19937_64 rng (3);
+    std::uint64_t heavy[3]{ 0, 0, 0 };
+    for (int i = 0; i < 200000; ++i) {
+        const std::uint64_t r = rng ();
+        if (r % 10 == 0) {
+            top.add ("disk " + std::to_string (r % 97) + " is slow");
+            ++heavy[0];
+        } else if (r % 10 == 1) {
+            top.add ("retrying request " + std::to_string (r) + " after timeout");
+            ++heavy[1];
+        } else if (r % 20 == 2) {
+            top.add ("cache miss for key " + std::to_string (r % 1000));
+            ++heavy[2];
+        } else {
+            // Unique templates: the id is spelled out in non-hex letters.
+            std::string word;
+            for (std::uint64_t v = r; v != 0; v /= 20)
+                word += static_cast<char> ('g' + v % 20);
+            top.add ("noise " + word);
+        }
+    }
+    EXPECT_EQ (top.total (), 200000u);
+    const auto got = top.top (3);
+    ASSERT_EQ (got.size (), 3u);
+    const char* want[3]{ "disk # is slow", "retrying request # after timeout", "cache miss for key #" };
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ (got[i].text, want[i]);
+        EXPECT_GE (got[i].count, heavy[i]);
+        EXPECT_LE (got[i].count - got[i].error, heavy[i]);
+    }
+}
+
+TEST (TopTemplates, MergeIsExactBelowCapacity) {
+    TopTemplates a, b, both;
+    for (int i = 0; i < 5000; ++i) {
+        const std::string tmpl = "t" + std::string (1 + i % 150 / 10, 'q');
+        (i % 2 ? a : b).offer (hash_bytes (tmpl.data (), tmpl.size ()), tmpl);
+        both.offer (hash_bytes (tmpl.data (), tmpl.size ()), tmpl);
+    }
+    a.merge (b);
+    EXPECT_EQ (a.total (), both.total ());
+    const auto merged = a.top (), single = both.top ();
+    ASSERT_EQ (merged.size (), single.size ());
+    for (std::size_t i = 0; i < merged.size (); ++i) {
+        EXPECT_EQ (merged[i].text, single[i].text);
+        EXPECT_EQ (merged[i].count, single[i].count);
+    }
+}
+
+TEST (TopTemplates, EvictionKeepsIndexConsistent) {
+    TopTemplates top;
+    // Far more distinct templates than counters, then one that dominates.
+    for (int i = 0; i < 10000; ++i) {
+        const std::string t = "tmpl-" + std::string (1 + i % 37, 'k') + std::string (1 + i % 53, 'z');
+        top.offer (hash_bytes (t.data (), t.size ()), t);
+    }
+    for (int i = 0; i < 20000; ++i)
+        top.offer (hash_bytes ("hot", 3), "hot");
+    const auto got = top.top (1);
+    ASSERT_EQ (got.size (), 1u);
+    EXPECT_EQ (got[0].text, "hot");
+    EXPECT_GE (got[0].count, 20000u);
+    EXPECT_LE (got[0].count - got[0].error, 20000u);
+    EXPECT_EQ (top.top ().size (), TopTemplates::kCapacity);
+}
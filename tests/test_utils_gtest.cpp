@@ -39,3 +39,28 @@ TEST (Utils, SplitHostPort) {
     EXPECT_FALSE (split_host_port (":9090", host, port));
     EXPECT_FALSE (split_host_port ("host:70000", host, port));
 }
+
+TEST (Utils, TimestampFormatterMatchesUncached) {
+    TimestampFormatter tf;
+    char a[kIso8601MaxLen];
+    char b[kIso8601Len];
+    // Walk across a day boundary and a leap day in uneven steps.
+    for (std::uint64_t ms = 1'709'164'700'000ULL; ms < 1'709'251'300'000ULL; ms += 997'123ULL) {
+        const std::size_t n = tf.format (ms, a);
+        ASSERT_EQ (n, kIso8601Len);
+        ASSERT_EQ (std::string (a, n), std::string (b, format_iso8601_utc (ms, b))) << ms;
+        ASSERT_EQ (std::string (a, n), iso8601_utc (ms));
+    }
+}
+
+TEST (Utils, TimestampFormatterSubSecondDigits) {
+    char buf[kIso8601MaxLen];
+    TimestampFormatter ms (TimePrecision::Millis);
+    EXPECT_EQ (std::string (buf, ms.format (1'600'000'000'007ULL, buf)), "2020-09-13T12:26:40.007Z");
+    EXPECT_EQ (std::string (buf, ms.format (1'600'000'000'999ULL, buf)), "2020-09-13T12:26:40.999Z");
+    EXPECT_EQ (std::string (buf, ms.format (0, buf)), "1970-01-01T00:00:00.000Z");
+
+    TimestampFormatter us (TimePrecision::Micros);
+    EXPECT_EQ (std::string (buf, us.format_us (1'600'000'001'000'042ULL, buf)), "2020-09-13T12:26:41.000042Z");
+    EXPECT_EQ (std::string (buf, us.format (1'600'000'001'250ULL, buf)), "2020-09-13T12:26:41.250000Z");
+}
@@ -0,0 +1,84 @@
+#include "logger/wire.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace logger;
+
+static std::string make_block (const std::string& records, const bool crc) {
+    char head[wire::kMaxBlockHeader];
+    std::string out (head, wire::block_header (head, records.size (), crc));
+    out += records;
+    if (crc) {
+        const std::uint32_t c = wire::crc32 (records.data (), records.size ());
+        out.append (reinterpret_cast<const char*> (&c), sizeof (c));
+    }
+    return out;
+}
+
+TEST (Wire, VarintRoundTrip) {
+    for (const std::uint64_t v : { 0ull, 1ull, 127ull, 128ull, 300ull, 1ull << 35, ~0ull }) {
+        std::string buf;
+        wire::put_varint (buf, v);
+        std::string_view in = buf;
+        std::uint64_t out   = 0;
+        ASSERT_EQ (wire::get_varint (in, out), wire::Decode::Ok);
+        EXPECT_EQ (out, v);
+        EXPECT_TRUE (in.empty ());
+    }
+    std::string_view cut ("\x80\x80", 2);
+    std::uint64_t out = 0;
+    EXPECT_EQ (wire::get_varint (cut, out), wire::Decode::NeedMore);
+}
+
+TEST (Wire, Crc32MatchesReferenceValue) {
+    EXPECT_EQ (wire::crc32 ("123456789", 9), 0xCBF43926u);
+}
+
+TEST (Wire, BlockRoundTrip) {
+    std::string records;
+    wire::append_record (records, 1724054876881ull, LogLevel::Error, "multi\nline");
+    wire::append_record (records, 2, LogLevel::Info, "");
+    for (const bool crc : { true, false }) {
+        const std::string block = make_block (records, crc) + "trailing";
+        std::string_view body;
+        std::size_t used = 0;
+        ASSERT_EQ (wire::next_block (block, body, used), wire::Decode::Ok);
+        EXPECT_EQ (used, block.size () - 8);
+        wire::RecordView r;
+        ASSERT_EQ (wire::next_record (body, r), wire::Decode::Ok);
+        EXPECT_EQ (r.epoch_ms, 1724054876881ull);
+        EXPECT_EQ (r.level, LogLevel::Error);
+        EXPECT_EQ (r.message, "multi\nline");
+        ASSERT_EQ (wire::next_record (body, r), wire::Decode::Ok);
+        EXPECT_EQ (r.epoch_ms, 2u);
+        EXPECT_TRUE (r.message.empty ());
+        EXPECT_TRUE (body.empty ());
+    }
+}
+
+TEST (Wire, PartialAndCorruptBlocks) {
+    std::string records;
+    wire::append_record (records, 5, LogLevel::Warning, "payload");
+    std::string block = make_block (records, true);
+    std::string_view body;
+    std::size_t used = 0;
+    for (std::size_t len = 0; len < block.size (); ++len)
+        EXPECT_EQ (wire::next_block (std::string_view (block).substr (0, len), body, used), wire::Decode::NeedMore);
+    block[block.size () - 6] ^= 0x20; // flip a payload bit
+    EXPECT_EQ (wire::next_block (block, body, used), wire::Decode::Corrupt);
+}
+
+TEST (Wire, WholeRecordsAndTextRendering) {
+    std::string records;
+    wire::append_record (records, 1, LogLevel::Info, "a");
+    const std::size_t first = records.size ();
+    wire::append_record (records, 2, LogLevel::Warning, "b\nc");
+    EXPECT_EQ (wire::record_size (records), first);
+    EXPECT_EQ (wire::whole_records (records, records.size () - 1), first);
+    EXPECT_EQ (wire::whole_records (records, records.size ()), records.size ());
+
+    std::string text;
+    ASSERT_TRUE (wire::append_as_text (text, records));
+    EXPECT_EQ (text, "1|INFO|a\n2|WARN|b c\n");
+}